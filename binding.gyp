@@ -13,8 +13,16 @@
         "src/cpp/helpers.h",
         "src/cpp/iterator.cc",
         "src/cpp/iterator.h",
+        "src/cpp/keys.cc",
+        "src/cpp/keys.h",
         "src/cpp/node_async_shim.h",
-        "src/cpp/options.h"
+        "src/cpp/options.h",
+        "src/cpp/partition_layout.h",
+        "src/cpp/table_writer.cc",
+        "src/cpp/table_writer.h"
+      ],
+      "include_dirs": [
+        "deps/leveldb"
       ],
       "dependencies": [
         'deps/leveldb/leveldb.gyp:leveldb'
@@ -0,0 +1,51 @@
+/*
+ * Counts the calls to malloc() and friends in a process, for
+ * demo/pooled-ops.coffee.  Build and preload it with glibc:
+ *
+ *   cc -shared -fPIC -O2 -o /tmp/malloc-count.so demo/malloc-count.c
+ *   LD_PRELOAD=/tmp/malloc-count.so coffee demo/pooled-ops.coffee
+ *
+ * The binding finds node_leveldb_malloc_count() when it is preloaded and
+ * adds the count to binding.poolStats().
+ */
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t n, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void* __libc_memalign(size_t alignment, size_t size);
+
+static volatile uint64_t count = 0;
+
+uint64_t node_leveldb_malloc_count(void) {
+  return __sync_fetch_and_add(&count, 0);
+}
+
+void* malloc(size_t size) {
+  __sync_fetch_and_add(&count, 1);
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size) {
+  __sync_fetch_and_add(&count, 1);
+  return __libc_calloc(n, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+  __sync_fetch_and_add(&count, 1);
+  return __libc_realloc(ptr, size);
+}
+
+void* memalign(size_t alignment, size_t size) {
+  __sync_fetch_and_add(&count, 1);
+  return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size) {
+  __sync_fetch_and_add(&count, 1);
+  *ptr = __libc_memalign(alignment, size);
+  return *ptr == NULL ? ENOMEM : 0;
+}
@@ -8,9 +8,15 @@
 #include "db/dbformat.h"
 #include "db/table_cache.h"
 #include "db/version_edit.h"
+#include "leveldb/comparator.h"
 #include "leveldb/db.h"
 #include "leveldb/env.h"
 #include "leveldb/iterator.h"
+#include "table/block.h"
+#include "table/block_builder.h"
+#include "table/format.h"
+#include "util/coding.h"
+#include "util/crc32c.h"
 
 namespace leveldb {
 
@@ -66,7 +72,8 @@ Status BuildTable(const std::string& dbname,
       // Verify that the table is usable
       Iterator* it = table_cache->NewIterator(ReadOptions(),
                                               meta->number,
-                                              meta->file_size);
+                                              meta->file_size,
+                                              0);
       s = it->status();
       delete it;
     }
@@ -85,4 +92,124 @@ Status BuildTable(const std::string& dbname,
   return s;
 }
 
+static const char kGlobalSequenceKey[] = "leveldb.global_sequence";
+
+static Status ReadFooter(RandomAccessFile* file, uint64_t file_size,
+                         Footer* footer) {
+  if (file_size < Footer::kEncodedLength) {
+    return Status::Corruption("file is too short to be an sstable");
+  }
+  char space[Footer::kEncodedLength];
+  Slice input;
+  Status s = file->Read(file_size - Footer::kEncodedLength,
+                        Footer::kEncodedLength, &input, space);
+  if (s.ok()) {
+    s = footer->DecodeFrom(&input);
+  }
+  return s;
+}
+
+Status AppendGlobalSequence(Env* env,
+                            const std::string& fname,
+                            SequenceNumber sequence,
+                            uint64_t* file_size) {
+  RandomAccessFile* file;
+  Status s = env->NewRandomAccessFile(fname, &file);
+  if (!s.ok()) {
+    return s;
+  }
+  Footer footer;
+  s = ReadFooter(file, *file_size, &footer);
+
+  // The index block is copied as stored, trailer included, since the
+  // data blocks it points at do not move
+  std::string index;
+  if (s.ok()) {
+    const size_t n = static_cast<size_t>(footer.index_handle().size()) +
+                     kBlockTrailerSize;
+    char* buf = new char[n];
+    Slice contents;
+    s = file->Read(footer.index_handle().offset(), n, &contents, buf);
+    if (s.ok() && contents.size() != n) {
+      s = Status::Corruption(fname, "truncated index block");
+    }
+    if (s.ok()) {
+      index.assign(contents.data(), contents.size());
+    }
+    delete[] buf;
+  }
+  delete file;
+  if (!s.ok()) {
+    return s;
+  }
+
+  Options options;
+  BlockBuilder meta_index_block(&options);
+  char value[8];
+  EncodeFixed64(value, sequence);
+  meta_index_block.Add(kGlobalSequenceKey, Slice(value, sizeof(value)));
+  std::string tail = meta_index_block.Finish().ToString();
+
+  BlockHandle metaindex_handle, index_handle;
+  metaindex_handle.set_offset(*file_size);
+  metaindex_handle.set_size(tail.size());
+  char trailer[kBlockTrailerSize];
+  trailer[0] = kNoCompression;
+  uint32_t crc = crc32c::Value(tail.data(), tail.size());
+  crc = crc32c::Extend(crc, trailer, 1);  // Extend crc to cover block type
+  EncodeFixed32(trailer+1, crc32c::Mask(crc));
+  tail.append(trailer, kBlockTrailerSize);
+
+  index_handle.set_offset(*file_size + tail.size());
+  index_handle.set_size(footer.index_handle().size());
+  tail.append(index);
+
+  footer.set_metaindex_handle(metaindex_handle);
+  footer.set_index_handle(index_handle);
+  std::string footer_encoding;
+  footer.EncodeTo(&footer_encoding);
+  tail.append(footer_encoding);
+
+  WritableFile* out;
+  s = env->NewAppendableFile(fname, &out);
+  if (s.ok()) {
+    s = out->Append(tail);
+    if (s.ok()) {
+      s = out->Sync();
+    }
+    if (s.ok()) {
+      s = out->Close();
+    }
+    delete out;
+  }
+  if (s.ok()) {
+    *file_size += tail.size();
+  }
+  return s;
+}
+
+Status ReadGlobalSequence(RandomAccessFile* file,
+                          uint64_t file_size,
+                          SequenceNumber* sequence) {
+  *sequence = 0;
+  Footer footer;
+  Status s = ReadFooter(file, file_size, &footer);
+  Block* block = NULL;
+  if (s.ok()) {
+    s = ReadBlock(file, ReadOptions(), footer.metaindex_handle(), &block);
+  }
+  if (s.ok()) {
+    Iterator* iter = block->NewIterator(BytewiseComparator());
+    iter->Seek(kGlobalSequenceKey);
+    if (iter->Valid() && iter->key() == Slice(kGlobalSequenceKey) &&
+        iter->value().size() == 8) {
+      *sequence = DecodeFixed64(iter->value().data());
+    }
+    s = iter->status();
+    delete iter;
+  }
+  delete block;
+  return s;
+}
+
 }  // namespace leveldb
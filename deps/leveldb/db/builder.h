@@ -5,6 +5,7 @@
 #ifndef STORAGE_LEVELDB_DB_BUILDER_H_
 #define STORAGE_LEVELDB_DB_BUILDER_H_
 
+#include "db/dbformat.h"
 #include "leveldb/status.h"
 
 namespace leveldb {
@@ -14,6 +15,7 @@ struct FileMetaData;
 
 class Env;
 class Iterator;
+class RandomAccessFile;
 class TableCache;
 class VersionEdit;
 
@@ -29,6 +31,21 @@ extern Status BuildTable(const std::string& dbname,
                          Iterator* iter,
                          FileMetaData* meta);
 
+// Record "sequence" as the global sequence number of the ingested table
+// file "fname" by appending a metaindex block that holds it, a copy of
+// the index block and a new footer.  The data blocks are left in place.
+// On success, *file_size is set to the new size of the file.
+extern Status AppendGlobalSequence(Env* env,
+                                   const std::string& fname,
+                                   SequenceNumber sequence,
+                                   uint64_t* file_size);
+
+// Store in *sequence the global sequence number recorded in the table
+// file by AppendGlobalSequence(), or zero if it has none.
+extern Status ReadGlobalSequence(RandomAccessFile* file,
+                                 uint64_t file_size,
+                                 SequenceNumber* sequence);
+
 }  // namespace leveldb
 
 #endif  // STORAGE_LEVELDB_DB_BUILDER_H_
@@ -274,6 +274,30 @@ TEST(CorruptionTest, SequenceNumberRecovery) {
   ASSERT_EQ("v6", v);
 }
 
+TEST(CorruptionTest, RepairKeepsRangeTombstones) {
+  Build(100);
+  std::string start, limit;
+  DBImpl* dbi = reinterpret_cast<DBImpl*>(db_);
+  dbi->TEST_CompactMemTable();
+
+  // One tombstone in the descriptor, one only in the log
+  ASSERT_OK(db_->DeleteRange(WriteOptions(), Key(10, &start), Key(20, &limit)));
+  dbi->TEST_CompactMemTable();
+  ASSERT_OK(db_->DeleteRange(WriteOptions(), Key(30, &start), Key(40, &limit)));
+
+  RepairDB();
+  Reopen();
+  Check(80, 80);
+
+  // Writes after the repair are not hidden by the recovered tombstones
+  std::string key, value, v;
+  ASSERT_OK(db_->Put(WriteOptions(), Key(15, &key), Value(15, &value)));
+  ASSERT_OK(db_->Get(ReadOptions(), key, &v));
+  ASSERT_EQ(value, v);
+  Reopen();
+  Check(81, 81);
+}
+
 TEST(CorruptionTest, CorruptedDescriptor) {
   ASSERT_OK(db_->Put(WriteOptions(), "foo", "hello"));
   DBImpl* dbi = reinterpret_cast<DBImpl*>(db_);
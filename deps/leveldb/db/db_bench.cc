@@ -6,7 +6,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "db/db_impl.h"
+#include "db/memtable.h"
 #include "db/version_set.h"
+#include "table/merger.h"
 #include "leveldb/cache.h"
 #include "leveldb/db.h"
 #include "leveldb/env.h"
@@ -22,15 +24,26 @@
 //   Actual benchmarks:
 //      fillseq       -- write N values in sequential key order in async mode
 //      fillrandom    -- write N values in random key order in async mode
+//      fillrandombatch -- batch write N values in random key order; run
+//                       with --threads and --concurrent_memtable_write
+//                       to measure multi-writer memtable inserts
 //      overwrite     -- overwrite N values in random key order in async mode
+//      fillburst     -- write N values in random key order in bursts of
+//                       --burst_size writes separated by pauses, and
+//                       report write latency percentiles
 //      fillsync      -- write N/100 values in random key order in sync mode
 //      fill100K      -- write N/1000 100K values in random order in async mode
 //      readseq       -- read N times sequentially
 //      readreverse   -- read N times in reverse order
+//      scan          -- read N times sequentially, bypassing the block cache
 //      readrandom    -- read N times in random order
 //      readhot       -- read N times in random order from 1% section of DB
 //      crc32c        -- repeated crc32c of 4K of data
 //      acquireload   -- load N*1000 times
+//      memtable      -- insert N values in random key order into a
+//                       standalone memtable (no log, no compaction)
+//      merge         -- iterate over N keys spread round-robin over
+//                       --merge_children memtables
 //   Meta operations:
 //      compact     -- Compact the entire DB
 //      stats       -- Print DB stats
@@ -85,6 +98,34 @@ static int FLAGS_cache_size = -1;
 // Maximum number of files to keep open at the same time (use default if == 0)
 static int FLAGS_open_files = 0;
 
+// Number of bytes to read ahead during sequential scans (0 disables)
+static int FLAGS_readahead_size = 0;
+
+// If true, concurrent writers insert into the memtable in parallel
+static bool FLAGS_concurrent_memtable_write = false;
+
+// Maximum size of memtable arena blocks (use default if == 0)
+static int FLAGS_arena_block_size = 0;
+
+// If true, back memtable arena blocks with huge pages
+static bool FLAGS_huge_pages = false;
+
+// Number of full memtables that may wait for compaction (default if == 0)
+static int FLAGS_max_immutable_memtables = 0;
+
+// Memory limit for memtables waiting for compaction (0 means none)
+static int FLAGS_max_immutable_memtable_bytes = 0;
+
+// Maximum number of key ranges each compaction is split into
+static int FLAGS_max_subcompactions = 1;
+
+// Writes per burst, and pause between bursts, for "fillburst"
+static int FLAGS_burst_size = 1000;
+static int FLAGS_burst_pause_micros = 100000;
+
+// Number of children merged by the "merge" benchmark
+static int FLAGS_merge_children = 8;
+
 // If true, do not destroy the existing database.  If you set this
 // flag and also specify a benchmark that wants a fresh database, that
 // benchmark will fail.
@@ -438,6 +479,13 @@ class Benchmark {
       } else if (name == Slice("fillrandom")) {
         fresh_db = true;
         method = &Benchmark::WriteRandom;
+      } else if (name == Slice("fillrandombatch")) {
+        fresh_db = true;
+        entries_per_batch_ = 1000;
+        method = &Benchmark::WriteRandom;
+      } else if (name == Slice("fillburst")) {
+        fresh_db = true;
+        method = &Benchmark::WriteBurst;
       } else if (name == Slice("overwrite")) {
         fresh_db = false;
         method = &Benchmark::WriteRandom;
@@ -455,6 +503,8 @@ class Benchmark {
         method = &Benchmark::ReadSequential;
       } else if (name == Slice("readreverse")) {
         method = &Benchmark::ReadReverse;
+      } else if (name == Slice("scan")) {
+        method = &Benchmark::Scan;
       } else if (name == Slice("readrandom")) {
         method = &Benchmark::ReadRandom;
       } else if (name == Slice("readhot")) {
@@ -469,6 +519,10 @@ class Benchmark {
         method = &Benchmark::Compact;
       } else if (name == Slice("crc32c")) {
         method = &Benchmark::Crc32c;
+      } else if (name == Slice("memtable")) {
+        method = &Benchmark::MemTableInsert;
+      } else if (name == Slice("merge")) {
+        method = &Benchmark::MergeIterate;
       } else if (name == Slice("acquireload")) {
         method = &Benchmark::AcquireLoad;
       } else if (name == Slice("snappycomp")) {
@@ -616,6 +670,67 @@ class Benchmark {
     if (ptr == NULL) exit(1); // Disable unused variable warning.
   }
 
+  void MemTableInsert(ThreadState* thread) {
+    InternalKeyComparator icmp(BytewiseComparator());
+    MemTable* mem = new MemTable(icmp, FLAGS_arena_block_size > 0
+                                       ? FLAGS_arena_block_size
+                                       : Options().arena_block_size,
+                                 FLAGS_huge_pages);
+    mem->Ref();
+    RandomGenerator gen;
+    int64_t bytes = 0;
+    for (int i = 0; i < num_; i++) {
+      const int k = thread->rand.Next() % FLAGS_num;
+      char key[100];
+      snprintf(key, sizeof(key), "%016d", k);
+      mem->Add(i + 1, kTypeValue, key, gen.Generate(value_size_));
+      bytes += value_size_ + strlen(key);
+      thread->stats.FinishedSingleOp();
+    }
+    thread->stats.AddBytes(bytes);
+
+    char msg[100];
+    snprintf(msg, sizeof(msg), "(%.1f MB in memtable)",
+             mem->ApproximateMemoryUsage() / 1048576.0);
+    thread->stats.AddMessage(msg);
+    mem->Unref();
+  }
+
+  void MergeIterate(ThreadState* thread) {
+    InternalKeyComparator icmp(BytewiseComparator());
+    std::vector<MemTable*> mems;
+    for (int i = 0; i < FLAGS_merge_children; i++) {
+      mems.push_back(new MemTable(icmp));
+      mems.back()->Ref();
+    }
+    for (int i = 0; i < num_; i++) {
+      char key[100];
+      snprintf(key, sizeof(key), "%016d", i);
+      mems[i % mems.size()]->Add(i + 1, kTypeValue, key, Slice());
+    }
+    std::vector<Iterator*> children;
+    for (size_t i = 0; i < mems.size(); i++) {
+      children.push_back(mems[i]->NewIterator());
+    }
+    Iterator* iter = NewMergingIterator(&icmp, &children[0], children.size());
+
+    thread->stats.Start();  // Do not count the inserts
+    int64_t bytes = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      bytes += iter->key().size();
+      thread->stats.FinishedSingleOp();
+    }
+    delete iter;
+    thread->stats.AddBytes(bytes);
+
+    char msg[100];
+    snprintf(msg, sizeof(msg), "(%d children)", FLAGS_merge_children);
+    thread->stats.AddMessage(msg);
+    for (size_t i = 0; i < mems.size(); i++) {
+      mems[i]->Unref();
+    }
+  }
+
   void SnappyCompress(ThreadState* thread) {
     RandomGenerator gen;
     Slice input = gen.Generate(Options().block_size);
@@ -669,6 +784,16 @@ class Benchmark {
     options.create_if_missing = !FLAGS_use_existing_db;
     options.block_cache = cache_;
     options.write_buffer_size = FLAGS_write_buffer_size;
+    options.allow_concurrent_memtable_write = FLAGS_concurrent_memtable_write;
+    if (FLAGS_arena_block_size > 0) {
+      options.arena_block_size = FLAGS_arena_block_size;
+    }
+    options.memtable_huge_pages = FLAGS_huge_pages;
+    if (FLAGS_max_immutable_memtables > 0) {
+      options.max_immutable_memtables = FLAGS_max_immutable_memtables;
+    }
+    options.max_immutable_memtable_bytes = FLAGS_max_immutable_memtable_bytes;
+    options.max_subcompactions = FLAGS_max_subcompactions;
     Status s = DB::Open(options, FLAGS_db, &db_);
     if (!s.ok()) {
       fprintf(stderr, "open error: %s\n", s.ToString().c_str());
@@ -714,8 +839,53 @@ class Benchmark {
     thread->stats.AddBytes(bytes);
   }
 
+  // Time spent pausing between bursts counts towards micros/op; the
+  // percentiles only cover the writes themselves.
+  void WriteBurst(ThreadState* thread) {
+    RandomGenerator gen;
+    Histogram latency;
+    latency.Clear();
+    int64_t bytes = 0;
+    for (int i = 0; i < num_; i++) {
+      if (i > 0 && i % FLAGS_burst_size == 0) {
+        Env::Default()->SleepForMicroseconds(FLAGS_burst_pause_micros);
+      }
+      const int k = thread->rand.Next() % FLAGS_num;
+      char key[100];
+      snprintf(key, sizeof(key), "%016d", k);
+      const uint64_t start = Env::Default()->NowMicros();
+      Status s = db_->Put(write_options_, key, gen.Generate(value_size_));
+      if (!s.ok()) {
+        fprintf(stderr, "put error: %s\n", s.ToString().c_str());
+        exit(1);
+      }
+      latency.Add(Env::Default()->NowMicros() - start);
+      bytes += value_size_ + strlen(key);
+      thread->stats.FinishedSingleOp();
+    }
+    thread->stats.AddBytes(bytes);
+    char msg[100];
+    snprintf(msg, sizeof(msg), "(write p50 %.1f p99 %.1f p99.9 %.1f micros)",
+             latency.Median(), latency.Percentile(99),
+             latency.Percentile(99.9));
+    thread->stats.AddMessage(msg);
+  }
+
   void ReadSequential(ThreadState* thread) {
-    Iterator* iter = db_->NewIterator(ReadOptions());
+    ReadOptions options;
+    options.readahead_size = FLAGS_readahead_size;
+    DoReadSequential(thread, options);
+  }
+
+  void Scan(ThreadState* thread) {
+    ReadOptions options;
+    options.readahead_size = FLAGS_readahead_size;
+    options.fill_cache = false;
+    DoReadSequential(thread, options);
+  }
+
+  void DoReadSequential(ThreadState* thread, const ReadOptions& options) {
+    Iterator* iter = db_->NewIterator(options);
     int i = 0;
     int64_t bytes = 0;
     for (iter->SeekToFirst(); i < reads_ && iter->Valid(); iter->Next()) {
@@ -796,7 +966,13 @@ class Benchmark {
   }
 
   void Compact(ThreadState* thread) {
+    // Report the size of the DB as the bytes processed, so that MB/s
+    // reflects compaction speed
+    Range all("", "\xff");
+    uint64_t size = 0;
+    db_->GetApproximateSizes(&all, 1, &size);
     db_->CompactRange(NULL, NULL);
+    thread->stats.AddBytes(size);
   }
 
   void PrintStats() {
@@ -849,6 +1025,9 @@ int main(int argc, char** argv) {
     } else if (sscanf(argv[i], "--use_existing_db=%d%c", &n, &junk) == 1 &&
                (n == 0 || n == 1)) {
       FLAGS_use_existing_db = n;
+    } else if (sscanf(argv[i], "--concurrent_memtable_write=%d%c",
+                      &n, &junk) == 1 && (n == 0 || n == 1)) {
+      FLAGS_concurrent_memtable_write = n;
     } else if (sscanf(argv[i], "--num=%d%c", &n, &junk) == 1) {
       FLAGS_num = n;
     } else if (sscanf(argv[i], "--reads=%d%c", &n, &junk) == 1) {
@@ -863,6 +1042,30 @@ int main(int argc, char** argv) {
       FLAGS_cache_size = n;
     } else if (sscanf(argv[i], "--open_files=%d%c", &n, &junk) == 1) {
       FLAGS_open_files = n;
+    } else if (sscanf(argv[i], "--readahead_size=%d%c", &n, &junk) == 1) {
+      FLAGS_readahead_size = n;
+    } else if (sscanf(argv[i], "--arena_block_size=%d%c", &n, &junk) == 1) {
+      FLAGS_arena_block_size = n;
+    } else if (sscanf(argv[i], "--max_immutable_memtables=%d%c",
+                      &n, &junk) == 1) {
+      FLAGS_max_immutable_memtables = n;
+    } else if (sscanf(argv[i], "--max_immutable_memtable_bytes=%d%c",
+                      &n, &junk) == 1) {
+      FLAGS_max_immutable_memtable_bytes = n;
+    } else if (sscanf(argv[i], "--max_subcompactions=%d%c",
+                      &n, &junk) == 1) {
+      FLAGS_max_subcompactions = n;
+    } else if (sscanf(argv[i], "--burst_size=%d%c", &n, &junk) == 1) {
+      FLAGS_burst_size = n;
+    } else if (sscanf(argv[i], "--burst_pause_micros=%d%c",
+                      &n, &junk) == 1) {
+      FLAGS_burst_pause_micros = n;
+    } else if (sscanf(argv[i], "--huge_pages=%d%c", &n, &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_huge_pages = n;
+    } else if (sscanf(argv[i], "--merge_children=%d%c", &n, &junk) == 1 &&
+               n > 0) {
+      FLAGS_merge_children = n;
     } else if (strncmp(argv[i], "--db=", 5) == 0) {
       FLAGS_db = argv[i] + 5;
     } else {
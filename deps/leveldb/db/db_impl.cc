@@ -17,11 +17,14 @@
 #include "db/log_reader.h"
 #include "db/log_writer.h"
 #include "db/memtable.h"
+#include "db/range_tombstone.h"
 #include "db/table_cache.h"
 #include "db/version_set.h"
 #include "db/write_batch_internal.h"
+#include "leveldb/compaction_filter.h"
 #include "leveldb/db.h"
 #include "leveldb/env.h"
+#include "leveldb/merge_operator.h"
 #include "leveldb/status.h"
 #include "leveldb/table.h"
 #include "leveldb/table_builder.h"
@@ -32,6 +35,7 @@
 #include "util/coding.h"
 #include "util/logging.h"
 #include "util/mutexlock.h"
+#include "util/thread_local.h"
 
 namespace leveldb {
 
@@ -44,6 +48,16 @@ struct DBImpl::CompactionState {
   // we can drop all entries for the same key with sequence numbers < S.
   SequenceNumber smallest_snapshot;
 
+  // Range tombstones visible at smallest_snapshot.  Entries they cover
+  // are dropped.  applied_tombstones holds their sequence numbers.
+  RangeTombstoneSet* tombstones;
+  std::set<SequenceNumber> applied_tombstones;
+
+  // The part of the input to compact: [*begin, *end), where NULL means
+  // unbounded.  Only subcompactions set these.
+  const InternalKey* begin;
+  const InternalKey* end;
+
   // Files produced by compaction
   struct Output {
     uint64_t number;
@@ -62,12 +76,70 @@ struct DBImpl::CompactionState {
 
   explicit CompactionState(Compaction* c)
       : compaction(c),
+        tombstones(NULL),
+        begin(NULL),
+        end(NULL),
         outfile(NULL),
         builder(NULL),
         total_bytes(0) {
   }
 };
 
+struct DBImpl::ReadView {
+  MemTable* mem;
+  std::vector<MemTable*> imm;   // Newest first
+  Version* current;
+
+  // Reference count, kept in a pointer-sized word so that it can be
+  // updated without mutex_.
+  port::AtomicPointer refs;
+
+  void Ref() { Add(1); }
+
+  // Returns true iff the last reference was dropped.
+  bool Unref() { return Add(-1) == 0; }
+
+ private:
+  intptr_t Add(intptr_t delta) {
+    while (true) {
+      void* old = refs.Acquire_Load();
+      intptr_t n = reinterpret_cast<intptr_t>(old) + delta;
+      if (refs.CompareAndSwap(old, reinterpret_cast<void*>(n))) {
+        return n;
+      }
+    }
+  }
+};
+
+// A key range of a compaction that runs on a thread of its own
+struct DBImpl::Subcompaction {
+  DBImpl* db;
+  CompactionState* compact;
+  Status status;
+  bool done;                    // Protected by db->mutex_
+  port::CondVar* done_cv;       // Signalled when done is set
+};
+
+struct DBImpl::LiveIterator {
+  uint64_t created_micros;
+  LiveIterator* prev;
+  LiveIterator* next;
+};
+
+// Whole seconds elapsed since "created_micros"
+static uint64_t AgeInSeconds(uint64_t now_micros, uint64_t created_micros) {
+  return now_micros > created_micros ? (now_micros - created_micros) / 1000000
+                                     : 0;
+}
+
+// Values of local_view_ that are not read views.  kViewInUse marks a
+// thread that is reading with its cached view; kViewObsolete marks a
+// thread whose cached view was taken back by InstallReadView().
+static char view_in_use_marker;
+static char view_obsolete_marker;
+static void* const kViewInUse = &view_in_use_marker;
+static void* const kViewObsolete = &view_obsolete_marker;
+
 // Fix user-supplied options to be reasonable
 template <class T,class V>
 static void ClipToRange(T* ptr, V minvalue, V maxvalue) {
@@ -82,7 +154,10 @@ Options SanitizeOptions(const std::string& dbname,
   ClipToRange(&result.max_open_files,           20,     50000);
   ClipToRange(&result.write_buffer_size,        64<<10, 1<<30);
   ClipToRange(&result.block_size,               1<<10,  4<<20);
-  if (result.info_log == NULL) {
+  ClipToRange(&result.arena_block_size,         4<<10,  1<<30);
+  ClipToRange(&result.max_immutable_memtables,  1,      64);
+  ClipToRange(&result.max_subcompactions,       1,      64);
+  if (result.info_log == NULL && !result.read_only) {
     // Open a log file in the same directory as the db
     src.env->CreateDir(dbname);  // In case it does not exist
     src.env->RenameFile(InfoLogFileName(dbname), OldInfoLogFileName(dbname));
@@ -108,17 +183,27 @@ DBImpl::DBImpl(const Options& options, const std::string& dbname)
       db_lock_(NULL),
       shutting_down_(NULL),
       bg_cv_(&mutex_),
-      mem_(new MemTable(internal_comparator_)),
-      imm_(NULL),
+      mem_(NewMemTable()),
       logfile_(NULL),
       logfile_number_(0),
       log_(NULL),
       logger_(NULL),
       logger_cv_(&mutex_),
+      pending_cv_(&mutex_),
+      live_iterators_(new LiveIterator),
+      num_live_iterators_(0),
+      read_view_(NULL),
+      local_view_(new ThreadLocalPtr),
       bg_compaction_scheduled_(false),
-      manual_compaction_(NULL) {
+      manual_compaction_(NULL),
+      ingestion_(NULL),
+      replay_min_log_(0),
+      replay_log_(0),
+      replay_records_(0) {
   mem_->Ref();
   has_imm_.Release_Store(NULL);
+  live_iterators_->prev = live_iterators_;
+  live_iterators_->next = live_iterators_;
 
   // Reserve ten files or so for other uses and give the rest to TableCache.
   const int table_cache_size = options.max_open_files - 10;
@@ -135,7 +220,9 @@ DBImpl::~DBImpl() {
   while (bg_compaction_scheduled_) {
     bg_cv_.Wait();
   }
+  ReleaseReadViews();
   mutex_.Unlock();
+  delete local_view_;
 
   if (db_lock_ != NULL) {
     env_->UnlockFile(db_lock_);
@@ -143,10 +230,14 @@ DBImpl::~DBImpl() {
 
   delete versions_;
   if (mem_ != NULL) mem_->Unref();
-  if (imm_ != NULL) imm_->Unref();
+  for (size_t i = 0; i < imm_.size(); i++) {
+    imm_[i].mem->Unref();
+  }
   delete log_;
   delete logfile_;
   delete table_cache_;
+  assert(num_live_iterators_ == 0);
+  delete live_iterators_;
 
   if (owns_info_log_) {
     delete options_.info_log;
@@ -202,6 +293,10 @@ void DBImpl::DeleteObsoleteFiles() {
   std::set<uint64_t> live = pending_outputs_;
   versions_->AddLiveFiles(&live);
 
+  // Logs that are no longer needed, but may be retained for
+  // GetUpdatesSince()
+  std::vector<uint64_t> old_logs;
+
   std::vector<std::string> filenames;
   env_->GetChildren(dbname_, &filenames); // Ignoring errors on purpose
   uint64_t number;
@@ -213,6 +308,10 @@ void DBImpl::DeleteObsoleteFiles() {
         case kLogFile:
           keep = ((number >= versions_->LogNumber()) ||
                   (number == versions_->PrevLogNumber()));
+          if (!keep && options_.log_retention_bytes > 0) {
+            old_logs.push_back(number);
+            keep = true;
+          }
           break;
         case kDescriptorFile:
           // Keep my manifest file, and any newer incarnations'
@@ -245,6 +344,22 @@ void DBImpl::DeleteObsoleteFiles() {
       }
     }
   }
+
+  // Keep the newest old logs that fit in the retention limit
+  std::sort(old_logs.begin(), old_logs.end());
+  uint64_t retained = 0;
+  for (size_t i = old_logs.size(); i > 0; i--) {
+    const std::string fname = LogFileName(dbname_, old_logs[i - 1]);
+    uint64_t size = 0;
+    env_->GetFileSize(fname, &size);
+    retained += size;
+    if (retained > options_.log_retention_bytes) {
+      Log(options_.info_log, "Delete type=%d #%lld\n",
+          int(kLogFile),
+          static_cast<unsigned long long>(old_logs[i - 1]));
+      env_->DeleteFile(fname);
+    }
+  }
 }
 
 Status DBImpl::Recover(VersionEdit* edit) {
@@ -253,15 +368,19 @@ Status DBImpl::Recover(VersionEdit* edit) {
   // Ignore error from CreateDir since the creation of the DB is
   // committed only when the descriptor is created, and this directory
   // may already exist from a previous failed creation attempt.
-  env_->CreateDir(dbname_);
-  assert(db_lock_ == NULL);
-  Status s = env_->LockFile(LockFileName(dbname_), &db_lock_);
-  if (!s.ok()) {
-    return s;
+  // Readers neither create nor lock the database.
+  Status s;
+  if (!options_.read_only) {
+    env_->CreateDir(dbname_);
+    assert(db_lock_ == NULL);
+    s = env_->LockFile(LockFileName(dbname_), &db_lock_);
+    if (!s.ok()) {
+      return s;
+    }
   }
 
   if (!env_->FileExists(CurrentFileName(dbname_))) {
-    if (options_.create_if_missing) {
+    if (options_.create_if_missing && !options_.read_only) {
       s = NewDB();
       if (!s.ok()) {
         return s;
@@ -277,8 +396,9 @@ Status DBImpl::Recover(VersionEdit* edit) {
     }
   }
 
+  // Readers replay the logs into mem_ instead; see ReplayLogs()
   s = versions_->Recover();
-  if (s.ok()) {
+  if (s.ok() && !options_.read_only) {
     SequenceNumber max_sequence(0);
 
     // Recover from all newer log files than the ones named in the
@@ -384,7 +504,7 @@ Status DBImpl::RecoverLogFile(uint64_t log_number,
     WriteBatchInternal::SetContents(&batch, record);
 
     if (mem == NULL) {
-      mem = new MemTable(internal_comparator_);
+      mem = NewMemTable();
       mem->Ref();
     }
     status = WriteBatchInternal::InsertInto(&batch, mem);
@@ -461,6 +581,26 @@ Status DBImpl::WriteLevel0Table(MemTable* mem, VersionEdit* edit,
                   meta.smallest, meta.largest);
   }
 
+  // Hand the memtable's range tombstones over to the version.  Every
+  // table numbered below the new one holds only older entries.
+  if (s.ok() && mem->HasRangeTombstones()) {
+    Iterator* titer = mem->NewRangeTombstoneIterator();
+    for (titer->SeekToFirst(); titer->Valid(); titer->Next()) {
+      ParsedInternalKey ikey;
+      if (!ParseInternalKey(titer->key(), &ikey)) {
+        continue;
+      }
+      RangeTombstone t;
+      t.sequence = ikey.sequence;
+      t.start = ikey.user_key.ToString();
+      t.end = titer->value().ToString();
+      t.older_files = meta.number;
+      t.hidden_files = meta.number + 1;
+      edit->AddRangeTombstone(t);
+    }
+    delete titer;
+  }
+
   CompactionStats stats;
   stats.micros = env_->NowMicros() - start_micros;
   stats.bytes_written = meta.file_size;
@@ -470,13 +610,17 @@ Status DBImpl::WriteLevel0Table(MemTable* mem, VersionEdit* edit,
 
 Status DBImpl::CompactMemTable() {
   mutex_.AssertHeld();
-  assert(imm_ != NULL);
+  assert(!imm_.empty());
 
-  // Save the contents of the memtable as a new Table
+  // Save the contents of the oldest memtable as a new Table.  Writers
+  // may append to imm_ while the mutex is released, but only this
+  // thread removes from it.
+  MemTable* imm = imm_.front().mem;
+  const uint64_t next_log_number = imm_.front().next_log_number;
   VersionEdit edit;
   Version* base = versions_->current();
   base->Ref();
-  Status s = WriteLevel0Table(imm_, &edit, base);
+  Status s = WriteLevel0Table(imm, &edit, base);
   base->Unref();
 
   if (s.ok() && shutting_down_.Acquire_Load()) {
@@ -486,15 +630,16 @@ Status DBImpl::CompactMemTable() {
   // Replace immutable memtable with the generated Table
   if (s.ok()) {
     edit.SetPrevLogNumber(0);
-    edit.SetLogNumber(logfile_number_);  // Earlier logs no longer needed
+    edit.SetLogNumber(next_log_number);  // Earlier logs no longer needed
     s = versions_->LogAndApply(&edit, &mutex_);
   }
 
   if (s.ok()) {
     // Commit to the new state
-    imm_->Unref();
-    imm_ = NULL;
-    has_imm_.Release_Store(NULL);
+    imm->Unref();
+    imm_.pop_front();
+    has_imm_.Release_Store(imm_.empty() ? NULL : this);
+    InstallReadView();
     DeleteObsoleteFiles();
   }
 
@@ -502,6 +647,9 @@ Status DBImpl::CompactMemTable() {
 }
 
 void DBImpl::CompactRange(const Slice* begin, const Slice* end) {
+  if (options_.read_only) {
+    return;
+  }
   int max_level_with_files = 1;
   {
     MutexLock l(&mutex_);
@@ -554,6 +702,10 @@ void DBImpl::TEST_CompactRange(int level, const Slice* begin,const Slice* end) {
 }
 
 Status DBImpl::TEST_CompactMemTable() {
+  return FlushMemTable();
+}
+
+Status DBImpl::FlushMemTable() {
   MutexLock l(&mutex_);
   LoggerId self;
   AcquireLoggingResponsibility(&self);
@@ -561,10 +713,10 @@ Status DBImpl::TEST_CompactMemTable() {
   ReleaseLoggingResponsibility(&self);
   if (s.ok()) {
     // Wait until the compaction completes
-    while (imm_ != NULL && bg_error_.ok()) {
+    while (!imm_.empty() && bg_error_.ok()) {
       bg_cv_.Wait();
     }
-    if (imm_ != NULL) {
+    if (!imm_.empty()) {
       s = bg_error_;
     }
   }
@@ -577,8 +729,11 @@ void DBImpl::MaybeScheduleCompaction() {
     // Already scheduled
   } else if (shutting_down_.Acquire_Load()) {
     // DB is being deleted; no more background compactions
-  } else if (imm_ == NULL &&
+  } else if (options_.read_only) {
+    // The files belong to the process that writes the DB
+  } else if (imm_.empty() &&
              manual_compaction_ == NULL &&
+             ingestion_ == NULL &&
              !versions_->NeedsCompaction()) {
     // No work to be done
   } else {
@@ -597,6 +752,10 @@ void DBImpl::BackgroundCall() {
   if (!shutting_down_.Acquire_Load()) {
     BackgroundCompaction();
   }
+  if (!shutting_down_.Acquire_Load()) {
+    ApplyRangeTombstones();
+  }
+  InstallReadView();
   bg_compaction_scheduled_ = false;
 
   // Previous compaction may have produced too many files in a level,
@@ -608,11 +767,18 @@ void DBImpl::BackgroundCall() {
 void DBImpl::BackgroundCompaction() {
   mutex_.AssertHeld();
 
-  if (imm_ != NULL) {
+  if (!imm_.empty()) {
     CompactMemTable();
     return;
   }
 
+  if (ingestion_ != NULL) {
+    ingestion_->status = InstallIngestedFiles();
+    ingestion_->done = true;
+    ingestion_ = NULL;
+    return;
+  }
+
   Compaction* c;
   bool is_manual = (manual_compaction_ != NULL);
   InternalKey manual_end;
@@ -642,7 +808,7 @@ void DBImpl::BackgroundCompaction() {
     FileMetaData* f = c->input(0, 0);
     c->edit()->DeleteFile(c->level(), f->number);
     c->edit()->AddFile(c->level() + 1, f->number, f->file_size,
-                       f->smallest, f->largest);
+                       f->smallest, f->largest, f->global_sequence);
     status = versions_->LogAndApply(c->edit(), &mutex_);
     VersionSet::LevelSummaryStorage tmp;
     Log(options_.info_log, "Moved #%lld to level-%d %lld bytes %s: %s\n",
@@ -701,6 +867,7 @@ void DBImpl::CleanupCompaction(CompactionState* compact) {
     const CompactionState::Output& out = compact->outputs[i];
     pending_outputs_.erase(out.number);
   }
+  delete compact->tombstones;
   delete compact;
 }
 
@@ -766,7 +933,8 @@ Status DBImpl::FinishCompactionOutputFile(CompactionState* compact,
     // Verify that the table is usable
     Iterator* iter = table_cache_->NewIterator(ReadOptions(),
                                                output_number,
-                                               current_bytes);
+                                               current_bytes,
+                                               0);
     s = iter->status();
     delete iter;
     if (s.ok()) {
@@ -793,13 +961,108 @@ Status DBImpl::InstallCompactionResults(CompactionState* compact) {
   // Add compaction outputs
   compact->compaction->AddInputDeletions(compact->compaction->edit());
   const int level = compact->compaction->level();
+  uint64_t max_output_number = 0;
   for (size_t i = 0; i < compact->outputs.size(); i++) {
     const CompactionState::Output& out = compact->outputs[i];
     compact->compaction->edit()->AddFile(
         level + 1,
         out.number, out.file_size, out.smallest, out.largest);
+    max_output_number = std::max(max_output_number, out.number);
+  }
+
+  // Entries hidden by a range tombstone that this compaction did not
+  // apply may have been copied into the outputs.  Extend the tombstone
+  // so that it is kept for as long as those outputs exist.
+  const Comparator* ucmp = user_comparator();
+  const std::vector<RangeTombstone>& tombstones =
+      versions_->current()->range_tombstones();
+  for (size_t i = 0; i < tombstones.size(); i++) {
+    const RangeTombstone& t = tombstones[i];
+    if (compact->applied_tombstones.count(t.sequence) > 0 ||
+        t.hidden_files > max_output_number) {
+      continue;
+    }
+    for (size_t j = 0; j < compact->outputs.size(); j++) {
+      const CompactionState::Output& out = compact->outputs[j];
+      if (ucmp->Compare(out.smallest.user_key(), t.end) < 0 &&
+          ucmp->Compare(out.largest.user_key(), t.start) >= 0) {
+        RangeTombstone extended = t;
+        extended.hidden_files = max_output_number + 1;
+        compact->compaction->edit()->AddRangeTombstone(extended);
+        break;
+      }
+    }
+  }
+  Status s = versions_->LogAndApply(compact->compaction->edit(), &mutex_);
+  if (s.ok()) {
+    // Release the inputs before DeleteObsoleteFiles() looks for them
+    InstallReadView();
+  }
+  return s;
+}
+
+void DBImpl::ApplyRangeTombstones() {
+  mutex_.AssertHeld();
+  Version* current = versions_->current();
+  const std::vector<RangeTombstone>& tombstones = current->range_tombstones();
+  if (tombstones.empty()) {
+    return;
+  }
+  const SequenceNumber smallest_snapshot =
+      snapshots_.empty() ? versions_->LastSequence()
+                         : snapshots_.oldest()->number_;
+
+  const Comparator* ucmp = user_comparator();
+  VersionEdit edit;
+  std::set<uint64_t> dropped;
+  int forgotten = 0;
+  for (size_t i = 0; i < tombstones.size(); i++) {
+    const RangeTombstone& t = tombstones[i];
+    if (t.sequence > smallest_snapshot) {
+      // Some snapshot can still see the entries it covers
+      continue;
+    }
+    bool hides_entries = false;
+    for (int level = 0; level < config::kNumLevels; level++) {
+      for (int j = 0; j < current->NumFiles(level); j++) {
+        FileMetaData* f = current->file(level, j);
+        const Slice smallest = f->smallest.user_key();
+        const Slice largest = f->largest.user_key();
+        if (dropped.count(f->number) > 0 ||
+            ucmp->Compare(smallest, t.end) >= 0 ||
+            ucmp->Compare(largest, t.start) < 0) {
+          continue;
+        }
+        if (f->number < t.older_files &&
+            ucmp->Compare(smallest, t.start) >= 0 &&
+            ucmp->Compare(largest, t.end) < 0) {
+          // Every entry in the file is covered
+          edit.DeleteFile(level, f->number);
+          dropped.insert(f->number);
+        } else if (f->number < t.hidden_files) {
+          hides_entries = true;
+        }
+      }
+    }
+    if (!hides_entries) {
+      edit.DeleteRangeTombstone(t.sequence);
+      forgotten++;
+    }
+  }
+
+  if (dropped.empty() && forgotten == 0) {
+    return;
+  }
+  Status s = versions_->LogAndApply(&edit, &mutex_);
+  Log(options_.info_log, "Range tombstones: dropped %d files, "
+      "forgot %d tombstones: %s",
+      static_cast<int>(dropped.size()), forgotten, s.ToString().c_str());
+  if (s.ok()) {
+    InstallReadView();
+    DeleteObsoleteFiles();
+  } else if (options_.paranoid_checks && bg_error_.ok()) {
+    bg_error_ = s;
   }
-  return versions_->LogAndApply(compact->compaction->edit(), &mutex_);
 }
 
 Status DBImpl::DoCompactionWork(CompactionState* compact) {
@@ -820,12 +1083,168 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
   } else {
     compact->smallest_snapshot = snapshots_.oldest()->number_;
   }
+  compact->tombstones = new RangeTombstoneSet(user_comparator());
+  const std::vector<RangeTombstone>& tombstones =
+      versions_->current()->range_tombstones();
+  for (size_t i = 0; i < tombstones.size(); i++) {
+    const RangeTombstone& t = tombstones[i];
+    if (t.sequence <= compact->smallest_snapshot) {
+      compact->tombstones->Add(t.start, t.end, t.sequence);
+      compact->applied_tombstones.insert(t.sequence);
+    }
+  }
+  compact->tombstones->Finish(compact->smallest_snapshot);
 
-  // Release mutex while we're actually doing the compaction work
-  mutex_.Unlock();
+  std::vector<InternalKey> boundaries;
+  SplitCompaction(compact->compaction, &boundaries);
+  Status status;
+  if (boundaries.empty()) {
+    // Release mutex while we're actually doing the compaction work
+    mutex_.Unlock();
+    status = DoSubcompactionWork(compact, &imm_micros);
+  } else {
+    // Each key range gets a CompactionState of its own whose outputs are
+    // handed to "compact" afterwards, so that all of them are installed
+    // by one edit.
+    const int n = boundaries.size() + 1;
+    Log(options_.info_log, "Splitting compaction into %d key ranges", n);
+    port::CondVar done_cv(&mutex_);
+    std::vector<Subcompaction> subs(n);
+    for (int i = 0; i < n; i++) {
+      CompactionState* sub =
+          new CompactionState(compact->compaction->NewSubcompaction());
+      sub->smallest_snapshot = compact->smallest_snapshot;
+      sub->tombstones = compact->tombstones;
+      sub->begin = (i == 0) ? NULL : &boundaries[i - 1];
+      sub->end = (i == n - 1) ? NULL : &boundaries[i];
+      subs[i].db = this;
+      subs[i].compact = sub;
+      subs[i].done = false;
+      subs[i].done_cv = &done_cv;
+    }
+    mutex_.Unlock();
+
+    for (int i = 1; i < n; i++) {
+      env_->StartThread(&DBImpl::SubcompactionThread, &subs[i]);
+    }
+    // The first range is compacted by this thread, which also keeps up
+    // with memtable compactions meanwhile.
+    subs[0].status = DoSubcompactionWork(subs[0].compact, &imm_micros);
+
+    mutex_.Lock();
+    for (int i = 1; i < n; i++) {
+      while (!subs[i].done) {
+        done_cv.Wait();
+      }
+    }
+    for (int i = 0; i < n; i++) {
+      CompactionState* sub = subs[i].compact;
+      if (status.ok()) {
+        status = subs[i].status;
+      }
+      compact->outputs.insert(compact->outputs.end(),
+                              sub->outputs.begin(), sub->outputs.end());
+      compact->total_bytes += sub->total_bytes;
+      sub->outputs.clear();
+      sub->tombstones = NULL;   // Owned by compact
+      delete sub->compaction;
+      CleanupCompaction(sub);
+    }
+    mutex_.Unlock();
+  }
+
+  CompactionStats stats;
+  stats.micros = env_->NowMicros() - start_micros - imm_micros;
+  for (int which = 0; which < 2; which++) {
+    for (int i = 0; i < compact->compaction->num_input_files(which); i++) {
+      stats.bytes_read += compact->compaction->input(which, i)->file_size;
+    }
+  }
+  for (size_t i = 0; i < compact->outputs.size(); i++) {
+    stats.bytes_written += compact->outputs[i].file_size;
+  }
+
+  mutex_.Lock();
+  stats_[compact->compaction->level() + 1].Add(stats);
+
+  if (status.ok()) {
+    status = InstallCompactionResults(compact);
+  }
+  VersionSet::LevelSummaryStorage tmp;
+  Log(options_.info_log,
+      "compacted to: %s", versions_->LevelSummary(&tmp));
+  return status;
+}
+
+namespace {
+struct UserKeyLess {
+  const Comparator* ucmp;
+  explicit UserKeyLess(const Comparator* c) : ucmp(c) { }
+  bool operator()(const Slice& a, const Slice& b) const {
+    return ucmp->Compare(a, b) < 0;
+  }
+};
+}  // namespace
+
+void DBImpl::SplitCompaction(Compaction* c,
+                             std::vector<InternalKey>* boundaries) {
+  boundaries->clear();
+  std::vector<FileMetaData*> files;
+  uint64_t total = 0;
+  for (int which = 0; which < 2; which++) {
+    for (int i = 0; i < c->num_input_files(which); i++) {
+      files.push_back(c->input(which, i));
+      total += c->input(which, i)->file_size;
+    }
+  }
+  const uint64_t n = std::min<uint64_t>(options_.max_subcompactions,
+                                        total / c->MaxOutputFileSize());
+  if (n <= 1) {
+    return;
+  }
+
+  // Candidate boundaries are the smallest keys of the input files.  The
+  // input that sorts before a candidate is estimated from the files it
+  // follows, counting half of any file that it falls inside of.
+  const Comparator* ucmp = user_comparator();
+  std::vector<Slice> candidates;
+  for (size_t i = 0; i < files.size(); i++) {
+    candidates.push_back(files[i]->smallest.user_key());
+  }
+  std::sort(candidates.begin(), candidates.end(), UserKeyLess(ucmp));
+  for (size_t i = 1; i < candidates.size(); i++) {
+    const Slice& key = candidates[i];
+    if (ucmp->Compare(key, candidates[i - 1]) == 0) {
+      continue;
+    }
+    uint64_t before = 0;
+    for (size_t j = 0; j < files.size(); j++) {
+      if (ucmp->Compare(files[j]->largest.user_key(), key) < 0) {
+        before += files[j]->file_size;
+      } else if (ucmp->Compare(files[j]->smallest.user_key(), key) < 0) {
+        before += files[j]->file_size / 2;
+      }
+    }
+    if (before >= total * (boundaries->size() + 1) / n) {
+      boundaries->push_back(
+          InternalKey(key, kMaxSequenceNumber, kValueTypeForSeek));
+      if (boundaries->size() + 1 == n) {
+        break;
+      }
+    }
+  }
+}
 
+Status DBImpl::DoSubcompactionWork(CompactionState* compact,
+                                   int64_t* imm_micros) {
+  assert(compact->builder == NULL);
+  assert(compact->outfile == NULL);
   Iterator* input = versions_->MakeInputIterator(compact->compaction);
-  input->SeekToFirst();
+  if (compact->begin != NULL) {
+    input->Seek(compact->begin->Encode());
+  } else {
+    input->SeekToFirst();
+  }
   Status status;
   ParsedInternalKey ikey;
   std::string current_user_key;
@@ -833,18 +1252,22 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
   SequenceNumber last_sequence_for_key = kMaxSequenceNumber;
   for (; input->Valid() && !shutting_down_.Acquire_Load(); ) {
     // Prioritize immutable compaction work
-    if (has_imm_.NoBarrier_Load() != NULL) {
+    if (imm_micros != NULL && has_imm_.NoBarrier_Load() != NULL) {
       const uint64_t imm_start = env_->NowMicros();
       mutex_.Lock();
-      if (imm_ != NULL) {
+      if (!imm_.empty()) {
         CompactMemTable();
         bg_cv_.SignalAll();  // Wakeup MakeRoomForWrite() if necessary
       }
       mutex_.Unlock();
-      imm_micros += (env_->NowMicros() - imm_start);
+      *imm_micros += (env_->NowMicros() - imm_start);
     }
 
     Slice key = input->key();
+    if (compact->end != NULL &&
+        internal_comparator_.Compare(key, compact->end->Encode()) >= 0) {
+      break;
+    }
     if (compact->compaction->ShouldStopBefore(key) &&
         compact->builder != NULL) {
       status = FinishCompactionOutputFile(compact, input);
@@ -855,6 +1278,8 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
 
     // Handle key/value, add to state, etc.
     bool drop = false;
+    bool merge = false;
+    bool filtered = false;
     if (!ParseInternalKey(key, &ikey)) {
       // Do not hide error keys
       current_user_key.clear();
@@ -884,9 +1309,28 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
         //     few iterations of this loop (by rule (A) above).
         // Therefore this deletion marker is obsolete and can be dropped.
         drop = true;
+      } else if (compact->tombstones->Covers(ikey.user_key, ikey.sequence)) {
+        // Hidden by a range tombstone that every snapshot can see
+        drop = true;
       }
 
       last_sequence_for_key = ikey.sequence;
+      merge = (!drop && ikey.type == kTypeMerge &&
+               ikey.sequence <= compact->smallest_snapshot &&
+               options_.merge_operator != NULL);
+      if (!drop && ikey.type == kTypeValue &&
+          ikey.sequence <= compact->smallest_snapshot &&
+          options_.compaction_filter != NULL &&
+          options_.compaction_filter->Filter(ikey.user_key, input->value())) {
+        // The filter rejects the value.  Older values for the key must
+        // stay hidden, so replace it with a deletion marker unless it
+        // is obsolete like the ones dropped above.
+        if (compact->compaction->IsBaseLevelForKey(ikey.user_key)) {
+          drop = true;
+        } else {
+          filtered = true;
+        }
+      }
     }
 #if 0
     Log(options_.info_log,
@@ -898,27 +1342,24 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
         (int)last_sequence_for_key, (int)compact->smallest_snapshot);
 #endif
 
-    if (!drop) {
-      // Open output file if necessary
-      if (compact->builder == NULL) {
-        status = OpenCompactionOutputFile(compact);
-        if (!status.ok()) {
-          break;
-        }
+    if (merge) {
+      status = MergeCompactionInput(compact, input);
+      if (!status.ok()) {
+        break;
       }
-      if (compact->builder->NumEntries() == 0) {
-        compact->current_output()->smallest.DecodeFrom(key);
+      continue;
+    }
+
+    if (filtered) {
+      InternalKey deletion(ikey.user_key, ikey.sequence, kTypeDeletion);
+      status = AddCompactionOutput(compact, input, deletion.Encode(), Slice());
+      if (!status.ok()) {
+        break;
       }
-      compact->current_output()->largest.DecodeFrom(key);
-      compact->builder->Add(key, input->value());
-
-      // Close output file if it is big enough
-      if (compact->builder->FileSize() >=
-          compact->compaction->MaxOutputFileSize()) {
-        status = FinishCompactionOutputFile(compact, input);
-        if (!status.ok()) {
-          break;
-        }
+    } else if (!drop) {
+      status = AddCompactionOutput(compact, input, key, input->value());
+      if (!status.ok()) {
+        break;
       }
     }
 
@@ -937,74 +1378,279 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
   delete input;
   input = NULL;
 
-  CompactionStats stats;
-  stats.micros = env_->NowMicros() - start_micros - imm_micros;
-  for (int which = 0; which < 2; which++) {
-    for (int i = 0; i < compact->compaction->num_input_files(which); i++) {
-      stats.bytes_read += compact->compaction->input(which, i)->file_size;
+  return status;
+}
+
+Status DBImpl::MergeCompactionInput(CompactionState* compact,
+                                    Iterator* input) {
+  const MergeOperator* op = options_.merge_operator;
+  ParsedInternalKey ikey;
+  ParseInternalKey(input->key(), &ikey);
+  const std::string user_key = ikey.user_key.ToString();
+  const SequenceNumber sequence = ikey.sequence;
+
+  // Gather the operands for the key, newest first, down to the value or
+  // deletion they apply to.  Older entries have smaller sequence
+  // numbers, so every snapshot sees them the same way.
+  std::vector<std::string> keys, values;
+  size_t num_operands = 0;
+  ValueType base_type = kTypeMerge;   // Type of the oldest entry gathered
+  bool complete = true;               // Were all entries for the key seen?
+  for (; input->Valid(); input->Next()) {
+    Slice key = input->key();
+    if (!keys.empty()) {
+      if ((compact->end != NULL &&
+           internal_comparator_.Compare(key, compact->end->Encode()) >= 0) ||
+          !ParseInternalKey(key, &ikey)) {
+        complete = false;
+        break;
+      }
+      if (user_comparator()->Compare(ikey.user_key, user_key) != 0) {
+        break;
+      }
+      if (compact->tombstones->Covers(ikey.user_key, ikey.sequence)) {
+        // Hidden by a range tombstone, and so is everything older
+        base_type = kTypeDeletion;
+        input->Next();
+        break;
+      }
+    }
+    keys.push_back(key.ToString());
+    values.push_back(input->value().ToString());
+    base_type = ikey.type;
+    if (base_type != kTypeMerge) {
+      input->Next();
+      break;
     }
+    num_operands++;
+  }
+
+  // Merge into the base if there is one.  Otherwise combine the operands
+  // into one, which becomes a value if no older entries for the key can
+  // exist below this compaction.
+  const bool full = (base_type != kTypeMerge ||
+                     (complete &&
+                      compact->compaction->IsBaseLevelForKey(user_key)));
+  size_t i = num_operands;
+  std::string merged, tmp;
+  Slice existing;
+  const Slice* base = NULL;
+  if (base_type == kTypeValue) {
+    existing = values[num_operands];
+    base = &existing;
+  } else if (!full) {
+    merged = values[--i];
+    existing = merged;
+    base = &existing;
+  }
+  bool ok = true;
+  while (ok && i > 0) {
+    ok = op->Merge(user_key, base, values[--i], &tmp);
+    merged.swap(tmp);
+    existing = merged;
+    base = &existing;
+  }
+
+  if (ok) {
+    ValueType type = full ? kTypeValue : kTypeMerge;
+    if (full && options_.compaction_filter != NULL &&
+        options_.compaction_filter->Filter(user_key, merged)) {
+      if (compact->compaction->IsBaseLevelForKey(user_key)) {
+        return Status::OK();
+      }
+      type = kTypeDeletion;
+      merged.clear();
+    }
+    InternalKey merged_key(user_key, sequence, type);
+    return AddCompactionOutput(compact, input, merged_key.Encode(), merged);
   }
-  for (size_t i = 0; i < compact->outputs.size(); i++) {
-    stats.bytes_written += compact->outputs[i].file_size;
+
+  // The operator cannot merge them; keep the entries as they are.
+  Log(options_.info_log, "Merge failed for key '%s'; kept %d entries",
+      EscapeString(user_key).c_str(), static_cast<int>(keys.size()));
+  Status s;
+  for (size_t k = 0; s.ok() && k < keys.size(); k++) {
+    s = AddCompactionOutput(compact, input, keys[k], values[k]);
   }
+  return s;
+}
 
-  mutex_.Lock();
-  stats_[compact->compaction->level() + 1].Add(stats);
+Status DBImpl::AddCompactionOutput(CompactionState* compact, Iterator* input,
+                                   const Slice& key, const Slice& value) {
+  // Open output file if necessary
+  Status status;
+  if (compact->builder == NULL) {
+    status = OpenCompactionOutputFile(compact);
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  if (compact->builder->NumEntries() == 0) {
+    compact->current_output()->smallest.DecodeFrom(key);
+  }
+  compact->current_output()->largest.DecodeFrom(key);
+  compact->builder->Add(key, value);
 
-  if (status.ok()) {
-    status = InstallCompactionResults(compact);
+  // Close output file if it is big enough
+  if (compact->builder->FileSize() >=
+      compact->compaction->MaxOutputFileSize()) {
+    status = FinishCompactionOutputFile(compact, input);
   }
-  VersionSet::LevelSummaryStorage tmp;
-  Log(options_.info_log,
-      "compacted to: %s", versions_->LevelSummary(&tmp));
   return status;
 }
 
-namespace {
-struct IterState {
-  port::Mutex* mu;
-  Version* version;
-  MemTable* mem;
-  MemTable* imm;
-};
+void DBImpl::SubcompactionThread(void* arg) {
+  Subcompaction* sub = reinterpret_cast<Subcompaction*>(arg);
+  DBImpl* db = sub->db;
+  Status s = db->DoSubcompactionWork(sub->compact, NULL);
+  MutexLock l(&db->mutex_);
+  sub->status = s;
+  sub->done = true;
+  sub->done_cv->SignalAll();
+}
+
+DBImpl::ReadView* DBImpl::AcquireReadView() {
+  void* ptr = local_view_->Swap(kViewInUse);
+  assert(ptr != kViewInUse);
+  if (ptr != NULL && ptr != kViewObsolete) {
+    return reinterpret_cast<ReadView*>(ptr);
+  }
+  MutexLock l(&mutex_);
+  read_view_->Ref();
+  return read_view_;
+}
+
+void DBImpl::ReturnReadView(ReadView* view) {
+  // Cache the view for the next read, unless InstallReadView() took it
+  // back while it was in use.
+  if (!local_view_->CompareAndSwap(kViewInUse, view)) {
+    UnrefReadView(view);
+  }
+}
+
+void DBImpl::UnrefReadView(ReadView* view) {
+  if (view->Unref()) {
+    MutexLock l(&mutex_);
+    DeleteReadView(view);
+  }
+}
+
+void DBImpl::DeleteReadView(ReadView* view) {
+  mutex_.AssertHeld();
+  view->mem->Unref();
+  for (size_t i = 0; i < view->imm.size(); i++) {
+    view->imm[i]->Unref();
+  }
+  view->current->Unref();
+  delete view;
+}
+
+void DBImpl::InstallReadView() {
+  mutex_.AssertHeld();
+  Version* current = versions_->current();
+  std::vector<MemTable*> imm;
+  for (size_t i = imm_.size(); i > 0; i--) {
+    imm.push_back(imm_[i - 1].mem);
+  }
+  if (read_view_ != NULL && read_view_->mem == mem_ &&
+      read_view_->imm == imm && read_view_->current == current) {
+    return;
+  }
+  ReadView* view = new ReadView;
+  view->mem = mem_;
+  view->imm.swap(imm);
+  view->current = current;
+  view->refs.NoBarrier_Store(reinterpret_cast<void*>(1));  // For read_view_
+  mem_->Ref();
+  for (size_t i = 0; i < view->imm.size(); i++) {
+    view->imm[i]->Ref();
+  }
+  current->Ref();
+
+  ReadView* old = read_view_;
+  read_view_ = view;
+  if (old != NULL) {
+    std::vector<void*> cached;
+    local_view_->Scrape(&cached, kViewObsolete);
+    for (size_t i = 0; i < cached.size(); i++) {
+      if (cached[i] != kViewInUse && cached[i] != kViewObsolete) {
+        ReadView* v = reinterpret_cast<ReadView*>(cached[i]);
+        if (v->Unref()) DeleteReadView(v);
+      }
+    }
+    if (old->Unref()) DeleteReadView(old);
+  }
+}
+
+void DBImpl::ReleaseReadViews() {
+  mutex_.AssertHeld();
+  std::vector<void*> cached;
+  local_view_->Scrape(&cached, NULL);
+  for (size_t i = 0; i < cached.size(); i++) {
+    assert(cached[i] != kViewInUse);
+    if (cached[i] != kViewObsolete) {
+      ReadView* v = reinterpret_cast<ReadView*>(cached[i]);
+      if (v->Unref()) DeleteReadView(v);
+    }
+  }
+  if (read_view_ != NULL) {
+    if (read_view_->Unref()) DeleteReadView(read_view_);
+    read_view_ = NULL;
+  }
+}
 
-static void CleanupIteratorState(void* arg1, void* arg2) {
-  IterState* state = reinterpret_cast<IterState*>(arg1);
-  state->mu->Lock();
-  state->mem->Unref();
-  if (state->imm != NULL) state->imm->Unref();
-  state->version->Unref();
-  state->mu->Unlock();
-  delete state;
+void DBImpl::CleanupReadView(void* arg1, void* arg2) {
+  reinterpret_cast<DBImpl*>(arg1)->UnrefReadView(
+      reinterpret_cast<ReadView*>(arg2));
+}
+
+namespace {
+static void AddRangeTombstones(MemTable* mem, RangeTombstoneSet* set) {
+  if (!mem->HasRangeTombstones()) {
+    return;
+  }
+  Iterator* iter = mem->NewRangeTombstoneIterator();
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    ParsedInternalKey ikey;
+    if (ParseInternalKey(iter->key(), &ikey)) {
+      set->Add(ikey.user_key, iter->value(), ikey.sequence);
+    }
+  }
+  delete iter;
 }
 }  // namespace
 
 Iterator* DBImpl::NewInternalIterator(const ReadOptions& options,
-                                      SequenceNumber* latest_snapshot) {
-  IterState* cleanup = new IterState;
-  mutex_.Lock();
+                                      SequenceNumber* latest_snapshot,
+                                      RangeTombstoneSet* tombstones) {
+  // The iterator keeps its own reference to the view
+  ReadView* view = AcquireReadView();
+  view->Ref();
+  ReturnReadView(view);
+  // Read without mutex_: last_sequence_ only grows, and any write newer
+  // than the view is concurrent with this call.
   *latest_snapshot = versions_->LastSequence();
 
   // Collect together all needed child iterators
   std::vector<Iterator*> list;
-  list.push_back(mem_->NewIterator());
-  mem_->Ref();
-  if (imm_ != NULL) {
-    list.push_back(imm_->NewIterator());
-    imm_->Ref();
+  list.push_back(view->mem->NewIterator());
+  for (size_t i = 0; i < view->imm.size(); i++) {
+    list.push_back(view->imm[i]->NewIterator());
+  }
+  view->current->AddIterators(options, &list);
+  if (tombstones != NULL) {
+    AddRangeTombstones(view->mem, tombstones);
+    for (size_t i = 0; i < view->imm.size(); i++) {
+      AddRangeTombstones(view->imm[i], tombstones);
+    }
+    const std::vector<RangeTombstone>& t = view->current->range_tombstones();
+    for (size_t i = 0; i < t.size(); i++) {
+      tombstones->Add(t[i].start, t[i].end, t[i].sequence);
+    }
   }
-  versions_->current()->AddIterators(options, &list);
   Iterator* internal_iter =
       NewMergingIterator(&internal_comparator_, &list[0], list.size());
-  versions_->current()->Ref();
-
-  cleanup->mu = &mutex_;
-  cleanup->mem = mem_;
-  cleanup->imm = imm_;
-  cleanup->version = versions_->current();
-  internal_iter->RegisterCleanup(CleanupIteratorState, cleanup, NULL);
-
-  mutex_.Unlock();
+  internal_iter->RegisterCleanup(CleanupReadView, this, view);
   return internal_iter;
 }
 
@@ -1022,62 +1668,125 @@ Status DBImpl::Get(const ReadOptions& options,
                    const Slice& key,
                    std::string* value) {
   Status s;
-  MutexLock l(&mutex_);
+  ReadView* view = AcquireReadView();
   SequenceNumber snapshot;
   if (options.snapshot != NULL) {
     snapshot = reinterpret_cast<const SnapshotImpl*>(options.snapshot)->number_;
   } else {
+    // Read without mutex_: last_sequence_ only grows, and any write newer
+    // than the view is concurrent with this call.
     snapshot = versions_->LastSequence();
   }
 
-  MemTable* mem = mem_;
-  MemTable* imm = imm_;
-  Version* current = versions_->current();
-  mem->Ref();
-  if (imm != NULL) imm->Ref();
-  current->Ref();
+  MemTable* mem = view->mem;
+  const std::vector<MemTable*>& imm = view->imm;
+  Version* current = view->current;
 
   bool have_stat_update = false;
   Version::GetStats stats;
+  SequenceNumber seq = 0;
+  MergeOperandList operands;
 
-  // Unlock while reading from files and memtables
   {
-    mutex_.Unlock();
-    // First look in the memtable, then in the immutable memtable (if any).
+    // First look in the memtable, then in the immutable memtables from
+    // newest to oldest.
     LookupKey lkey(key, snapshot);
-    if (mem->Get(lkey, value, &s)) {
-      // Done
-    } else if (imm != NULL && imm->Get(lkey, value, &s)) {
-      // Done
-    } else {
-      s = current->Get(options, lkey, value, &stats);
+    bool found = mem->Get(lkey, value, &s, &seq, &operands);
+    for (size_t i = 0; !found && i < imm.size(); i++) {
+      found = imm[i]->Get(lkey, value, &s, &seq, &operands);
+    }
+    if (!found) {
+      s = current->Get(options, lkey, value, &stats, &seq, &operands);
       have_stat_update = true;
     }
-    mutex_.Lock();
+    if (s.ok() || !operands.empty()) {
+      // The value and operands are hidden if a newer range tombstone
+      // covers them
+      SequenceNumber covering = std::max(
+          mem->MaxCoveringTombstone(key, snapshot),
+          current->MaxCoveringTombstone(key, snapshot));
+      for (size_t i = 0; i < imm.size(); i++) {
+        covering = std::max(covering,
+                            imm[i]->MaxCoveringTombstone(key, snapshot));
+      }
+      if (s.ok() && covering > seq) {
+        s = Status::NotFound(Slice());
+      }
+      operands.DropOlderThan(covering);
+    }
+    if (!operands.empty() && (s.ok() || s.IsNotFound())) {
+      std::string existing;
+      Slice existing_slice;
+      if (s.ok()) {
+        existing.swap(*value);
+        existing_slice = existing;
+      }
+      s = operands.Apply(options_.merge_operator, key,
+                         s.ok() ? &existing_slice : NULL, value);
+    }
+    if (s.ok() && options_.compaction_filter_on_read &&
+        options_.compaction_filter != NULL &&
+        options_.compaction_filter->Filter(key, *value)) {
+      s = Status::NotFound(Slice());
+    }
   }
 
-  if (have_stat_update && current->UpdateStats(stats)) {
-    MaybeScheduleCompaction();
+  // allowed_seeks belongs to the version and is guarded by mutex_.  Only
+  // reads that had to look in more than one file charge it.
+  if (have_stat_update && stats.seek_file != NULL) {
+    MutexLock l(&mutex_);
+    if (current->UpdateStats(stats)) {
+      MaybeScheduleCompaction();
+    }
   }
-  mem->Unref();
-  if (imm != NULL) imm->Unref();
-  current->Unref();
+  ReturnReadView(view);
   return s;
 }
 
 Iterator* DBImpl::NewIterator(const ReadOptions& options) {
   SequenceNumber latest_snapshot;
-  Iterator* internal_iter = NewInternalIterator(options, &latest_snapshot);
-  return NewDBIterator(
-      &dbname_, env_, user_comparator(), internal_iter,
+  RangeTombstoneSet* tombstones = new RangeTombstoneSet(user_comparator());
+  Iterator* internal_iter = NewInternalIterator(options, &latest_snapshot,
+                                                tombstones);
+  const SequenceNumber sequence =
       (options.snapshot != NULL
        ? reinterpret_cast<const SnapshotImpl*>(options.snapshot)->number_
-       : latest_snapshot));
+       : latest_snapshot);
+  tombstones->Finish(sequence);
+  Iterator* result = NewDBIterator(
+      &dbname_, env_, user_comparator(), internal_iter, sequence, tombstones,
+      options_.merge_operator,
+      options_.compaction_filter_on_read ? options_.compaction_filter : NULL);
+
+  LiveIterator* live = new LiveIterator;
+  live->created_micros = env_->NowMicros();
+  {
+    MutexLock l(&iterators_mutex_);
+    live->next = live_iterators_;
+    live->prev = live_iterators_->prev;
+    live->prev->next = live;
+    live->next->prev = live;
+    num_live_iterators_++;
+  }
+  result->RegisterCleanup(CleanupLiveIterator, this, live);
+  return result;
+}
+
+void DBImpl::CleanupLiveIterator(void* arg1, void* arg2) {
+  DBImpl* db = reinterpret_cast<DBImpl*>(arg1);
+  LiveIterator* live = reinterpret_cast<LiveIterator*>(arg2);
+  {
+    MutexLock l(&db->iterators_mutex_);
+    live->prev->next = live->next;
+    live->next->prev = live->prev;
+    db->num_live_iterators_--;
+  }
+  delete live;
 }
 
 const Snapshot* DBImpl::GetSnapshot() {
   MutexLock l(&mutex_);
-  return snapshots_.New(versions_->LastSequence());
+  return snapshots_.New(versions_->LastSequence(), env_->NowMicros());
 }
 
 void DBImpl::ReleaseSnapshot(const Snapshot* s) {
@@ -1111,6 +1820,13 @@ void DBImpl::ReleaseLoggingResponsibility(LoggerId* self) {
 }
 
 Status DBImpl::Write(const WriteOptions& options, WriteBatch* updates) {
+  if (options_.read_only) {
+    return Status::NotSupported("read-only database");
+  }
+  if (options_.allow_concurrent_memtable_write) {
+    return ConcurrentWrite(options, updates);
+  }
+
   Status status;
   MutexLock l(&mutex_);
   LoggerId self;
@@ -1144,6 +1860,87 @@ Status DBImpl::Write(const WriteOptions& options, WriteBatch* updates) {
   return status;
 }
 
+struct DBImpl::PendingWrite {
+  SequenceNumber last_sequence;
+  bool done;        // Batch has been applied to the memtable
+  bool published;   // Removed from pending_writes_ and made visible
+};
+
+Status DBImpl::ConcurrentWrite(const WriteOptions& options,
+                               WriteBatch* updates) {
+  Status status;
+  MutexLock l(&mutex_);
+  LoggerId self;
+  AcquireLoggingResponsibility(&self);
+  status = MakeRoomForWrite(false);  // May temporarily release lock and wait
+  if (!status.ok()) {
+    ReleaseLoggingResponsibility(&self);
+    return status;
+  }
+
+  // Sequence numbers are handed out past any writes still in flight
+  uint64_t last_sequence = pending_writes_.empty()
+      ? versions_->LastSequence()
+      : pending_writes_.back()->last_sequence;
+  WriteBatchInternal::SetSequence(updates, last_sequence + 1);
+  last_sequence += WriteBatchInternal::Count(updates);
+
+  PendingWrite pending;
+  pending.last_sequence = last_sequence;
+  pending.done = false;
+  pending.published = false;
+  pending_writes_.push_back(&pending);
+
+  // mem_ cannot be switched out while we are pending (MakeRoomForWrite
+  // waits for pending_writes_ to drain), so it is safe to use unlocked.
+  MemTable* mem = mem_;
+  {
+    assert(logger_ == &self);
+    mutex_.Unlock();
+    status = log_->AddRecord(WriteBatchInternal::Contents(updates));
+    if (status.ok() && options.sync) {
+      status = logfile_->Sync();
+    }
+    mutex_.Lock();
+    assert(logger_ == &self);
+  }
+
+  // Let the next writer log while we apply our batch
+  ReleaseLoggingResponsibility(&self);
+  if (status.ok()) {
+    mutex_.Unlock();
+    status = WriteBatchInternal::InsertIntoConcurrently(updates, mem);
+    mutex_.Lock();
+  }
+
+  // Publish every leading write that has finished, then wait until our
+  // own write is visible so that a subsequent read observes it.
+  pending.done = true;
+  while (!pending_writes_.empty() && pending_writes_.front()->done) {
+    versions_->SetLastSequence(pending_writes_.front()->last_sequence);
+    pending_writes_.front()->published = true;
+    pending_writes_.pop_front();
+  }
+  pending_cv_.SignalAll();
+  while (!pending.published) {
+    pending_cv_.Wait();
+  }
+  return status;
+}
+
+MemTable* DBImpl::NewMemTable() const {
+  return new MemTable(internal_comparator_, options_.arena_block_size,
+                      options_.memtable_huge_pages);
+}
+
+size_t DBImpl::ImmutableMemoryUsage() const {
+  size_t usage = 0;
+  for (size_t i = 0; i < imm_.size(); i++) {
+    usage += imm_[i].mem->ApproximateMemoryUsage();
+  }
+  return usage;
+}
+
 // REQUIRES: mutex_ is held
 // REQUIRES: this thread is the current logger
 Status DBImpl::MakeRoomForWrite(bool force) {
@@ -1173,14 +1970,23 @@ Status DBImpl::MakeRoomForWrite(bool force) {
                (mem_->ApproximateMemoryUsage() <= options_.write_buffer_size)) {
       // There is room in current memtable
       break;
-    } else if (imm_ != NULL) {
-      // We have filled up the current memtable, but the previous
-      // one is still being compacted, so we wait.
+    } else if (!imm_.empty() &&
+               (imm_.size() >=
+                static_cast<size_t>(options_.max_immutable_memtables) ||
+                (options_.max_immutable_memtable_bytes > 0 &&
+                 ImmutableMemoryUsage() + mem_->ApproximateMemoryUsage() >
+                 options_.max_immutable_memtable_bytes))) {
+      // We have filled up the current memtable, but as many earlier
+      // ones as we may keep are still waiting to be compacted, so we wait.
       bg_cv_.Wait();
     } else if (versions_->NumLevelFiles(0) >= config::kL0_StopWritesTrigger) {
       // There are too many level-0 files.
       Log(options_.info_log, "waiting...\n");
       bg_cv_.Wait();
+    } else if (!pending_writes_.empty()) {
+      // Earlier writers are still inserting into mem_; let them finish
+      // before it becomes immutable.
+      pending_cv_.Wait();
     } else {
       // Attempt to switch to a new memtable and trigger compaction of old
       assert(versions_->PrevLogNumber() == 0);
@@ -1195,10 +2001,14 @@ Status DBImpl::MakeRoomForWrite(bool force) {
       logfile_ = lfile;
       logfile_number_ = new_log_number;
       log_ = new log::Writer(lfile);
-      imm_ = mem_;
-      has_imm_.Release_Store(imm_);
-      mem_ = new MemTable(internal_comparator_);
+      ImmutableMemTable imm;
+      imm.mem = mem_;
+      imm.next_log_number = new_log_number;
+      imm_.push_back(imm);
+      has_imm_.Release_Store(this);
+      mem_ = NewMemTable();
       mem_->Ref();
+      InstallReadView();
       force = false;   // Do not force another compaction if have room
       MaybeScheduleCompaction();
     }
@@ -1255,6 +2065,35 @@ bool DBImpl::GetProperty(const Slice& property, std::string* value) {
   } else if (in == "sstables") {
     *value = versions_->current()->DebugString();
     return true;
+  } else if (in == "num-immutable-memtables") {
+    char buf[50];
+    snprintf(buf, sizeof(buf), "%d", static_cast<int>(imm_.size()));
+    value->append(buf);
+    return true;
+  } else if (in == "approximate-memory-usage") {
+    size_t total_usage = mem_->ApproximateMemoryUsage() +
+                         ImmutableMemoryUsage();
+    char buf[50];
+    snprintf(buf, sizeof(buf), "%llu",
+             static_cast<unsigned long long>(total_usage));
+    value->append(buf);
+    return true;
+  } else if (in == "num-snapshots") {
+    AppendNumberTo(value, snapshots_.count());
+    return true;
+  } else if (in == "oldest-snapshot-age") {
+    AppendNumberTo(value, snapshots_.empty() ? 0 : AgeInSeconds(
+        env_->NowMicros(), snapshots_.oldest()->created_micros_));
+    return true;
+  } else if (in == "num-iterators") {
+    MutexLock il(&iterators_mutex_);
+    AppendNumberTo(value, num_live_iterators_);
+    return true;
+  } else if (in == "oldest-iterator-age") {
+    MutexLock il(&iterators_mutex_);
+    AppendNumberTo(value, num_live_iterators_ == 0 ? 0 : AgeInSeconds(
+        env_->NowMicros(), live_iterators_->next->created_micros));
+    return true;
   }
 
   return false;
@@ -1286,6 +2125,626 @@ void DBImpl::GetApproximateSizes(
   }
 }
 
+Status DBImpl::Warmup(const ReadOptions& options,
+                      int max_level, uint64_t max_bytes,
+                      void (*progress)(void* arg, uint64_t done,
+                                       uint64_t total),
+                      void* arg) {
+  // Pick the files to load while holding the lock; the version
+  // reference keeps them from being deleted while we read them.
+  std::vector<FileMetaData> files;
+  uint64_t total = 0;
+  Version* v;
+  {
+    MutexLock l(&mutex_);
+    v = versions_->current();
+    v->Ref();
+    for (int level = 0;
+         level <= max_level && level < config::kNumLevels;
+         level++) {
+      for (int i = 0; i < v->NumFiles(level); i++) {
+        const FileMetaData* f = v->file(level, i);
+        if (max_bytes > 0 && total + f->file_size > max_bytes) {
+          level = config::kNumLevels;  // Done
+          break;
+        }
+        files.push_back(*f);
+        total += f->file_size;
+      }
+    }
+  }
+
+  Status s;
+  uint64_t done = 0;
+  for (size_t i = 0; i < files.size() && s.ok(); i++) {
+    s = table_cache_->Prefetch(options, files[i].number, files[i].file_size);
+    done += files[i].file_size;
+    if (s.ok() && progress != NULL) {
+      (*progress)(arg, done, total);
+    }
+  }
+
+  {
+    MutexLock l(&mutex_);
+    v->Unref();
+  }
+  return s;
+}
+
+namespace {
+// Orders the indexes of ingested files by their smallest key.
+struct BySmallestKey {
+  const InternalKeyComparator* icmp;
+  const std::vector<FileMetaData>* files;
+
+  bool operator()(size_t a, size_t b) const {
+    return icmp->Compare((*files)[a].smallest, (*files)[b].smallest) < 0;
+  }
+};
+}  // namespace
+
+// Find the size and the key range of the table file "fname", which must
+// only hold values with sequence number zero.  *recorded is set to the
+// global sequence number that an earlier ingestion appended to it, if
+// any.
+static Status ReadIngestedFile(const Options& options,
+                               const std::string& fname,
+                               FileMetaData* meta,
+                               SequenceNumber* recorded) {
+  Env* env = options.env;
+  Status s = env->GetFileSize(fname, &meta->file_size);
+  RandomAccessFile* file = NULL;
+  if (s.ok()) {
+    s = env->NewRandomAccessFile(fname, &file);
+  }
+  Table* table = NULL;
+  if (s.ok()) {
+    s = Table::Open(options, file, meta->file_size, &table);
+  }
+  if (s.ok()) {
+    s = ReadGlobalSequence(file, meta->file_size, recorded);
+  }
+  if (s.ok()) {
+    Iterator* iter = table->NewIterator(ReadOptions());
+    ParsedInternalKey first, last;
+    iter->SeekToFirst();
+    if (iter->Valid()) {
+      meta->smallest.DecodeFrom(iter->key());
+      iter->SeekToLast();
+    }
+    if (!iter->status().ok()) {
+      s = iter->status();
+    } else if (!iter->Valid()) {
+      s = Status::InvalidArgument(fname, "no entries");
+    } else {
+      meta->largest.DecodeFrom(iter->key());
+      if (!ParseInternalKey(meta->smallest.Encode(), &first) ||
+          !ParseInternalKey(meta->largest.Encode(), &last) ||
+          first.sequence != 0 || first.type != kTypeValue ||
+          last.sequence != 0 || last.type != kTypeValue) {
+        s = Status::InvalidArgument(fname, "not written by TableFileWriter");
+      }
+    }
+    delete iter;
+  }
+  delete table;
+  delete file;
+  return s;
+}
+
+static Status CopyTableFile(Env* env, const std::string& src,
+                            const std::string& target) {
+  SequentialFile* in;
+  Status s = env->NewSequentialFile(src, &in);
+  if (!s.ok()) {
+    return s;
+  }
+  WritableFile* out;
+  s = env->NewWritableFile(target, &out);
+  if (s.ok()) {
+    const size_t kBufferSize = 65536;
+    char* buffer = new char[kBufferSize];
+    while (s.ok()) {
+      Slice data;
+      s = in->Read(kBufferSize, &data, buffer);
+      if (!s.ok() || data.empty()) {
+        break;
+      }
+      s = out->Append(data);
+    }
+    delete[] buffer;
+    if (s.ok()) {
+      s = out->Sync();
+    }
+    if (s.ok()) {
+      s = out->Close();
+    }
+    delete out;
+  }
+  delete in;
+  return s;
+}
+
+// Returns true iff "mem" holds an entry or a range tombstone for a user
+// key in [smallest,largest].
+static bool MemTableOverlaps(MemTable* mem, const Comparator* ucmp,
+                             const Slice& smallest, const Slice& largest) {
+  Iterator* iter = mem->NewIterator();
+  LookupKey lkey(smallest, kMaxSequenceNumber);
+  iter->Seek(lkey.internal_key());
+  bool overlaps = iter->Valid() &&
+      ucmp->Compare(ExtractUserKey(iter->key()), largest) <= 0;
+  delete iter;
+  if (!overlaps && mem->HasRangeTombstones()) {
+    iter = mem->NewRangeTombstoneIterator();
+    for (iter->SeekToFirst(); iter->Valid() && !overlaps; iter->Next()) {
+      overlaps = ucmp->Compare(ExtractUserKey(iter->key()), largest) <= 0 &&
+                 ucmp->Compare(iter->value(), smallest) > 0;
+    }
+    delete iter;
+  }
+  return overlaps;
+}
+
+Status DBImpl::IngestFiles(const std::vector<std::string>& files) {
+  if (options_.read_only) {
+    return Status::NotSupported("read-only database");
+  }
+  Ingestion ingestion;
+  ingestion.done = false;
+  std::vector<FileMetaData>& metas = ingestion.files;
+  metas.resize(files.size());
+  std::vector<SequenceNumber> recorded(files.size());
+  Status s;
+  for (size_t i = 0; i < files.size() && s.ok(); i++) {
+    s = ReadIngestedFile(options_, files[i], &metas[i], &recorded[i]);
+  }
+  if (!s.ok() || files.empty()) {
+    return s;
+  }
+
+  // The files must not overlap each other
+  std::vector<size_t> order(files.size());
+  for (size_t i = 0; i < order.size(); i++) {
+    order[i] = i;
+  }
+  BySmallestKey cmp;
+  cmp.icmp = &internal_comparator_;
+  cmp.files = &metas;
+  std::sort(order.begin(), order.end(), cmp);
+  for (size_t i = 1; i < order.size(); i++) {
+    const FileMetaData& prev = metas[order[i - 1]];
+    const FileMetaData& next = metas[order[i]];
+    if (user_comparator()->Compare(prev.largest.user_key(),
+                                   next.smallest.user_key()) >= 0) {
+      return Status::InvalidArgument(files[order[i]],
+                                     "overlaps another ingested file");
+    }
+  }
+
+  MutexLock l(&mutex_);
+
+  // The files take the next sequence number, so hold off writers until
+  // they are installed
+  LoggerId self;
+  AcquireLoggingResponsibility(&self);
+  while (!pending_writes_.empty()) {
+    pending_cv_.Wait();
+  }
+
+  // Flush the memtables if they hold any of the keys, so that every
+  // older version of them is in a table file below the ingested ones
+  bool overlaps = false;
+  for (size_t i = 0; i < metas.size() && !overlaps; i++) {
+    const Slice smallest = metas[i].smallest.user_key();
+    const Slice largest = metas[i].largest.user_key();
+    overlaps = MemTableOverlaps(mem_, user_comparator(), smallest, largest);
+    for (size_t j = 0; j < imm_.size() && !overlaps; j++) {
+      overlaps = MemTableOverlaps(imm_[j].mem, user_comparator(),
+                                  smallest, largest);
+    }
+  }
+  if (overlaps) {
+    s = MakeRoomForWrite(true /* force compaction */);
+    while (s.ok() && !imm_.empty() && bg_error_.ok()) {
+      bg_cv_.Wait();
+    }
+    if (s.ok() && !imm_.empty()) {
+      s = bg_error_;
+    }
+  }
+
+  // Numbered after any table flushed above, so that the files are the
+  // newest in level 0 as well
+  size_t numbered = 0;
+  for (; numbered < metas.size() && s.ok(); numbered++) {
+    metas[numbered].number = versions_->NewFileNumber();
+    pending_outputs_.insert(metas[numbered].number);
+  }
+  ingestion.sequence = versions_->LastSequence() + 1;
+
+  // Link (or copy) the files into the database without holding mutex_,
+  // and record the sequence number in each of them so that RepairDB()
+  // can recover it.  A file that already records one is shared with
+  // another database, so it is copied rather than appended to again.
+  mutex_.Unlock();
+  for (size_t i = 0; i < files.size() && s.ok(); i++) {
+    const std::string fname = TableFileName(dbname_, metas[i].number);
+    s = Status::NotSupported("LinkFile");
+    if (recorded[i] == 0) {
+      s = env_->LinkFile(files[i], fname);
+    }
+    if (!s.ok()) {
+      s = CopyTableFile(env_, files[i], fname);
+    }
+    if (s.ok()) {
+      s = AppendGlobalSequence(env_, fname, ingestion.sequence,
+                               &metas[i].file_size);
+    }
+  }
+  mutex_.Lock();
+
+  if (s.ok()) {
+    // Only the background thread changes the version, so it installs
+    // the files
+    while (ingestion_ != NULL) {
+      bg_cv_.Wait();
+    }
+    ingestion_ = &ingestion;
+    MaybeScheduleCompaction();
+    while (!ingestion.done) {
+      bg_cv_.Wait();
+    }
+    s = ingestion.status;
+  }
+  ReleaseLoggingResponsibility(&self);
+  for (size_t i = 0; i < numbered; i++) {
+    pending_outputs_.erase(metas[i].number);
+    if (!s.ok()) {
+      env_->DeleteFile(TableFileName(dbname_, metas[i].number));
+    }
+  }
+  return s;
+}
+
+Status DBImpl::Checkpoint(const std::string& dir) {
+  if (options_.read_only) {
+    return Status::NotSupported("read-only database");
+  }
+  if (env_->FileExists(CurrentFileName(dir))) {
+    return Status::InvalidArgument(dir, "exists");
+  }
+  env_->CreateDir(dir);  // Ignore error: the directory may already exist
+
+  // Once the memtables are flushed, the table files hold every write
+  // made so far and no log needs to be copied
+  Status s = FlushMemTable();
+  if (!s.ok()) {
+    return s;
+  }
+
+  std::string record;
+  std::vector<uint64_t> files;
+  uint64_t manifest_number;
+  Version* current;
+  {
+    MutexLock l(&mutex_);
+    // A referenced version keeps its files from being deleted by
+    // compactions while they are linked
+    current = versions_->current();
+    current->Ref();
+    manifest_number = versions_->NewFileNumber();
+    versions_->EncodeCheckpoint(&record, &files);
+  }
+
+  for (size_t i = 0; s.ok() && i < files.size(); i++) {
+    const std::string src = TableFileName(dbname_, files[i]);
+    const std::string target = TableFileName(dir, files[i]);
+    s = env_->LinkFile(src, target);
+    if (!s.ok()) {
+      s = CopyTableFile(env_, src, target);
+    }
+  }
+
+  if (s.ok()) {
+    const std::string manifest = DescriptorFileName(dir, manifest_number);
+    WritableFile* file;
+    s = env_->NewWritableFile(manifest, &file);
+    if (s.ok()) {
+      log::Writer log(file);
+      s = log.AddRecord(record);
+      if (s.ok()) {
+        s = file->Sync();
+      }
+      if (s.ok()) {
+        s = file->Close();
+      }
+      delete file;
+    }
+    if (s.ok()) {
+      s = SetCurrentFile(env_, dir, manifest_number);
+    }
+  }
+
+  MutexLock l(&mutex_);
+  current->Unref();
+  Log(options_.info_log, "Checkpoint to %s of %d files: %s\n",
+      dir.c_str(), static_cast<int>(files.size()), s.ToString().c_str());
+  return s;
+}
+
+namespace {
+struct UpdatesReporter : public log::Reader::Reporter {
+  Status status;
+  virtual void Corruption(size_t bytes, const Status& s) {
+    if (this->status.ok()) this->status = s;
+  }
+};
+
+// Read the sequence number of the first batch in a log file.  Returns
+// false if the log is empty or cannot be read.
+static bool FirstLogSequence(Env* env, const std::string& fname,
+                             SequenceNumber* sequence) {
+  SequentialFile* file;
+  if (!env->NewSequentialFile(fname, &file).ok()) {
+    return false;
+  }
+  UpdatesReporter reporter;
+  log::Reader reader(file, &reporter, true/*checksum*/, 0/*initial_offset*/);
+  Slice record;
+  std::string scratch;
+  bool found = false;
+  while (!found && reader.ReadRecord(&record, &scratch)) {
+    if (record.size() >= 12) {
+      *sequence = DecodeFixed64(record.data());
+      found = true;
+    }
+  }
+  delete file;
+  return found;
+}
+}  // namespace
+
+Status DBImpl::GetUpdatesSince(uint64_t sequence, size_t max_bytes,
+                               std::vector<std::string>* updates) {
+  // Batches after the latest sequence may still be being logged
+  SequenceNumber last;
+  {
+    MutexLock l(&mutex_);
+    last = versions_->LastSequence();
+  }
+  if (sequence > last) {
+    return Status::OK();
+  }
+
+  std::vector<std::string> filenames;
+  Status s = env_->GetChildren(dbname_, &filenames);
+  if (!s.ok()) {
+    return s;
+  }
+  std::vector<uint64_t> logs;
+  uint64_t number;
+  FileType type;
+  for (size_t i = 0; i < filenames.size(); i++) {
+    if (ParseFileName(filenames[i], &number, &type) && type == kLogFile) {
+      logs.push_back(number);
+    }
+  }
+  std::sort(logs.begin(), logs.end());
+
+  // Start from the newest log whose first batch is not after "sequence"
+  size_t start = logs.size();
+  for (size_t i = logs.size(); i > 0; i--) {
+    SequenceNumber first;
+    if (FirstLogSequence(env_, LogFileName(dbname_, logs[i - 1]), &first) &&
+        first <= std::max<uint64_t>(sequence, 1)) {
+      start = i - 1;
+      break;
+    }
+  }
+  if (start == logs.size()) {
+    return Status::NotFound("updates are no longer logged");
+  }
+
+  // Sequence numbers taken by IngestFiles() are never logged, so the
+  // batches read skip them
+  const size_t returned = updates->size();
+  size_t bytes = 0;
+  SequenceNumber next = 0;    // Follows the last batch read
+  bool done = false;
+  bool gap = false;
+  for (size_t i = start; !done && i < logs.size(); i++) {
+    SequentialFile* file;
+    s = env_->NewSequentialFile(LogFileName(dbname_, logs[i]), &file);
+    if (!s.ok()) {
+      return s;
+    }
+    UpdatesReporter reporter;
+    log::Reader reader(file, &reporter, true/*checksum*/, 0/*initial_offset*/);
+    Slice record;
+    std::string scratch;
+    while (!done && reader.ReadRecord(&record, &scratch)) {
+      if (record.size() < 12) {
+        reporter.Corruption(record.size(),
+                            Status::Corruption("log record too small"));
+        continue;
+      }
+      const SequenceNumber first = DecodeFixed64(record.data());
+      if (next != 0 && next < first && next <= last && first > sequence) {
+        gap = done = true;
+        break;
+      }
+      if (first > last) {
+        done = true;
+        break;
+      }
+      next = first + DecodeFixed32(record.data() + 8);
+      if (next <= sequence) {
+        continue;
+      }
+      updates->push_back(record.ToString());
+      bytes += record.size();
+      done = (max_bytes > 0 && bytes >= max_bytes) || next > last;
+    }
+    delete file;
+
+    // The tail of the newest log may be a batch that is still being
+    // written
+    if (!reporter.status.ok() && (i + 1 < logs.size() || next <= last)) {
+      return reporter.status;
+    }
+  }
+  if (!done && next <= last) {
+    gap = true;
+  }
+
+  // Return the batches before the gap, and NotFound once it is reached
+  if (gap && updates->size() == returned) {
+    std::string first;
+    AppendNumberTo(&first, std::max(next, sequence));
+    return Status::NotFound("updates were ingested rather than logged",
+                            first);
+  }
+  return Status::OK();
+}
+
+Status DBImpl::ReplayLogs() {
+  mutex_.AssertHeld();
+  assert(options_.read_only);
+
+  // Once the writer has written out the memtables of the older logs,
+  // start over from the logs the descriptor still needs
+  const uint64_t min_log = versions_->LogNumber();
+  if (min_log != replay_min_log_) {
+    mem_->Unref();
+    mem_ = NewMemTable();
+    mem_->Ref();
+    replay_min_log_ = min_log;
+    replay_log_ = 0;
+    replay_records_ = 0;
+  }
+
+  std::vector<std::string> filenames;
+  Status s = env_->GetChildren(dbname_, &filenames);
+  if (!s.ok()) {
+    return s;
+  }
+  std::vector<uint64_t> logs;
+  uint64_t number;
+  FileType type;
+  for (size_t i = 0; i < filenames.size(); i++) {
+    if (ParseFileName(filenames[i], &number, &type) && type == kLogFile &&
+        number >= min_log && number >= replay_log_) {
+      logs.push_back(number);
+    }
+  }
+  std::sort(logs.begin(), logs.end());
+
+  // Resume after the records of the newest log replayed so far.  As in
+  // GetUpdatesSince(), a record that cannot be read yet ends the log.
+  SequenceNumber max_sequence = 0;
+  for (size_t i = 0; i < logs.size(); i++) {
+    SequentialFile* file;
+    s = env_->NewSequentialFile(LogFileName(dbname_, logs[i]), &file);
+    if (!s.ok()) {
+      return s;
+    }
+    const uint64_t skip = (logs[i] == replay_log_) ? replay_records_ : 0;
+    uint64_t records = 0;
+    UpdatesReporter reporter;
+    log::Reader reader(file, &reporter, true/*checksum*/, 0/*initial_offset*/);
+    Slice record;
+    std::string scratch;
+    WriteBatch batch;
+    while (reader.ReadRecord(&record, &scratch) && reporter.status.ok()) {
+      if (records++ < skip || record.size() < 12) {
+        continue;
+      }
+      WriteBatchInternal::SetContents(&batch, record);
+      s = WriteBatchInternal::InsertInto(&batch, mem_);
+      if (!s.ok()) {
+        break;
+      }
+      const SequenceNumber last_seq =
+          WriteBatchInternal::Sequence(&batch) +
+          WriteBatchInternal::Count(&batch) - 1;
+      if (last_seq > max_sequence) {
+        max_sequence = last_seq;
+      }
+    }
+    delete file;
+    if (!s.ok()) {
+      return s;
+    }
+    replay_log_ = logs[i];
+    replay_records_ = records;
+  }
+
+  if (versions_->LastSequence() < max_sequence) {
+    versions_->SetLastSequence(max_sequence);
+  }
+  return s;
+}
+
+Status DBImpl::CatchUp() {
+  if (!options_.read_only) {
+    return Status::NotSupported("CatchUp() needs a read-only database");
+  }
+  MutexLock l(&mutex_);
+  Status s = versions_->CatchUp();
+  if (s.ok()) {
+    s = ReplayLogs();
+  }
+  InstallReadView();
+  return s;
+}
+
+uint64_t DBImpl::GetLatestSequenceNumber() {
+  MutexLock l(&mutex_);
+  return versions_->LastSequence();
+}
+
+Status DBImpl::InstallIngestedFiles() {
+  mutex_.AssertHeld();
+  const std::vector<FileMetaData>& files = ingestion_->files;
+  Version* current = versions_->current();
+  VersionEdit edit;
+  for (size_t i = 0; i < files.size(); i++) {
+    const FileMetaData& f = files[i];
+    const Slice smallest = f.smallest.user_key();
+    const Slice largest = f.largest.user_key();
+
+    // The deepest level that no level above it overlaps, so that reads
+    // find the file before any older version of its keys.  Level 0 if
+    // it overlaps there, where it is the newest file.
+    int level = 0;
+    if (!current->OverlapInLevel(0, &smallest, &largest)) {
+      while (level + 1 < config::kNumLevels &&
+             !current->OverlapInLevel(level + 1, &smallest, &largest)) {
+        level++;
+      }
+    }
+    edit.AddFile(level, f.number, f.file_size,
+                 InternalKey(smallest, ingestion_->sequence, kTypeValue),
+                 InternalKey(largest, ingestion_->sequence, kTypeValue),
+                 ingestion_->sequence);
+  }
+
+  // Record the sequence number, but only make it current once the files
+  // are readable, so that no snapshot of it misses them
+  edit.SetLastSequence(ingestion_->sequence);
+  Status s = versions_->LogAndApply(&edit, &mutex_);
+  VersionSet::LevelSummaryStorage tmp;
+  Log(options_.info_log, "Ingested %d files: %s %s",
+      static_cast<int>(files.size()), s.ToString().c_str(),
+      versions_->LevelSummary(&tmp));
+  if (s.ok()) {
+    InstallReadView();
+    versions_->SetLastSequence(ingestion_->sequence);
+  }
+  return s;
+}
+
 // Default implementations of convenience methods that subclasses of DB
 // can call if they wish
 Status DB::Put(const WriteOptions& opt, const Slice& key, const Slice& value) {
@@ -1300,6 +2759,41 @@ Status DB::Delete(const WriteOptions& opt, const Slice& key) {
   return Write(opt, &batch);
 }
 
+Status DB::DeleteRange(const WriteOptions& opt,
+                       const Slice& start, const Slice& limit) {
+  WriteBatch batch;
+  batch.DeleteRange(start, limit);
+  return Write(opt, &batch);
+}
+
+Status DB::Merge(const WriteOptions& opt,
+                 const Slice& key, const Slice& value) {
+  WriteBatch batch;
+  batch.Merge(key, value);
+  return Write(opt, &batch);
+}
+
+Status DB::IngestFiles(const std::vector<std::string>& files) {
+  return Status::NotSupported("IngestFiles");
+}
+
+Status DB::Checkpoint(const std::string& dir) {
+  return Status::NotSupported("Checkpoint");
+}
+
+Status DB::GetUpdatesSince(uint64_t sequence, size_t max_bytes,
+                           std::vector<std::string>* updates) {
+  return Status::NotSupported("GetUpdatesSince");
+}
+
+uint64_t DB::GetLatestSequenceNumber() {
+  return 0;
+}
+
+Status DB::CatchUp() {
+  return Status::NotSupported("CatchUp");
+}
+
 DB::~DB() { }
 
 Status DB::Open(const Options& options, const std::string& dbname,
@@ -1310,7 +2804,13 @@ Status DB::Open(const Options& options, const std::string& dbname,
   impl->mutex_.Lock();
   VersionEdit edit;
   Status s = impl->Recover(&edit); // Handles create_if_missing, error_if_exists
-  if (s.ok()) {
+  if (s.ok() && options.read_only) {
+    // Nothing is written: the logged updates are only replayed into mem_
+    s = impl->ReplayLogs();
+    if (s.ok()) {
+      impl->InstallReadView();
+    }
+  } else if (s.ok()) {
     uint64_t new_log_number = impl->versions_->NewFileNumber();
     WritableFile* lfile;
     s = options.env->NewWritableFile(LogFileName(dbname, new_log_number),
@@ -1323,6 +2823,7 @@ Status DB::Open(const Options& options, const std::string& dbname,
       s = impl->versions_->LogAndApply(&edit, &impl->mutex_);
     }
     if (s.ok()) {
+      impl->InstallReadView();
       impl->DeleteObsoleteFiles();
       impl->MaybeScheduleCompaction();
     }
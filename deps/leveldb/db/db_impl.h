@@ -5,18 +5,24 @@
 #ifndef STORAGE_LEVELDB_DB_DB_IMPL_H_
 #define STORAGE_LEVELDB_DB_DB_IMPL_H_
 
+#include <deque>
 #include <set>
+#include <vector>
 #include "db/dbformat.h"
 #include "db/log_writer.h"
 #include "db/snapshot.h"
+#include "db/version_edit.h"
 #include "leveldb/db.h"
 #include "leveldb/env.h"
 #include "port/port.h"
 
 namespace leveldb {
 
+class Compaction;
 class MemTable;
+class RangeTombstoneSet;
 class TableCache;
+class ThreadLocalPtr;
 class Version;
 class VersionEdit;
 class VersionSet;
@@ -39,6 +45,17 @@ class DBImpl : public DB {
   virtual bool GetProperty(const Slice& property, std::string* value);
   virtual void GetApproximateSizes(const Range* range, int n, uint64_t* sizes);
   virtual void CompactRange(const Slice* begin, const Slice* end);
+  virtual Status Warmup(const ReadOptions& options,
+                        int max_level, uint64_t max_bytes,
+                        void (*progress)(void* arg, uint64_t done,
+                                         uint64_t total),
+                        void* arg);
+  virtual Status IngestFiles(const std::vector<std::string>& files);
+  virtual Status Checkpoint(const std::string& dir);
+  virtual Status GetUpdatesSince(uint64_t sequence, size_t max_bytes,
+                                 std::vector<std::string>* updates);
+  virtual uint64_t GetLatestSequenceNumber();
+  virtual Status CatchUp();
 
   // Extra methods (for testing) that are not in the public DB interface
 
@@ -60,8 +77,44 @@ class DBImpl : public DB {
  private:
   friend class DB;
 
+  // If "tombstones" is non-NULL, the range tombstones of the same
+  // memtables and version are added to it.
   Iterator* NewInternalIterator(const ReadOptions&,
-                                SequenceNumber* latest_snapshot);
+                                SequenceNumber* latest_snapshot,
+                                RangeTombstoneSet* tombstones = NULL);
+
+  // A ReadView pins mem_, imm_ and the current version as of some point
+  // in time, so that Get() and NewIterator() can read them without
+  // holding mutex_.
+  struct ReadView;
+
+  // Return the calling thread's cached read view, taking a reference to
+  // the latest one under mutex_ only if the cache has been invalidated.
+  // The view must be handed back with ReturnReadView().
+  ReadView* AcquireReadView();
+  void ReturnReadView(ReadView* view);
+
+  // Drop a reference to "view".  Takes mutex_ iff it is the last one.
+  void UnrefReadView(ReadView* view);
+
+  // Release the memtables and version pinned by "view" and delete it.
+  // REQUIRES: mutex_ held, no references to view remain
+  void DeleteReadView(ReadView* view);
+
+  // Make the current mem_, imm_ and version the latest read view if they
+  // have changed, and take back the views cached by reader threads.
+  // REQUIRES: mutex_ held
+  void InstallReadView();
+
+  // Release every read view.
+  // REQUIRES: mutex_ held, no reads in progress
+  void ReleaseReadViews();
+
+  static void CleanupReadView(void* arg1, void* arg2);
+
+  // Iterators returned by NewIterator() that have not been deleted yet
+  struct LiveIterator;
+  static void CleanupLiveIterator(void* arg1, void* arg2);
 
   Status NewDB();
 
@@ -83,8 +136,20 @@ class DBImpl : public DB {
                         VersionEdit* edit,
                         SequenceNumber* max_sequence);
 
+  // Insert into mem_ the updates logged since the last call.  Read-only
+  // databases recover this way, without writing table files.
+  // REQUIRES: mutex_ held, options_.read_only
+  Status ReplayLogs();
+
   Status WriteLevel0Table(MemTable* mem, VersionEdit* edit, Version* base);
 
+  // Create an empty memtable configured from options_
+  MemTable* NewMemTable() const;
+
+  // Bytes used by the memtables waiting to be compacted.
+  // REQUIRES: mutex_ held
+  size_t ImmutableMemoryUsage() const;
+
   // Only thread is allowed to log at a time.
   struct LoggerId { };          // Opaque identifier for logging thread
   void AcquireLoggingResponsibility(LoggerId* self);
@@ -92,6 +157,15 @@ class DBImpl : public DB {
 
   Status MakeRoomForWrite(bool force /* compact even if there is room? */);
 
+  // Compact the memtable and wait until every immutable memtable has
+  // been written to a table file.
+  Status FlushMemTable();
+
+  // Implementation of Write() when options_.allow_concurrent_memtable_write
+  // is set: the batch is logged under the logging responsibility and then
+  // inserted into mem_ in parallel with other writers.
+  Status ConcurrentWrite(const WriteOptions& options, WriteBatch* updates);
+
   struct CompactionState;
 
   void MaybeScheduleCompaction();
@@ -101,10 +175,42 @@ class DBImpl : public DB {
   void CleanupCompaction(CompactionState* compact);
   Status DoCompactionWork(CompactionState* compact);
 
+  // Pick up to options_.max_subcompactions - 1 user keys that split the
+  // input of "c" into ranges of about the same size.
+  void SplitCompaction(Compaction* c, std::vector<InternalKey>* boundaries);
+
+  // Compact the part of the input that lies in [compact->begin,
+  // compact->end).  If imm_micros is non-NULL, memtable compactions are
+  // done along the way and the time they take is added to *imm_micros.
+  // REQUIRES: mutex_ not held
+  Status DoSubcompactionWork(CompactionState* compact, int64_t* imm_micros);
+
+  struct Subcompaction;
+  static void SubcompactionThread(void* arg);
+
+  // Combine the merge operand at "*input", which every snapshot sees,
+  // with the older entries for its user key, and add the result to the
+  // output.  Leaves *input at the first entry not consumed.
+  Status MergeCompactionInput(CompactionState* compact, Iterator* input);
+
+  // Add an entry to the output, opening and finishing files as needed.
+  Status AddCompactionOutput(CompactionState* compact, Iterator* input,
+                             const Slice& key, const Slice& value);
+
   Status OpenCompactionOutputFile(CompactionState* compact);
   Status FinishCompactionOutputFile(CompactionState* compact, Iterator* input);
   Status InstallCompactionResults(CompactionState* compact);
 
+  // Add the files of the queued ingestion to the last level if they do
+  // not overlap anything in the database.
+  // REQUIRES: mutex_ held, ingestion_ != NULL
+  Status InstallIngestedFiles();
+
+  // Drop table files that are wholly covered by a range tombstone
+  // visible to every snapshot, and forget tombstones that no longer
+  // hide anything.
+  void ApplyRangeTombstones();
+
   // Constant after construction
   Env* const env_;
   const InternalKeyComparator internal_comparator_;
@@ -124,15 +230,40 @@ class DBImpl : public DB {
   port::AtomicPointer shutting_down_;
   port::CondVar bg_cv_;          // Signalled when background work finishes
   MemTable* mem_;
-  MemTable* imm_;                // Memtable being compacted
-  port::AtomicPointer has_imm_;  // So bg thread can detect non-NULL imm_
+
+  // Memtables waiting to be compacted, oldest first.  next_log_number
+  // is the log started when the memtable became immutable: once it is
+  // compacted, older logs are no longer needed.
+  struct ImmutableMemTable {
+    MemTable* mem;
+    uint64_t next_log_number;
+  };
+  std::deque<ImmutableMemTable> imm_;
+  port::AtomicPointer has_imm_;  // So bg thread can detect non-empty imm_
   WritableFile* logfile_;
   uint64_t logfile_number_;
   log::Writer* log_;
   LoggerId* logger_;            // NULL, or the id of the current logging thread
   port::CondVar logger_cv_;     // For threads waiting to log
+
+  // Writes that have been logged and are being inserted into mem_
+  // concurrently, in sequence order.  The last sequence number only
+  // advances past a write once every earlier write has been applied.
+  struct PendingWrite;
+  std::deque<PendingWrite*> pending_writes_;
+  port::CondVar pending_cv_;    // Signalled when a pending write finishes
   SnapshotList snapshots_;
 
+  // Live iterators, oldest first.  Guarded by their own mutex so that
+  // NewIterator() does not contend on mutex_.
+  port::Mutex iterators_mutex_;
+  LiveIterator* live_iterators_;   // Dummy head of a circular list
+  int num_live_iterators_;
+
+  // The latest read view, and the views cached by each reader thread
+  ReadView* read_view_;
+  ThreadLocalPtr* local_view_;
+
   // Set of table files to protect from deletion because they are
   // part of ongoing compactions.
   std::set<uint64_t> pending_outputs_;
@@ -150,6 +281,23 @@ class DBImpl : public DB {
   };
   ManualCompaction* manual_compaction_;
 
+  // Information for an ingestion of external table files, which is
+  // installed by the background thread so that it never races with a
+  // compaction
+  struct Ingestion {
+    std::vector<FileMetaData> files;
+    SequenceNumber sequence;    // Given to every entry in the files
+    bool done;
+    Status status;
+  };
+  Ingestion* ingestion_;
+
+  // Progress of ReplayLogs(): the log number of the descriptor when mem_
+  // was started, and the records of the newest log inserted into mem_
+  uint64_t replay_min_log_;
+  uint64_t replay_log_;
+  uint64_t replay_records_;
+
   VersionSet* versions_;
 
   // Have we encountered a background error in paranoid mode?
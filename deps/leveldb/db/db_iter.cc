@@ -6,8 +6,11 @@
 
 #include "db/filename.h"
 #include "db/dbformat.h"
+#include "db/range_tombstone.h"
+#include "leveldb/compaction_filter.h"
 #include "leveldb/env.h"
 #include "leveldb/iterator.h"
+#include "leveldb/merge_operator.h"
 #include "port/port.h"
 #include "util/logging.h"
 #include "util/mutexlock.h"
@@ -38,7 +41,10 @@ class DBIter: public Iterator {
  public:
   // Which direction is the iterator currently moving?
   // (1) When moving forward, the internal iterator is positioned at
-  //     the exact entry that yields this->key(), this->value()
+  //     the exact entry that yields this->key(), this->value(), unless
+  //     that entry was a merge operand: then the merged key and value
+  //     are in saved_key_ and saved_value_, and the internal iterator
+  //     is positioned after the operands for this->key().
   // (2) When moving backwards, the internal iterator is positioned
   //     just before all entries whose user key == this->key().
   enum Direction {
@@ -47,26 +53,39 @@ class DBIter: public Iterator {
   };
 
   DBIter(const std::string* dbname, Env* env,
-         const Comparator* cmp, Iterator* iter, SequenceNumber s)
+         const Comparator* cmp, Iterator* iter, SequenceNumber s,
+         RangeTombstoneSet* tombstones, const MergeOperator* merge_operator,
+         const CompactionFilter* filter)
       : dbname_(dbname),
         env_(env),
         user_comparator_(cmp),
         iter_(iter),
         sequence_(s),
+        tombstones_(tombstones),
+        merge_operator_(merge_operator),
+        filter_(filter),
         direction_(kForward),
-        valid_(false) {
+        valid_(false),
+        merged_(false) {
+    if (tombstones_ != NULL && tombstones_->empty()) {
+      delete tombstones_;
+      tombstones_ = NULL;
+    }
   }
   virtual ~DBIter() {
     delete iter_;
+    delete tombstones_;
   }
   virtual bool Valid() const { return valid_; }
   virtual Slice key() const {
     assert(valid_);
-    return (direction_ == kForward) ? ExtractUserKey(iter_->key()) : saved_key_;
+    return (direction_ == kForward && !merged_)
+        ? ExtractUserKey(iter_->key()) : saved_key_;
   }
   virtual Slice value() const {
     assert(valid_);
-    return (direction_ == kForward) ? iter_->value() : saved_value_;
+    return (direction_ == kForward && !merged_)
+        ? iter_->value() : saved_value_;
   }
   virtual Status status() const {
     if (status_.ok()) {
@@ -87,6 +106,25 @@ class DBIter: public Iterator {
   void FindPrevUserEntry();
   bool ParseKey(ParsedInternalKey* key);
 
+  // Combine the merge operand at iter_ with the older entries for its
+  // key into saved_key_ and saved_value_.
+  void MergeForward(const Slice& user_key);
+
+  // Treat a value or merge operand hidden by a range tombstone as a
+  // deletion.
+  inline void ApplyTombstones(ParsedInternalKey* ikey) const {
+    if (tombstones_ != NULL &&
+        (ikey->type == kTypeValue || ikey->type == kTypeMerge) &&
+        tombstones_->Covers(ikey->user_key, ikey->sequence)) {
+      ikey->type = kTypeDeletion;
+    }
+  }
+
+  // Should the value of a key be treated as deleted?
+  inline bool Filtered(const Slice& key, const Slice& value) const {
+    return filter_ != NULL && filter_->Filter(key, value);
+  }
+
   inline void SaveKey(const Slice& k, std::string* dst) {
     dst->assign(k.data(), k.size());
   }
@@ -105,12 +143,16 @@ class DBIter: public Iterator {
   const Comparator* const user_comparator_;
   Iterator* const iter_;
   SequenceNumber const sequence_;
+  RangeTombstoneSet* tombstones_;
+  const MergeOperator* const merge_operator_;
+  const CompactionFilter* const filter_;
 
   Status status_;
   std::string saved_key_;     // == current key when direction_==kReverse
   std::string saved_value_;   // == current raw value when direction_==kReverse
   Direction direction_;
   bool valid_;
+  bool merged_;               // Moving forward, current entry was merged
 
   // No copying allowed
   DBIter(const DBIter&);
@@ -129,6 +171,20 @@ inline bool DBIter::ParseKey(ParsedInternalKey* ikey) {
 void DBIter::Next() {
   assert(valid_);
 
+  if (merged_) {
+    // iter_ is already past the operands for this->key(); skip the
+    // older entries they were merged into.
+    merged_ = false;
+    ClearSavedValue();
+    if (!iter_->Valid()) {
+      valid_ = false;
+      saved_key_.clear();
+      return;
+    }
+    FindNextUserEntry(true, &saved_key_);
+    return;
+  }
+
   if (direction_ == kReverse) {  // Switch directions?
     direction_ = kForward;
     // iter_ is pointing just before the entries for this->key(),
@@ -159,6 +215,7 @@ void DBIter::FindNextUserEntry(bool skipping, std::string* skip) {
   do {
     ParsedInternalKey ikey;
     if (ParseKey(&ikey) && ikey.sequence <= sequence_) {
+      ApplyTombstones(&ikey);
       switch (ikey.type) {
         case kTypeDeletion:
           // Arrange to skip all upcoming entries for this key since
@@ -170,12 +227,38 @@ void DBIter::FindNextUserEntry(bool skipping, std::string* skip) {
           if (skipping &&
               user_comparator_->Compare(ikey.user_key, *skip) <= 0) {
             // Entry hidden
+          } else if (Filtered(ikey.user_key, iter_->value())) {
+            // Treat as a deletion
+            SaveKey(ikey.user_key, skip);
+            skipping = true;
           } else {
             valid_ = true;
             saved_key_.clear();
             return;
           }
           break;
+        case kTypeMerge:
+          if (skipping &&
+              user_comparator_->Compare(ikey.user_key, *skip) <= 0) {
+            // Entry hidden
+          } else {
+            MergeForward(ikey.user_key);
+            if (!valid_ || !Filtered(saved_key_, saved_value_)) {
+              return;
+            }
+            // Treat as a deletion.  iter_ is already past the operands.
+            valid_ = false;
+            merged_ = false;
+            if (skip != &saved_key_) {
+              *skip = saved_key_;
+            }
+            skipping = true;
+            continue;
+          }
+          break;
+        case kTypeRangeDeletion:
+          // Only stored in memtables, never yielded by iter_
+          break;
       }
     }
     iter_->Next();
@@ -184,10 +267,57 @@ void DBIter::FindNextUserEntry(bool skipping, std::string* skip) {
   valid_ = false;
 }
 
+void DBIter::MergeForward(const Slice& user_key) {
+  SaveKey(user_key, &saved_key_);
+  MergeOperandList operands;
+  operands.Add(iter_->value(), 0);
+  bool has_base = false;
+  for (iter_->Next(); iter_->Valid(); iter_->Next()) {
+    ParsedInternalKey ikey;
+    if (!ParseKey(&ikey)) {
+      valid_ = false;
+      return;
+    }
+    if (user_comparator_->Compare(ikey.user_key, saved_key_) != 0) {
+      break;
+    }
+    ApplyTombstones(&ikey);
+    if (ikey.type == kTypeMerge) {
+      operands.Add(iter_->value(), 0);
+    } else if (ikey.type == kTypeValue) {
+      has_base = true;
+      break;
+    } else if (ikey.type == kTypeDeletion) {
+      break;
+    }
+  }
+  Slice base;
+  if (has_base) {
+    base = iter_->value();
+  }
+  status_ = operands.Apply(merge_operator_, saved_key_,
+                           has_base ? &base : NULL, &saved_value_);
+  valid_ = status_.ok();
+  merged_ = valid_;
+}
+
 void DBIter::Prev() {
   assert(valid_);
 
-  if (direction_ == kForward) {  // Switch directions?
+  if (merged_) {
+    // iter_ is somewhere after the entries for this->key(), which is
+    // already in saved_key_.  Scan backwards from there.
+    merged_ = false;
+    if (!iter_->Valid()) {
+      iter_->SeekToLast();
+    }
+    while (iter_->Valid() &&
+           user_comparator_->Compare(ExtractUserKey(iter_->key()),
+                                     saved_key_) >= 0) {
+      iter_->Prev();
+    }
+    direction_ = kReverse;
+  } else if (direction_ == kForward) {  // Switch directions?
     // iter_ is pointing at the current entry.  Scan backwards until
     // the key changes so we can use the normal reverse scanning code.
     assert(iter_->Valid());  // Otherwise valid_ would have been false
@@ -219,16 +349,43 @@ void DBIter::FindPrevUserEntry() {
     do {
       ParsedInternalKey ikey;
       if (ParseKey(&ikey) && ikey.sequence <= sequence_) {
+        ApplyTombstones(&ikey);
         if ((value_type != kTypeDeletion) &&
             user_comparator_->Compare(ikey.user_key, saved_key_) < 0) {
-          // We encountered a non-deleted value in entries for previous keys,
-          break;
+          if (!Filtered(saved_key_, saved_value_)) {
+            // We encountered a non-deleted value in entries for previous keys,
+            break;
+          }
+          // The value of the later key is treated as deleted
+          value_type = kTypeDeletion;
+          saved_key_.clear();
+          ClearSavedValue();
         }
-        value_type = ikey.type;
-        if (value_type == kTypeDeletion) {
+        if (ikey.type == kTypeMerge) {
+          // Fold the operand into the older entries seen so far
+          if (merge_operator_ == NULL) {
+            status_ = Status::NotSupported(
+                "merge operand without a merge operator");
+            break;
+          }
+          Slice existing = saved_value_;
+          std::string merged;
+          if (!merge_operator_->Merge(
+                  ikey.user_key,
+                  value_type == kTypeValue ? &existing : NULL,
+                  iter_->value(), &merged)) {
+            status_ = Status::Corruption("merge failed for ", ikey.user_key);
+            break;
+          }
+          SaveKey(ikey.user_key, &saved_key_);
+          saved_value_.swap(merged);
+          value_type = kTypeValue;
+        } else if (ikey.type == kTypeDeletion) {
+          value_type = kTypeDeletion;
           saved_key_.clear();
           ClearSavedValue();
         } else {
+          value_type = ikey.type;
           Slice raw_value = iter_->value();
           if (saved_value_.capacity() > raw_value.size() + 1048576) {
             std::string empty;
@@ -242,7 +399,11 @@ void DBIter::FindPrevUserEntry() {
     } while (iter_->Valid());
   }
 
-  if (value_type == kTypeDeletion) {
+  if (value_type != kTypeDeletion && status_.ok() &&
+      Filtered(saved_key_, saved_value_)) {
+    value_type = kTypeDeletion;
+  }
+  if (value_type == kTypeDeletion || !status_.ok()) {
     // End
     valid_ = false;
     saved_key_.clear();
@@ -255,6 +416,7 @@ void DBIter::FindPrevUserEntry() {
 
 void DBIter::Seek(const Slice& target) {
   direction_ = kForward;
+  merged_ = false;
   ClearSavedValue();
   saved_key_.clear();
   AppendInternalKey(
@@ -269,6 +431,7 @@ void DBIter::Seek(const Slice& target) {
 
 void DBIter::SeekToFirst() {
   direction_ = kForward;
+  merged_ = false;
   ClearSavedValue();
   iter_->SeekToFirst();
   if (iter_->Valid()) {
@@ -280,6 +443,7 @@ void DBIter::SeekToFirst() {
 
 void DBIter::SeekToLast() {
   direction_ = kReverse;
+  merged_ = false;
   ClearSavedValue();
   iter_->SeekToLast();
   FindPrevUserEntry();
@@ -292,8 +456,12 @@ Iterator* NewDBIterator(
     Env* env,
     const Comparator* user_key_comparator,
     Iterator* internal_iter,
-    const SequenceNumber& sequence) {
-  return new DBIter(dbname, env, user_key_comparator, internal_iter, sequence);
+    const SequenceNumber& sequence,
+    RangeTombstoneSet* tombstones,
+    const MergeOperator* merge_operator,
+    const CompactionFilter* filter) {
+  return new DBIter(dbname, env, user_key_comparator, internal_iter, sequence,
+                    tombstones, merge_operator, filter);
 }
 
 }  // namespace leveldb
@@ -11,15 +11,26 @@
 
 namespace leveldb {
 
+class CompactionFilter;
+class MergeOperator;
+class RangeTombstoneSet;
+
 // Return a new iterator that converts internal keys (yielded by
 // "*internal_iter") that were live at the specified "sequence" number
-// into appropriate user keys.
+// into appropriate user keys.  Entries covered by a tombstone in
+// "*tombstones" are treated as deleted.  "tombstones" may be NULL;
+// otherwise the iterator takes ownership of it.  Merge operands are
+// combined with "merge_operator", which may be NULL if there are none.
+// Values that "filter" rejects are treated as deleted; it may be NULL.
 extern Iterator* NewDBIterator(
     const std::string* dbname,
     Env* env,
     const Comparator* user_key_comparator,
     Iterator* internal_iter,
-    const SequenceNumber& sequence);
+    const SequenceNumber& sequence,
+    RangeTombstoneSet* tombstones = NULL,
+    const MergeOperator* merge_operator = NULL,
+    const CompactionFilter* filter = NULL);
 
 }  // namespace leveldb
 
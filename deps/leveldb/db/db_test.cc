@@ -3,12 +3,18 @@
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 
 #include "leveldb/db.h"
+#include <algorithm>
 #include "db/db_impl.h"
 #include "db/filename.h"
+#include "db/log_writer.h"
 #include "db/version_set.h"
 #include "db/write_batch_internal.h"
+#include "leveldb/compaction_filter.h"
 #include "leveldb/env.h"
+#include "leveldb/merge_operator.h"
 #include "leveldb/table.h"
+#include "leveldb/table_file_writer.h"
+#include "util/coding.h"
 #include "util/logging.h"
 #include "util/mutexlock.h"
 #include "util/testharness.h"
@@ -134,6 +140,14 @@ class DBTest {
     return db_->Delete(WriteOptions(), k);
   }
 
+  Status DeleteRange(const std::string& start, const std::string& limit) {
+    return db_->DeleteRange(WriteOptions(), start, limit);
+  }
+
+  Status Merge(const std::string& k, const std::string& v) {
+    return db_->Merge(WriteOptions(), k, v);
+  }
+
   std::string Get(const std::string& k, const Snapshot* snapshot = NULL) {
     ReadOptions options;
     options.snapshot = snapshot;
@@ -204,6 +218,12 @@ class DBTest {
             case kTypeDeletion:
               result += "DEL";
               break;
+            case kTypeMerge:
+              result += "+" + iter->value().ToString();
+              break;
+            case kTypeRangeDeletion:
+              result += "CORRUPTED";
+              break;
           }
         }
         iter->Next();
@@ -352,6 +372,46 @@ TEST(DBTest, GetFromImmutableLayer) {
   env_->delay_sstable_sync_.Release_Store(NULL);   // Release sync calls
 }
 
+TEST(DBTest, GetFromMultipleImmutableLayers) {
+  Options options;
+  options.env = env_;
+  options.write_buffer_size = 100000;  // Small write buffer
+  options.max_immutable_memtables = 3;
+  Reopen(&options);
+
+  ASSERT_OK(Put("foo", "v1"));
+  env_->delay_sstable_sync_.Release_Store(env_);   // Block sync calls
+  Put("k1", std::string(100000, 'x'));             // Fill memtable
+  Put("k2", std::string(100000, 'y'));             // Trigger compaction
+  Put("foo", "v2");                                // Second immutable layer
+  Put("k3", std::string(100000, 'z'));
+  Put("k4", "v4");                                 // Third immutable layer
+  std::string num;
+  ASSERT_TRUE(db_->GetProperty("leveldb.num-immutable-memtables", &num));
+  ASSERT_EQ("3", num);
+  ASSERT_EQ("v2", Get("foo"));
+  ASSERT_EQ(std::string(100000, 'x'), Get("k1"));
+  ASSERT_EQ("v4", Get("k4"));
+  Iterator* iter = db_->NewIterator(ReadOptions());
+  std::string keys;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    keys += iter->key().ToString() + " ";
+  }
+  iter->Seek("foo");
+  ASSERT_EQ("foo->v2", IterStatus(iter));
+  delete iter;
+  ASSERT_EQ("foo k1 k2 k3 k4 ", keys);
+  env_->delay_sstable_sync_.Release_Store(NULL);   // Release sync calls
+
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_TRUE(db_->GetProperty("leveldb.num-immutable-memtables", &num));
+  ASSERT_EQ("0", num);
+  ASSERT_EQ("v2", Get("foo"));
+  Reopen(&options);
+  ASSERT_EQ("v2", Get("foo"));
+  ASSERT_EQ("v4", Get("k4"));
+}
+
 TEST(DBTest, GetFromVersions) {
   ASSERT_OK(Put("foo", "v1"));
   dbfull()->TEST_CompactMemTable();
@@ -766,6 +826,54 @@ TEST(DBTest, CompactionsGenerateMultipleFiles) {
   }
 }
 
+TEST(DBTest, Subcompactions) {
+  Options options;
+  options.write_buffer_size = 100000000;        // Large write buffer
+  options.max_subcompactions = 4;
+  Reopen(&options);
+
+  Random rnd(301);
+
+  // Write 8MB (80 values, each 100K) and spread it over level-1 files
+  std::vector<std::string> values;
+  for (int i = 0; i < 80; i++) {
+    values.push_back(RandomString(&rnd, 100000));
+    ASSERT_OK(Put(Key(i), values[i]));
+  }
+  Reopen(&options);
+  dbfull()->TEST_CompactRange(0, NULL, NULL);
+  ASSERT_GT(NumTableFilesAtLevel(1), 1);
+
+  // Overwrite or delete every key, so that the level-0 file overlaps
+  // all level-1 files, and compact them in several key ranges
+  for (int i = 0; i < 80; i++) {
+    if (i % 3 == 0) {
+      ASSERT_OK(Delete(Key(i)));
+    } else {
+      ASSERT_OK(Put(Key(i), RandomString(&rnd, 100000)));
+    }
+  }
+  ASSERT_OK(Put(Key(1), "v1"));
+  ASSERT_OK(Put(Key(79), "v79"));
+  Reopen(&options);
+  dbfull()->TEST_CompactRange(0, NULL, NULL);
+  ASSERT_EQ(NumTableFilesAtLevel(0), 0);
+  ASSERT_GT(NumTableFilesAtLevel(1), 2);
+
+  ASSERT_EQ("NOT_FOUND", Get(Key(0)));
+  ASSERT_EQ("v1", Get(Key(1)));
+  ASSERT_EQ(100000, Get(Key(2)).size());
+  ASSERT_EQ("NOT_FOUND", Get(Key(78)));
+  ASSERT_EQ("v79", Get(Key(79)));
+  int live = 0;
+  Iterator* iter = db_->NewIterator(ReadOptions());
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    live++;
+  }
+  delete iter;
+  ASSERT_EQ(53, live);
+}
+
 TEST(DBTest, RepeatedWritesToSameKey) {
   Options options;
   options.env = env_;
@@ -1314,6 +1422,895 @@ TEST(DBTest, FilesDeletedAfterCompaction) {
   ASSERT_EQ(CountFiles(), num_files);
 }
 
+TEST(DBTest, DeleteRange) {
+  ASSERT_OK(Put("a", "va"));
+  ASSERT_OK(Put("b", "vb"));
+  ASSERT_OK(Put("c", "vc"));
+  ASSERT_OK(Put("d", "vd"));
+  ASSERT_OK(DeleteRange("b", "d"));
+  ASSERT_OK(Put("c", "vc2"));
+  ASSERT_OK(DeleteRange("x", "a"));   // Empty range
+  for (int i = 0; i < 4; i++) {
+    ASSERT_EQ("va", Get("a"));
+    ASSERT_EQ("NOT_FOUND", Get("b"));
+    ASSERT_EQ("vc2", Get("c"));
+    ASSERT_EQ("vd", Get("d"));
+    ASSERT_EQ("(a->va)(c->vc2)(d->vd)", Contents());
+    switch (i) {
+      case 0: Reopen(); break;                            // Recover from log
+      case 1: dbfull()->TEST_CompactMemTable(); break;    // In the version
+      case 2: Compact("a", "z"); break;                   // Applied
+    }
+  }
+  ASSERT_EQ("[ ]", AllEntriesFor("b"));
+  ASSERT_EQ("[ vc2 ]", AllEntriesFor("c"));
+}
+
+TEST(DBTest, DeleteRangeWithSnapshot) {
+  ASSERT_OK(Put("a", "v1"));
+  ASSERT_OK(Put("b", "v1"));
+  ASSERT_OK(Put("c", "v1"));
+  dbfull()->TEST_CompactMemTable();
+  const Snapshot* snapshot = db_->GetSnapshot();
+  ASSERT_OK(DeleteRange("a", "c"));
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_EQ(1, TotalTableFiles());
+  Compact("a", "z");
+  ASSERT_EQ("NOT_FOUND", Get("a"));
+  ASSERT_EQ("v1", Get("a", snapshot));
+  ASSERT_EQ("v1", Get("b", snapshot));
+  ASSERT_EQ("v1", Get("c"));
+  ASSERT_EQ("[ v1 ]", AllEntriesFor("a"));
+
+  ReadOptions options;
+  options.snapshot = snapshot;
+  Iterator* iter = db_->NewIterator(options);
+  iter->SeekToLast();
+  ASSERT_EQ(IterStatus(iter), "c->v1");
+  iter->Prev();
+  ASSERT_EQ(IterStatus(iter), "b->v1");
+  delete iter;
+
+  iter = db_->NewIterator(ReadOptions());
+  iter->Seek("a");
+  ASSERT_EQ(IterStatus(iter), "c->v1");
+  iter->Prev();
+  ASSERT_EQ(IterStatus(iter), "(invalid)");
+  delete iter;
+
+  db_->ReleaseSnapshot(snapshot);
+  for (int level = 0; level < config::kNumLevels - 1; level++) {
+    dbfull()->TEST_CompactRange(level, NULL, NULL);
+  }
+  ASSERT_EQ("[ ]", AllEntriesFor("a"));
+  ASSERT_EQ("[ ]", AllEntriesFor("b"));
+  ASSERT_EQ("[ v1 ]", AllEntriesFor("c"));
+  std::string sstables;
+  ASSERT_TRUE(db_->GetProperty("leveldb.sstables", &sstables));
+  ASSERT_EQ(std::string::npos, sstables.find("range tombstones"));
+}
+
+TEST(DBTest, DeleteRangeDropsFiles) {
+  for (int i = 0; i < 100; i++) {
+    ASSERT_OK(Put(Key(i), "v"));
+  }
+  dbfull()->TEST_CompactMemTable();
+  for (int i = 100; i < 200; i++) {
+    ASSERT_OK(Put(Key(i), "v"));
+  }
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_EQ(2, TotalTableFiles());
+
+  // The first table lies wholly inside the range and is deleted without
+  // being compacted; the tombstone is then no longer needed.
+  ASSERT_OK(DeleteRange(Key(0), Key(100)));
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_EQ(1, TotalTableFiles());
+  ASSERT_EQ("NOT_FOUND", Get(Key(50)));
+  ASSERT_EQ("v", Get(Key(150)));
+  std::string sstables;
+  ASSERT_TRUE(db_->GetProperty("leveldb.sstables", &sstables));
+  ASSERT_EQ(std::string::npos, sstables.find("range tombstones"));
+}
+
+namespace {
+struct WarmupProgress {
+  int calls;
+  uint64_t done;
+  uint64_t total;
+};
+
+static void RecordWarmupProgress(void* arg, uint64_t done, uint64_t total) {
+  WarmupProgress* p = reinterpret_cast<WarmupProgress*>(arg);
+  ASSERT_GT(done, p->done);
+  ASSERT_LE(done, total);
+  p->calls++;
+  p->done = done;
+  p->total = total;
+}
+}
+
+TEST(DBTest, Merge) {
+  Options options;
+  options.merge_operator = UInt64AddOperator();
+  Reopen(&options);
+  ASSERT_OK(Merge("a", "1"));         // No older value
+  ASSERT_OK(Put("b", "10"));
+  ASSERT_OK(Merge("b", "5"));
+  ASSERT_OK(Put("c", "7"));
+  ASSERT_OK(Delete("c"));
+  ASSERT_OK(Merge("c", "2"));         // Deleted older value
+  ASSERT_OK(Merge("d", "3"));
+  ASSERT_OK(DeleteRange("d", "e"));
+  ASSERT_OK(Merge("d", "4"));         // Older operand hidden
+  for (int i = 0; i < 5; i++) {
+    const std::string a = NumberToString(1 + i);
+    const std::string b = NumberToString(15 + i);
+    const std::string c = NumberToString(2 + i);
+    ASSERT_EQ(a, Get("a"));
+    ASSERT_EQ(b, Get("b"));
+    ASSERT_EQ(c, Get("c"));
+    ASSERT_EQ("4", Get("d"));
+    ASSERT_EQ("(a->" + a + ")(b->" + b + ")(c->" + c + ")(d->4)", Contents());
+
+    Iterator* iter = db_->NewIterator(ReadOptions());
+    iter->Seek("b");
+    ASSERT_EQ(IterStatus(iter), "b->" + b);
+    iter->Prev();
+    ASSERT_EQ(IterStatus(iter), "a->" + a);
+    iter->Next();
+    ASSERT_EQ(IterStatus(iter), "b->" + b);
+    iter->Next();
+    ASSERT_EQ(IterStatus(iter), "c->" + c);
+    delete iter;
+
+    ASSERT_OK(Merge("a", "1"));
+    ASSERT_OK(Merge("b", "1"));
+    ASSERT_OK(Merge("c", "1"));
+    switch (i) {
+      case 0: Reopen(&options); break;                    // Recover from log
+      case 1: dbfull()->TEST_CompactMemTable(); break;    // In level-0
+      case 2: Compact("a", "z"); break;                   // Merged
+      case 3: dbfull()->TEST_CompactMemTable(); break;    // Over a value
+    }
+  }
+
+  // Operands that a snapshot sees unmerged are kept
+  const Snapshot* snapshot = db_->GetSnapshot();
+  ASSERT_OK(Merge("a", "10"));
+  Compact("a", "z");
+  ASSERT_EQ("6", Get("a", snapshot));
+  ASSERT_EQ("16", Get("a"));
+  ASSERT_EQ("[ +10, 6 ]", AllEntriesFor("a"));
+  db_->ReleaseSnapshot(snapshot);
+  ASSERT_OK(Merge("a", "1"));
+  Compact("a", "z");
+  ASSERT_EQ("[ 17 ]", AllEntriesFor("a"));
+  ASSERT_EQ("[ 20 ]", AllEntriesFor("b"));
+
+  // A run of operands above older data is combined into one operand
+  dbfull()->TEST_CompactRange(1, NULL, NULL);
+  ASSERT_EQ("0,0,1", FilesPerLevel());
+  ASSERT_OK(Merge("b", "1"));
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_OK(Merge("b", "2"));
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_EQ("[ +2, +1, 20 ]", AllEntriesFor("b"));
+  dbfull()->TEST_CompactRange(0, NULL, NULL);
+  ASSERT_EQ("[ +3, 20 ]", AllEntriesFor("b"));
+  ASSERT_EQ("23", Get("b"));
+
+  // Operands that cannot be merged make reads fail
+  ASSERT_OK(Put("e", "x"));
+  ASSERT_OK(Merge("e", "1"));
+  ASSERT_TRUE(Get("e").find("Corruption") != std::string::npos);
+  Compact("a", "z");
+  ASSERT_EQ("[ +1, x ]", AllEntriesFor("e"));
+
+  // So do operands without a merge operator
+  options.merge_operator = NULL;
+  Reopen(&options);
+  ASSERT_TRUE(Get("a").find("Not implemented") == std::string::npos);
+  ASSERT_OK(Merge("a", "1"));
+  ASSERT_TRUE(Get("a").find("Not implemented") != std::string::npos);
+}
+
+namespace {
+// Rejects values that start with "drop"
+class DropFilter : public CompactionFilter {
+ public:
+  virtual bool Filter(const Slice& key, const Slice& value) const {
+    return value.starts_with("drop");
+  }
+  virtual const char* Name() const { return "DropFilter"; }
+};
+
+// Env whose clock is set by hand
+class FakeClockEnv : public EnvWrapper {
+ public:
+  uint64_t now_micros_;
+  explicit FakeClockEnv(Env* base) : EnvWrapper(base), now_micros_(0) { }
+  virtual uint64_t NowMicros() { return now_micros_; }
+};
+
+// Append a 4-byte big-endian timestamp to "v"
+std::string Stamped(const std::string& v, uint32_t seconds) {
+  std::string result = v;
+  result.push_back(static_cast<char>(seconds >> 24));
+  result.push_back(static_cast<char>(seconds >> 16));
+  result.push_back(static_cast<char>(seconds >> 8));
+  result.push_back(static_cast<char>(seconds));
+  return result;
+}
+}  // namespace
+
+TEST(DBTest, CompactionFilter) {
+  DropFilter filter;
+  Options options;
+  options.compaction_filter = &filter;
+  Reopen(&options);
+  ASSERT_OK(Put("a", "v1"));
+  ASSERT_OK(Put("b", "v1"));
+  dbfull()->TEST_CompactMemTable();
+  dbfull()->TEST_CompactRange(0, NULL, NULL);
+  dbfull()->TEST_CompactRange(1, NULL, NULL);
+  ASSERT_EQ("0,0,1", FilesPerLevel());
+
+  ASSERT_OK(Put("b", "drop"));   // Over an older value
+  ASSERT_OK(Put("c", "drop"));   // Nothing older
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_OK(Put("bb", "v1"));
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_EQ("1,1,1", FilesPerLevel());
+
+  // Rejected values are visible until a compaction drops them
+  ASSERT_EQ("drop", Get("b"));
+  ASSERT_EQ("drop", Get("c"));
+  dbfull()->TEST_CompactRange(0, NULL, NULL);
+  ASSERT_EQ("NOT_FOUND", Get("b"));
+  ASSERT_EQ("NOT_FOUND", Get("c"));
+  ASSERT_EQ("[ DEL, v1 ]", AllEntriesFor("b"));
+  ASSERT_EQ("[ ]", AllEntriesFor("c"));
+  ASSERT_EQ("(a->v1)(bb->v1)", Contents());
+  dbfull()->TEST_CompactRange(1, NULL, NULL);
+  ASSERT_EQ("[ ]", AllEntriesFor("b"));
+
+  // Values that a snapshot cannot see are kept
+  const Snapshot* snapshot = db_->GetSnapshot();
+  ASSERT_OK(Put("e", "drop"));
+  Compact("a", "z");
+  ASSERT_EQ("[ drop ]", AllEntriesFor("e"));
+  db_->ReleaseSnapshot(snapshot);
+
+  // Reads can hide rejected values right away
+  options.compaction_filter_on_read = true;
+  Reopen(&options);
+  ASSERT_OK(Put("f", "drop"));
+  ASSERT_OK(Put("g", "v1"));
+  ASSERT_EQ("NOT_FOUND", Get("e"));
+  ASSERT_EQ("NOT_FOUND", Get("f"));
+  ASSERT_EQ("(a->v1)(bb->v1)(g->v1)", Contents());
+  Iterator* iter = db_->NewIterator(ReadOptions());
+  iter->Seek("e");
+  ASSERT_EQ(IterStatus(iter), "g->v1");
+  iter->Prev();
+  ASSERT_EQ(IterStatus(iter), "bb->v1");
+  delete iter;
+
+  Reopen();
+}
+
+TEST(DBTest, TTLFilter) {
+  FakeClockEnv clock(env_);
+  clock.now_micros_ = 1000 * 1000000ull;
+  CompactionFilter* filter = NewTTLFilter(&clock, 100, false);
+  ASSERT_TRUE(!filter->Filter("k", "v"));        // No timestamp
+  ASSERT_TRUE(!filter->Filter("k", Stamped("v", 950)));
+  ASSERT_TRUE(filter->Filter("k", Stamped("v", 900)));
+  ASSERT_TRUE(filter->Filter("k", Stamped("", 100)));
+
+  CompactionFilter* expiry = NewTTLFilter(&clock, 0, true);
+  ASSERT_TRUE(!expiry->Filter("k", Stamped("", 1001) + "v"));
+  ASSERT_TRUE(expiry->Filter("k", Stamped("", 1000) + "v"));
+  delete expiry;
+
+  Options options;
+  options.compaction_filter = filter;
+  options.compaction_filter_on_read = true;
+  Reopen(&options);
+  ASSERT_OK(Put("a", Stamped("va1", 900)));
+  ASSERT_OK(Put("b", Stamped("vb", 990)));
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_OK(Put("a", Stamped("va2", 950)));
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_EQ(Stamped("va2", 950), Get("a"));
+  clock.now_micros_ = 1060 * 1000000ull;
+  ASSERT_EQ("NOT_FOUND", Get("a"));
+  ASSERT_EQ(Stamped("vb", 990), Get("b"));
+  Compact("a", "z");
+  ASSERT_EQ("[ ]", AllEntriesFor("a"));
+  ASSERT_EQ("[ " + Stamped("vb", 990) + " ]", AllEntriesFor("b"));
+
+  Reopen();
+  delete filter;
+}
+
+static void WriteIngestFile(const std::string& fname, const char* keys,
+                            const char* prefix = "v") {
+  TableFileWriter writer((Options()));
+  ASSERT_OK(writer.Open(fname));
+  for (const char* k = keys; *k != '\0'; k++) {
+    ASSERT_OK(writer.Add(std::string(1, *k), std::string(prefix) + *k));
+  }
+  ASSERT_OK(writer.Finish());
+  ASSERT_EQ(strlen(keys), writer.NumEntries());
+  ASSERT_GT(writer.FileSize(), 0);
+}
+
+TEST(DBTest, Ingest) {
+  const std::string f1 = dbname_ + "_ingest1";
+  const std::string f2 = dbname_ + "_ingest2";
+  WriteIngestFile(f1, "cd");
+  WriteIngestFile(f2, "fg");
+  {
+    TableFileWriter writer((Options()));
+    ASSERT_OK(writer.Open(dbname_ + "_ingest3"));
+    ASSERT_OK(writer.Add("b", "vb"));
+    ASSERT_TRUE(!writer.Add("a", "va").ok());
+    ASSERT_TRUE(!writer.Add("b", "vb").ok());
+  }
+  ASSERT_TRUE(!env_->FileExists(dbname_ + "_ingest3"));
+
+  ASSERT_OK(Put("a", "va"));
+  const Snapshot* snapshot = db_->GetSnapshot();
+  std::vector<std::string> files;
+  files.push_back(f2);
+  files.push_back(f1);
+  ASSERT_OK(db_->IngestFiles(files));
+  ASSERT_EQ("0,0,0,0,0,0,2", FilesPerLevel());
+  ASSERT_EQ("(a->va)(c->vc)(d->vd)(f->vf)(g->vg)", Contents());
+  ASSERT_EQ(2, db_->GetLatestSequenceNumber());  // One for all the files
+
+  // Older snapshots do not see the files
+  ASSERT_EQ("NOT_FOUND", Get("d", snapshot));
+  ReadOptions options;
+  options.snapshot = snapshot;
+  Iterator* iter = db_->NewIterator(options);
+  iter->Seek("c");
+  ASSERT_TRUE(!iter->Valid());
+  iter->SeekToFirst();
+  ASSERT_EQ("a", iter->key().ToString());
+  iter->Next();
+  ASSERT_TRUE(!iter->Valid());
+  iter->SeekToLast();
+  ASSERT_EQ("a", iter->key().ToString());
+  delete iter;
+  db_->ReleaseSnapshot(snapshot);
+
+  // Ingested values replace existing ones.  A memtable holding any of
+  // the keys is flushed first, and each file goes to the deepest level
+  // that no level above it overlaps.
+  snapshot = db_->GetSnapshot();
+  WriteIngestFile(f2, "ab", "w");
+  files.clear();
+  files.push_back(f2);
+  ASSERT_OK(db_->IngestFiles(files));                   // Memtable
+  ASSERT_EQ("0,1,1,0,0,0,2", FilesPerLevel());
+  ASSERT_EQ("wa", Get("a"));
+  ASSERT_EQ("va", Get("a", snapshot));
+  ASSERT_EQ("[ wa, va ]", AllEntriesFor("a"));
+  db_->ReleaseSnapshot(snapshot);
+
+  WriteIngestFile(f2, "de", "w");
+  ASSERT_OK(db_->IngestFiles(files));                   // Table file
+  ASSERT_EQ("0,1,1,0,0,1,2", FilesPerLevel());
+  ASSERT_EQ("(a->wa)(b->wb)(c->vc)(d->wd)(e->we)(f->vf)(g->vg)", Contents());
+
+  // Level 0 files may overlap, and the ingested one is the newest
+  ASSERT_OK(Put("b", "vb"));
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_EQ("1,1,1,0,0,1,2", FilesPerLevel());
+  WriteIngestFile(f2, "b", "x");
+  ASSERT_OK(db_->IngestFiles(files));
+  ASSERT_EQ("2,1,1,0,0,1,2", FilesPerLevel());
+  ASSERT_EQ("xb", Get("b"));
+
+  // A range deletion only hides older values
+  ASSERT_OK(db_->DeleteRange(WriteOptions(), "x", "z"));
+  WriteIngestFile(f2, "y");
+  ASSERT_OK(db_->IngestFiles(files));                   // Range tombstone
+  ASSERT_EQ("vy", Get("y"));
+
+  // Nothing is added if the files overlap each other
+  WriteIngestFile(f1, "hi");
+  WriteIngestFile(f2, "ij");
+  files.push_back(f1);
+  ASSERT_TRUE(!db_->IngestFiles(files).ok());
+  ASSERT_EQ("NOT_FOUND", Get("i"));
+
+  Reopen();
+  ASSERT_EQ("(a->wa)(b->xb)(c->vc)(d->wd)(e->we)(f->vf)(g->vg)(y->vy)",
+            Contents());
+
+  // The sequence number of the files survives a reopen, so later writes
+  // still override them
+  ASSERT_OK(Put("e", "ve2"));
+  ASSERT_EQ("ve2", Get("e"));
+  Compact("a", "z");
+  ASSERT_EQ("(a->wa)(b->xb)(c->vc)(d->wd)(e->ve2)(f->vf)(g->vg)(y->vy)",
+            Contents());
+  ASSERT_EQ("[ ve2 ]", AllEntriesFor("e"));
+
+  env_->DeleteFile(f1);
+  env_->DeleteFile(f2);
+}
+
+TEST(DBTest, IngestRepair) {
+  const std::string f = dbname_ + "_ingest";
+  ASSERT_OK(Put("a", "va"));
+  ASSERT_OK(Put("b", "vb"));
+  dbfull()->TEST_CompactMemTable();
+  WriteIngestFile(f, "ab", "w");
+  std::vector<std::string> files;
+  files.push_back(f);
+  ASSERT_OK(db_->IngestFiles(files));
+  ASSERT_OK(Put("b", "vb2"));                           // Only in the log
+
+  // The repaired database knows the sequence number of the files
+  delete db_;
+  db_ = NULL;
+  ASSERT_OK(RepairDB(dbname_, Options()));
+  Reopen();
+  ASSERT_EQ("wa", Get("a"));
+  ASSERT_EQ("vb2", Get("b"));
+  ASSERT_EQ("[ wa, va ]", AllEntriesFor("a"));
+
+  // The source file now records it too, so it is copied if ingested
+  // again
+  ASSERT_OK(Put("a", "va2"));
+  ASSERT_OK(db_->IngestFiles(files));
+  ASSERT_EQ("wa", Get("a"));
+  ASSERT_EQ("wb", Get("b"));
+  delete db_;
+  db_ = NULL;
+  ASSERT_OK(RepairDB(dbname_, Options()));
+  Reopen();
+  ASSERT_EQ("(a->wa)(b->wb)", Contents());
+  ASSERT_OK(Put("a", "va3"));
+  ASSERT_EQ("va3", Get("a"));
+
+  env_->DeleteFile(f);
+}
+
+// The first sequence number of each of "updates"
+static std::string UpdateSequences(const std::vector<std::string>& updates) {
+  std::string result;
+  for (size_t i = 0; i < updates.size(); i++) {
+    if (i > 0) result += ",";
+    AppendNumberTo(&result, DecodeFixed64(updates[i].data()));
+  }
+  return result;
+}
+
+TEST(DBTest, GetUpdatesSince) {
+  Options options;
+  options.log_retention_bytes = 1 << 20;
+  Reopen(&options);
+
+  ASSERT_OK(Put("a", "v1"));                      // 1
+  ASSERT_OK(Put("b", "v1"));                      // 2
+  WriteBatch batch;
+  batch.Put("c", "v1");
+  batch.Delete("a");
+  ASSERT_OK(db_->Write(WriteOptions(), &batch));  // 3-4
+  ASSERT_EQ(4, db_->GetLatestSequenceNumber());
+
+  std::vector<std::string> updates;
+  ASSERT_OK(db_->GetUpdatesSince(0, 0, &updates));
+  ASSERT_EQ("1,2,3", UpdateSequences(updates));
+  WriteBatch copy;
+  WriteBatchInternal::SetContents(&copy, updates[2]);
+  ASSERT_EQ(2, WriteBatchInternal::Count(&copy));
+  updates.clear();
+  ASSERT_OK(db_->GetUpdatesSince(4, 0, &updates));  // Within a batch
+  ASSERT_EQ("3", UpdateSequences(updates));
+  updates.clear();
+  ASSERT_OK(db_->GetUpdatesSince(2, 1, &updates));
+  ASSERT_EQ("2", UpdateSequences(updates));
+  updates.clear();
+  ASSERT_OK(db_->GetUpdatesSince(5, 0, &updates));
+  ASSERT_EQ("", UpdateSequences(updates));
+
+  // Logs that recovery no longer needs are retained
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_OK(Put("d", "v1"));                      // 5
+  Reopen(&options);
+  ASSERT_OK(Put("e", "v1"));                      // 6
+  updates.clear();
+  ASSERT_OK(db_->GetUpdatesSince(2, 0, &updates));
+  ASSERT_EQ("2,3,5,6", UpdateSequences(updates));
+
+  // Only up to the retention limit
+  options.log_retention_bytes = 0;
+  Reopen(&options);
+  updates.clear();
+  ASSERT_TRUE(db_->GetUpdatesSince(6, 0, &updates).IsNotFound());
+  ASSERT_OK(Put("f", "v1"));                      // 7
+  ASSERT_TRUE(db_->GetUpdatesSince(6, 0, &updates).IsNotFound());
+  ASSERT_OK(db_->GetUpdatesSince(7, 0, &updates));
+  ASSERT_EQ("7", UpdateSequences(updates));
+
+  // Ingested files are not logged, so the updates stop short of them
+  const std::string f = dbname_ + "_ingest";
+  WriteIngestFile(f, "xy");
+  std::vector<std::string> files;
+  files.push_back(f);
+  ASSERT_OK(db_->IngestFiles(files));             // 8
+  updates.clear();
+  ASSERT_TRUE(db_->GetUpdatesSince(8, 0, &updates).IsNotFound());
+  ASSERT_OK(Put("g", "v1"));                      // 9
+  ASSERT_OK(db_->GetUpdatesSince(7, 0, &updates));
+  ASSERT_EQ("7", UpdateSequences(updates));
+  updates.clear();
+  ASSERT_TRUE(db_->GetUpdatesSince(8, 0, &updates).IsNotFound());
+  ASSERT_OK(db_->GetUpdatesSince(9, 0, &updates));
+  ASSERT_EQ("9", UpdateSequences(updates));
+  env_->DeleteFile(f);
+}
+
+TEST(DBTest, ReadOnly) {
+  Options options;
+  options.read_only = true;
+  options.create_if_missing = true;
+  DB* reader;
+  ASSERT_TRUE(!DB::Open(options, dbname_ + "/missing", &reader).ok());
+
+  ASSERT_OK(Put("a", "v1"));
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_OK(Put("b", "v1"));                // Only in the log
+  ASSERT_OK(Put("a", "v2"));
+  delete db_;
+  db_ = NULL;
+
+  std::vector<std::string> before, after;
+  env_->GetChildren(dbname_, &before);
+  ASSERT_OK(TryReopen(&options));
+  ASSERT_EQ("v2", Get("a"));
+  ASSERT_EQ("v1", Get("b"));
+  ASSERT_EQ("Not implemented: read-only database", Put("c", "v1").ToString());
+  ASSERT_TRUE(!db_->Checkpoint(dbname_ + "/checkpoint").ok());
+  db_->CompactRange(NULL, NULL);
+
+  // Not locked, so several readers may share the database
+  ASSERT_OK(DB::Open(options, dbname_, &reader));
+  std::string value;
+  ASSERT_OK(reader->Get(ReadOptions(), "b", &value));
+  ASSERT_EQ("v1", value);
+  delete reader;
+
+  // and nothing was written
+  delete db_;
+  db_ = NULL;
+  env_->GetChildren(dbname_, &after);
+  std::sort(before.begin(), before.end());
+  std::sort(after.begin(), after.end());
+  ASSERT_EQ(before.size(), after.size());
+  for (size_t i = 0; i < before.size(); i++) {
+    ASSERT_EQ(before[i], after[i]);
+  }
+
+  Reopen();
+  ASSERT_EQ("v1", Get("b"));
+}
+
+static std::string ReaderGet(DB* reader, const std::string& k) {
+  std::string result;
+  Status s = reader->Get(ReadOptions(), k, &result);
+  return s.ok() ? result : s.ToString();
+}
+
+TEST(DBTest, CatchUp) {
+  ASSERT_OK(Put("a", "v1"));
+  ASSERT_TRUE(!db_->CatchUp().ok());
+
+  Options options;
+  options.read_only = true;
+  DB* reader;
+  ASSERT_OK(DB::Open(options, dbname_, &reader));
+  ASSERT_EQ("v1", ReaderGet(reader, "a"));
+
+  // New log records
+  ASSERT_OK(Put("b", "v1"));
+  ASSERT_EQ("NotFound: ", ReaderGet(reader, "b"));
+  ASSERT_OK(reader->CatchUp());
+  ASSERT_EQ("v1", ReaderGet(reader, "b"));
+  ASSERT_OK(reader->CatchUp());
+  ASSERT_EQ("v1", ReaderGet(reader, "b"));
+
+  // New descriptor records and log files
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_OK(Put("c", "v1"));
+  ASSERT_OK(Put("a", "v2"));
+  ASSERT_OK(reader->CatchUp());
+  ASSERT_EQ("v2", ReaderGet(reader, "a"));
+  ASSERT_EQ("v1", ReaderGet(reader, "b"));
+  ASSERT_EQ("v1", ReaderGet(reader, "c"));
+
+  // Compacted files
+  db_->CompactRange(NULL, NULL);
+  ASSERT_OK(Delete("b"));
+  ASSERT_OK(reader->CatchUp());
+  ASSERT_EQ("v2", ReaderGet(reader, "a"));
+  ASSERT_EQ("NotFound: ", ReaderGet(reader, "b"));
+
+  // A new descriptor
+  Reopen();
+  ASSERT_OK(Put("d", "v1"));
+  ASSERT_OK(reader->CatchUp());
+  ASSERT_EQ("v2", ReaderGet(reader, "a"));
+  ASSERT_EQ("v1", ReaderGet(reader, "c"));
+  ASSERT_EQ("v1", ReaderGet(reader, "d"));
+  delete reader;
+}
+
+TEST(DBTest, CatchUpSequence) {
+  Options options;
+  options.read_only = true;
+  DB* reader;
+  ASSERT_OK(DB::Open(options, dbname_, &reader));
+
+  // The logs may be ahead of the descriptor, but whatever order the
+  // writes, compactions and catch-ups come in, the reader's sequence
+  // number never goes back
+  uint64_t last = 0;
+  for (int i = 0; i < 20; i++) {
+    const std::string key = "k" + NumberToString(i % 5);
+    ASSERT_OK(Put(key, "v" + NumberToString(i)));
+    ASSERT_OK(Put("x", "v" + NumberToString(i)));
+    if (i % 3 == 0) {
+      dbfull()->TEST_CompactMemTable();
+    }
+    if (i % 7 == 0) {
+      db_->CompactRange(NULL, NULL);
+    }
+    ASSERT_OK(reader->CatchUp());
+    ASSERT_GE(reader->GetLatestSequenceNumber(), last);
+    last = reader->GetLatestSequenceNumber();
+    ASSERT_EQ(db_->GetLatestSequenceNumber(), last);
+    ASSERT_EQ("v" + NumberToString(i), ReaderGet(reader, key));
+    ASSERT_EQ("v" + NumberToString(i), ReaderGet(reader, "x"));
+
+    // A snapshot of the reader keeps seeing what it saw
+    const Snapshot* snapshot = reader->GetSnapshot();
+    ASSERT_OK(Put("x", "later"));
+    ASSERT_OK(reader->CatchUp());
+    ReadOptions read_options;
+    read_options.snapshot = snapshot;
+    std::string value;
+    ASSERT_OK(reader->Get(read_options, "x", &value));
+    ASSERT_EQ("v" + NumberToString(i), value);
+    reader->ReleaseSnapshot(snapshot);
+  }
+
+  // A descriptor record with an older sequence number than the logs
+  // replayed so far does not take it back
+  delete db_;
+  db_ = NULL;
+  std::string current;
+  ASSERT_OK(ReadFileToString(env_, CurrentFileName(dbname_), &current));
+  current.resize(current.size() - 1);
+  WritableFile* file;
+  ASSERT_OK(env_->NewAppendableFile(dbname_ + "/" + current, &file));
+  {
+    VersionEdit edit;
+    edit.SetLastSequence(1);
+    std::string record;
+    edit.EncodeTo(&record);
+    log::Writer log(file);
+    ASSERT_OK(log.AddRecord(record));
+  }
+  ASSERT_OK(file->Close());
+  delete file;
+  ASSERT_OK(reader->CatchUp());
+  ASSERT_EQ(last + 1, reader->GetLatestSequenceNumber());
+  ASSERT_EQ("later", ReaderGet(reader, "x"));
+  ASSERT_EQ("v19", ReaderGet(reader, "k4"));
+  delete reader;
+  Reopen();
+}
+
+TEST(DBTest, Checkpoint) {
+  const std::string dir = dbname_ + "_checkpoint";
+  DestroyDB(dir, Options());
+
+  ASSERT_OK(Put("a", "v1"));
+  ASSERT_OK(Put("b", "v1"));
+  ASSERT_OK(Put("c", "v1"));
+  Compact("a", "z");
+  ASSERT_OK(Put("b", "v2"));            // In the memtable
+  ASSERT_OK(DeleteRange("c", "e"));     // Hides a table file entry
+  ASSERT_OK(Put("d", "v1"));
+  ASSERT_OK(db_->Checkpoint(dir));
+  ASSERT_TRUE(!db_->Checkpoint(dir).ok());
+
+  // Later writes and compactions leave the checkpoint alone
+  ASSERT_OK(Put("a", "v3"));
+  ASSERT_OK(Delete("b"));
+  Compact("a", "z");
+  ASSERT_EQ("(a->v3)(d->v1)", Contents());
+
+  DB* db;
+  ASSERT_OK(DB::Open(Options(), dir, &db));
+  std::string result;
+  Iterator* iter = db->NewIterator(ReadOptions());
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    result += "(" + iter->key().ToString() + "->" +
+              iter->value().ToString() + ")";
+  }
+  delete iter;
+  ASSERT_EQ("(a->v1)(b->v2)(d->v1)", result);
+
+  // The checkpoint is a database of its own
+  ASSERT_OK(db->Put(WriteOptions(), "e", "v1"));
+  delete db;
+  ASSERT_OK(DB::Open(Options(), dir, &db));
+  std::string value;
+  ASSERT_OK(db->Get(ReadOptions(), "e", &value));
+  ASSERT_EQ("v1", value);
+  delete db;
+  ASSERT_EQ("(a->v3)(d->v1)", Contents());
+  ASSERT_OK(DestroyDB(dir, Options()));
+}
+
+TEST(DBTest, Warmup) {
+  MakeTables(3, "a", "z");
+  ASSERT_OK(Put("b", "v"));
+  dbfull()->TEST_CompactRange(0, NULL, NULL);
+  MakeTables(2, "c", "y");
+  ASSERT_GT(NumTableFilesAtLevel(0), 0);
+  ASSERT_GT(NumTableFilesAtLevel(1), 0);
+
+  // Level-0 only
+  WarmupProgress p = { 0, 0, 0 };
+  ASSERT_OK(db_->Warmup(ReadOptions(), 0, 0, &RecordWarmupProgress, &p));
+  ASSERT_EQ(p.calls, NumTableFilesAtLevel(0));
+  ASSERT_EQ(p.done, p.total);
+  const uint64_t level0_bytes = p.total;
+
+  // All levels
+  p.calls = 0;
+  p.done = 0;
+  ASSERT_OK(db_->Warmup(ReadOptions(), config::kNumLevels - 1, 0,
+                        &RecordWarmupProgress, &p));
+  ASSERT_EQ(p.calls, TotalTableFiles());
+  ASSERT_GT(p.total, level0_bytes);
+
+  // Byte budget smaller than the first file
+  p.calls = 0;
+  p.done = 0;
+  ASSERT_OK(db_->Warmup(ReadOptions(), config::kNumLevels - 1, 1,
+                        &RecordWarmupProgress, &p));
+  ASSERT_EQ(p.calls, 0);
+
+  ASSERT_OK(db_->Warmup(ReadOptions(), config::kNumLevels - 1, 0, NULL, NULL));
+  ASSERT_EQ("v", Get("b"));
+}
+
+TEST(DBTest, ApproximateMemoryUsage) {
+  Options options;
+  options.create_if_missing = true;
+  options.write_buffer_size = 8 << 20;
+  options.arena_block_size = 1 << 20;
+  DestroyAndReopen(&options);
+
+  std::string usage;
+  ASSERT_TRUE(db_->GetProperty("leveldb.approximate-memory-usage", &usage));
+  const uint64_t empty_usage = atoll(usage.c_str());
+
+  Random rnd(301);
+  const int N = 1000;
+  for (int i = 0; i < N; i++) {
+    ASSERT_OK(Put(Key(i), RandomString(&rnd, 4000)));
+  }
+  ASSERT_TRUE(db_->GetProperty("leveldb.approximate-memory-usage", &usage));
+  const uint64_t full_usage = atoll(usage.c_str());
+  ASSERT_GE(full_usage, empty_usage + N * 4000);
+  ASSERT_LE(full_usage, empty_usage + N * 4000 * 1.2);
+  for (int i = 0; i < N; i += 100) {
+    ASSERT_EQ(4000, Get(Key(i)).size());
+  }
+}
+
+TEST(DBTest, LiveSnapshotsAndIterators) {
+  FakeClockEnv clock(env_);
+  clock.now_micros_ = 1000 * 1000000ull;
+  Options options;
+  options.env = &clock;
+  Reopen(&options);
+
+  std::string num, age;
+  ASSERT_TRUE(db_->GetProperty("leveldb.num-snapshots", &num));
+  ASSERT_TRUE(db_->GetProperty("leveldb.oldest-snapshot-age", &age));
+  ASSERT_EQ("0", num);
+  ASSERT_EQ("0", age);
+
+  const Snapshot* s1 = db_->GetSnapshot();
+  clock.now_micros_ += 30 * 1000000ull;
+  Iterator* i1 = db_->NewIterator(ReadOptions());
+  const Snapshot* s2 = db_->GetSnapshot();
+  clock.now_micros_ += 20 * 1000000ull;
+  Iterator* i2 = db_->NewIterator(ReadOptions());
+  ASSERT_TRUE(db_->GetProperty("leveldb.num-snapshots", &num));
+  ASSERT_TRUE(db_->GetProperty("leveldb.oldest-snapshot-age", &age));
+  ASSERT_EQ("2", num);
+  ASSERT_EQ("50", age);
+  ASSERT_TRUE(db_->GetProperty("leveldb.num-iterators", &num));
+  ASSERT_TRUE(db_->GetProperty("leveldb.oldest-iterator-age", &age));
+  ASSERT_EQ("2", num);
+  ASSERT_EQ("20", age);
+
+  // Releasing the oldest makes the next one the oldest
+  db_->ReleaseSnapshot(s1);
+  delete i1;
+  ASSERT_TRUE(db_->GetProperty("leveldb.oldest-snapshot-age", &age));
+  ASSERT_EQ("20", age);
+  ASSERT_TRUE(db_->GetProperty("leveldb.oldest-iterator-age", &age));
+  ASSERT_EQ("0", age);
+
+  db_->ReleaseSnapshot(s2);
+  delete i2;
+  ASSERT_TRUE(db_->GetProperty("leveldb.num-snapshots", &num));
+  ASSERT_EQ("0", num);
+  ASSERT_TRUE(db_->GetProperty("leveldb.num-iterators", &num));
+  ASSERT_EQ("0", num);
+
+  delete db_;
+  db_ = NULL;
+}
+
+namespace {
+struct ReaderState {
+  DBTest* test;
+  port::AtomicPointer done;
+};
+
+static void ReadAndExit(void* arg) {
+  ReaderState* state = reinterpret_cast<ReaderState*>(arg);
+  ASSERT_EQ("v2", state->test->Get("foo"));
+  state->done.Release_Store(state);
+}
+}  // namespace
+
+TEST(DBTest, ReadViews) {
+  ASSERT_OK(Put("foo", "v1"));
+  ASSERT_EQ("v1", Get("foo"));
+  Iterator* iter = db_->NewIterator(ReadOptions());
+
+  // Switching memtables replaces the view this thread has cached, while
+  // the iterator keeps reading from its own.
+  ASSERT_OK(dbfull()->TEST_CompactMemTable());
+  ASSERT_OK(Put("foo", "v2"));
+  ASSERT_EQ("v2", Get("foo"));
+  iter->SeekToFirst();
+  ASSERT_EQ(IterStatus(iter), "foo->v1");
+  delete iter;
+
+  // Views cached by threads that have exited are released on close
+  ReaderState state[4];
+  for (int i = 0; i < 4; i++) {
+    state[i].test = this;
+    state[i].done.Release_Store(NULL);
+    env_->StartThread(ReadAndExit, &state[i]);
+  }
+  for (int i = 0; i < 4; i++) {
+    while (state[i].done.Acquire_Load() == NULL) {
+      env_->SleepForMicroseconds(1000);
+    }
+  }
+  Reopen();
+  ASSERT_EQ("v2", Get("foo"));
+}
+
 // Multi-threaded test:
 namespace {
 
@@ -1378,12 +2375,10 @@ static void MTThreadBody(void* arg) {
   fprintf(stderr, "... stopping thread %d after %d ops\n", id, int(counter));
 }
 
-}  // namespace
-
-TEST(DBTest, MultiThreaded) {
+static void RunMultiThreaded(DBTest* test, Env* env) {
   // Initialize state
   MTState mt;
-  mt.test = this;
+  mt.test = test;
   mt.stop.Release_Store(0);
   for (int id = 0; id < kNumThreads; id++) {
     mt.counter[id].Release_Store(0);
@@ -1395,21 +2390,62 @@ TEST(DBTest, MultiThreaded) {
   for (int id = 0; id < kNumThreads; id++) {
     thread[id].state = &mt;
     thread[id].id = id;
-    env_->StartThread(MTThreadBody, &thread[id]);
+    env->StartThread(MTThreadBody, &thread[id]);
   }
 
   // Let them run for a while
-  env_->SleepForMicroseconds(kTestSeconds * 1000000);
+  env->SleepForMicroseconds(kTestSeconds * 1000000);
 
   // Stop the threads and wait for them to finish
   mt.stop.Release_Store(&mt);
   for (int id = 0; id < kNumThreads; id++) {
     while (mt.thread_done[id].Acquire_Load() == NULL) {
-      env_->SleepForMicroseconds(100000);
+      env->SleepForMicroseconds(100000);
     }
   }
 }
 
+}  // namespace
+
+TEST(DBTest, MultiThreaded) {
+  RunMultiThreaded(this, env_);
+}
+
+TEST(DBTest, MultiThreadedConcurrentMemtableWrite) {
+  Options options;
+  options.create_if_missing = true;
+  options.allow_concurrent_memtable_write = true;
+  options.write_buffer_size = 100000;  // Small write buffer
+  DestroyAndReopen(&options);
+  RunMultiThreaded(this, env_);
+}
+
+TEST(DBTest, ConcurrentMemtableWriteBatches) {
+  Options options;
+  options.create_if_missing = true;
+  options.allow_concurrent_memtable_write = true;
+  DestroyAndReopen(&options);
+
+  WriteBatch batch;
+  batch.Put("a", "v1");
+  batch.Put("b", "v1");
+  batch.Delete("a");
+  ASSERT_OK(dbfull()->Write(WriteOptions(), &batch));
+  ASSERT_EQ("NOT_FOUND", Get("a"));
+  ASSERT_EQ("v1", Get("b"));
+
+  // An empty batch must not stall later writers
+  WriteBatch empty;
+  ASSERT_OK(dbfull()->Write(WriteOptions(), &empty));
+  ASSERT_OK(Put("c", "v2"));
+  ASSERT_EQ("v2", Get("c"));
+
+  Reopen(&options);
+  ASSERT_EQ("NOT_FOUND", Get("a"));
+  ASSERT_EQ("v1", Get("b"));
+  ASSERT_EQ("v2", Get("c"));
+}
+
 namespace {
 typedef std::map<std::string, std::string> KVMap;
 }
@@ -1464,6 +2500,12 @@ class ModelDB: public DB {
       virtual void Delete(const Slice& key) {
         map_->erase(key.ToString());
       }
+      virtual void DeleteRange(const Slice& start, const Slice& limit) {
+        if (start.compare(limit) < 0) {
+          map_->erase(map_->lower_bound(start.ToString()),
+                      map_->lower_bound(limit.ToString()));
+        }
+      }
     };
     Handler handler;
     handler.map_ = &map_;
@@ -1480,6 +2522,13 @@ class ModelDB: public DB {
   }
   virtual void CompactRange(const Slice* start, const Slice* end) {
   }
+  virtual Status Warmup(const ReadOptions& options,
+                        int max_level, uint64_t max_bytes,
+                        void (*progress)(void* arg, uint64_t done,
+                                         uint64_t total),
+                        void* arg) {
+    return Status::OK();
+  }
 
  private:
   class ModelIter: public Iterator {
@@ -1608,7 +2657,9 @@ TEST(DBTest, Randomized) {
           // Periodically re-use the same key from the previous iter, so
           // we have multiple entries in the write batch for the same key
         }
-        if (rnd.OneIn(2)) {
+        if (rnd.OneIn(20)) {
+          b.DeleteRange(k, RandomKey(&rnd));
+        } else if (rnd.OneIn(2)) {
           v = RandomString(&rnd, rnd.Uniform(10));
           b.Put(k, v);
         } else {
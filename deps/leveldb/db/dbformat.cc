@@ -4,6 +4,7 @@
 
 #include <stdio.h>
 #include "db/dbformat.h"
+#include "leveldb/merge_operator.h"
 #include "port/port.h"
 #include "util/coding.h"
 
@@ -117,4 +118,35 @@ LookupKey::LookupKey(const Slice& user_key, SequenceNumber s) {
   end_ = dst;
 }
 
+void MergeOperandList::DropOlderThan(SequenceNumber sequence) {
+  size_t n = 0;
+  while (n < sequences_.size() && sequences_[n] >= sequence) {
+    n++;
+  }
+  operands_.resize(n);
+  sequences_.resize(n);
+}
+
+Status MergeOperandList::Apply(const MergeOperator* op,
+                               const Slice& user_key,
+                               const Slice* existing_value,
+                               std::string* result) const {
+  if (op == NULL) {
+    return Status::NotSupported("merge operand without a merge operator");
+  }
+  assert(!operands_.empty());
+  std::string merged, tmp;
+  Slice merged_slice;
+  for (size_t i = operands_.size(); i > 0; i--) {
+    if (!op->Merge(user_key, existing_value, operands_[i - 1], &tmp)) {
+      return Status::Corruption("merge failed for ", user_key);
+    }
+    merged.swap(tmp);
+    merged_slice = merged;
+    existing_value = &merged_slice;
+  }
+  result->swap(merged);
+  return Status::OK();
+}
+
 }  // namespace leveldb
@@ -6,6 +6,8 @@
 #define STORAGE_LEVELDB_DB_FORMAT_H_
 
 #include <stdio.h>
+#include <string>
+#include <vector>
 #include "leveldb/comparator.h"
 #include "leveldb/db.h"
 #include "leveldb/slice.h"
@@ -15,6 +17,8 @@
 
 namespace leveldb {
 
+class MergeOperator;
+
 // Grouping of constants.  We may want to make some of these
 // parameters set via options.
 namespace config {
@@ -46,7 +50,9 @@ class InternalKey;
 // data structures.
 enum ValueType {
   kTypeDeletion = 0x0,
-  kTypeValue = 0x1
+  kTypeValue = 0x1,
+  kTypeRangeDeletion = 0x2,  // Only in write batches and memtables
+  kTypeMerge = 0x3
 };
 // kValueTypeForSeek defines the ValueType that should be passed when
 // constructing a ParsedInternalKey object for seeking to a particular
@@ -54,7 +60,7 @@ enum ValueType {
 // and the value type is embedded as the low 8 bits in the sequence
 // number in internal keys, we need to use the highest-numbered
 // ValueType, not the lowest).
-static const ValueType kValueTypeForSeek = kTypeValue;
+static const ValueType kValueTypeForSeek = kTypeMerge;
 
 typedef uint64_t SequenceNumber;
 
@@ -167,7 +173,7 @@ inline bool ParseInternalKey(const Slice& internal_key,
   result->sequence = num >> 8;
   result->type = static_cast<ValueType>(c);
   result->user_key = Slice(internal_key.data(), n - 8);
-  return (c <= static_cast<unsigned char>(kTypeValue));
+  return (c <= static_cast<unsigned char>(kTypeMerge));
 }
 
 // A helper class useful for DBImpl::Get()
@@ -210,6 +216,36 @@ inline LookupKey::~LookupKey() {
   if (start_ != space_) delete[] start_;
 }
 
+// The merge operands met by a lookup on its way to the value or
+// deletion of a key, newest first.
+class MergeOperandList {
+ public:
+  bool empty() const { return operands_.empty(); }
+
+  void Clear() {
+    operands_.clear();
+    sequences_.clear();
+  }
+
+  void Add(const Slice& operand, SequenceNumber sequence) {
+    operands_.push_back(operand.ToString());
+    sequences_.push_back(sequence);
+  }
+
+  // Forget the operands with sequence numbers below "sequence", e.g.
+  // because a range tombstone with that sequence number hides them.
+  void DropOlderThan(SequenceNumber sequence);
+
+  // Merge the operands, oldest first, into "*existing_value" (NULL if
+  // there is none) with "op", and store the result in *result.
+  Status Apply(const MergeOperator* op, const Slice& user_key,
+               const Slice* existing_value, std::string* result) const;
+
+ private:
+  std::vector<std::string> operands_;
+  std::vector<SequenceNumber> sequences_;
+};
+
 }  // namespace leveldb
 
 #endif  // STORAGE_LEVELDB_DB_FORMAT_H_
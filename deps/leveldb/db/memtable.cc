@@ -21,7 +21,19 @@ static Slice GetLengthPrefixedSlice(const char* data) {
 MemTable::MemTable(const InternalKeyComparator& cmp)
     : comparator_(cmp),
       refs_(0),
-      table_(comparator_, &arena_) {
+      table_(comparator_, &arena_),
+      tombstones_(comparator_, &arena_),
+      has_tombstones_(false) {
+}
+
+MemTable::MemTable(const InternalKeyComparator& cmp,
+                   size_t arena_block_size, bool huge_pages)
+    : comparator_(cmp),
+      refs_(0),
+      arena_(arena_block_size, huge_pages),
+      table_(comparator_, &arena_),
+      tombstones_(comparator_, &arena_),
+      has_tombstones_(false) {
 }
 
 MemTable::~MemTable() {
@@ -79,37 +91,66 @@ Iterator* MemTable::NewIterator() {
   return new MemTableIterator(&table_);
 }
 
-void MemTable::Add(SequenceNumber s, ValueType type,
-                   const Slice& key,
-                   const Slice& value) {
-  // Format of an entry is concatenation of:
-  //  key_size     : varint32 of internal_key.size()
-  //  key bytes    : char[internal_key.size()]
-  //  value_size   : varint32 of value.size()
-  //  value bytes  : char[value.size()]
+Iterator* MemTable::NewRangeTombstoneIterator() {
+  return new MemTableIterator(&tombstones_);
+}
+
+// Format of an entry is concatenation of:
+//  key_size     : varint32 of internal_key.size()
+//  key bytes    : char[internal_key.size()]
+//  value_size   : varint32 of value.size()
+//  value bytes  : char[value.size()]
+static size_t EncodedEntryLength(const Slice& key, const Slice& value) {
+  size_t internal_key_size = key.size() + 8;
+  return VarintLength(internal_key_size) + internal_key_size +
+      VarintLength(value.size()) + value.size();
+}
+
+static void EncodeEntry(char* buf, SequenceNumber s, ValueType type,
+                        const Slice& key, const Slice& value) {
   size_t key_size = key.size();
   size_t val_size = value.size();
-  size_t internal_key_size = key_size + 8;
-  const size_t encoded_len =
-      VarintLength(internal_key_size) + internal_key_size +
-      VarintLength(val_size) + val_size;
-  char* buf = arena_.Allocate(encoded_len);
-  char* p = EncodeVarint32(buf, internal_key_size);
+  char* p = EncodeVarint32(buf, key_size + 8);
   memcpy(p, key.data(), key_size);
   p += key_size;
   EncodeFixed64(p, (s << 8) | type);
   p += 8;
   p = EncodeVarint32(p, val_size);
   memcpy(p, value.data(), val_size);
-  assert((p + val_size) - buf == encoded_len);
-  table_.Insert(buf);
+  assert((p + val_size) - buf == EncodedEntryLength(key, value));
+}
+
+void MemTable::Add(SequenceNumber s, ValueType type,
+                   const Slice& key,
+                   const Slice& value) {
+  char* buf = arena_.Allocate(EncodedEntryLength(key, value));
+  EncodeEntry(buf, s, type, key, value);
+  if (type == kTypeRangeDeletion) {
+    tombstones_.Insert(buf);
+    has_tombstones_ = true;
+  } else {
+    table_.Insert(buf);
+  }
+}
+
+void MemTable::AddConcurrently(SequenceNumber s, ValueType type,
+                               const Slice& key,
+                               const Slice& value) {
+  char* buf = arena_.AllocateConcurrently(EncodedEntryLength(key, value));
+  EncodeEntry(buf, s, type, key, value);
+  if (type == kTypeRangeDeletion) {
+    tombstones_.InsertConcurrently(buf);
+    has_tombstones_ = true;
+  } else {
+    table_.InsertConcurrently(buf);
+  }
 }
 
-bool MemTable::Get(const LookupKey& key, std::string* value, Status* s) {
+bool MemTable::Get(const LookupKey& key, std::string* value, Status* s,
+                   SequenceNumber* seq, MergeOperandList* operands) {
   Slice memkey = key.memtable_key();
   Table::Iterator iter(&table_);
-  iter.Seek(memkey.data());
-  if (iter.Valid()) {
+  for (iter.Seek(memkey.data()); iter.Valid(); iter.Next()) {
     // entry format is:
     //    klength  varint32
     //    userkey  char[klength]
@@ -124,22 +165,58 @@ bool MemTable::Get(const LookupKey& key, std::string* value, Status* s) {
     const char* key_ptr = GetVarint32Ptr(entry, entry+5, &key_length);
     if (comparator_.comparator.user_comparator()->Compare(
             Slice(key_ptr, key_length - 8),
-            key.user_key()) == 0) {
-      // Correct user key
-      const uint64_t tag = DecodeFixed64(key_ptr + key_length - 8);
-      switch (static_cast<ValueType>(tag & 0xff)) {
-        case kTypeValue: {
-          Slice v = GetLengthPrefixedSlice(key_ptr + key_length);
-          value->assign(v.data(), v.size());
-          return true;
-        }
-        case kTypeDeletion:
-          *s = Status::NotFound(Slice());
-          return true;
+            key.user_key()) != 0) {
+      break;
+    }
+    // Correct user key
+    const uint64_t tag = DecodeFixed64(key_ptr + key_length - 8);
+    switch (static_cast<ValueType>(tag & 0xff)) {
+      case kTypeValue: {
+        Slice v = GetLengthPrefixedSlice(key_ptr + key_length);
+        value->assign(v.data(), v.size());
+        *seq = tag >> 8;
+        return true;
       }
+      case kTypeDeletion:
+        *s = Status::NotFound(Slice());
+        *seq = tag >> 8;
+        return true;
+      case kTypeMerge:
+        // Keep looking for what the operand applies to
+        operands->Add(GetLengthPrefixedSlice(key_ptr + key_length), tag >> 8);
+        break;
+      case kTypeRangeDeletion:
+        return false;
     }
   }
   return false;
 }
 
+SequenceNumber MemTable::MaxCoveringTombstone(const Slice& user_key,
+                                              SequenceNumber snapshot) {
+  if (!has_tombstones_) {
+    return 0;
+  }
+  const Comparator* ucmp = comparator_.comparator.user_comparator();
+  SequenceNumber result = 0;
+  Table::Iterator iter(&tombstones_);
+  for (iter.SeekToFirst(); iter.Valid(); iter.Next()) {
+    const char* entry = iter.key();
+    uint32_t key_length;
+    const char* key_ptr = GetVarint32Ptr(entry, entry+5, &key_length);
+    Slice start(key_ptr, key_length - 8);
+    if (ucmp->Compare(start, user_key) > 0) {
+      // Tombstones are ordered by start key, so none of the rest apply
+      break;
+    }
+    const SequenceNumber seq = DecodeFixed64(key_ptr + key_length - 8) >> 8;
+    if (seq <= snapshot && seq > result &&
+        ucmp->Compare(user_key,
+                      GetLengthPrefixedSlice(key_ptr + key_length)) < 0) {
+      result = seq;
+    }
+  }
+  return result;
+}
+
 }  // namespace leveldb
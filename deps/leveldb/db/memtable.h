@@ -23,6 +23,11 @@ class MemTable {
   // is zero and the caller must call Ref() at least once.
   explicit MemTable(const InternalKeyComparator& comparator);
 
+  // Like the above, but the memtable's arena allocates blocks of up to
+  // "arena_block_size" bytes, optionally backed by huge pages (see Arena).
+  MemTable(const InternalKeyComparator& comparator,
+           size_t arena_block_size, bool huge_pages);
+
   // Increase reference count.
   void Ref() { ++refs_; }
 
@@ -50,18 +55,45 @@ class MemTable {
   // db/format.{h,cc} module.
   Iterator* NewIterator();
 
+  // Return an iterator over the range tombstones in the memtable.  Keys
+  // are internal keys holding the start of each deleted range, values
+  // hold the (exclusive) end of the range.
+  Iterator* NewRangeTombstoneIterator();
+
   // Add an entry into memtable that maps key to value at the
   // specified sequence number and with the specified type.
-  // Typically value will be empty if type==kTypeDeletion.
+  // Typically value will be empty if type==kTypeDeletion.  If
+  // type==kTypeRangeDeletion, the user keys in [key,value) are deleted.
   void Add(SequenceNumber seq, ValueType type,
            const Slice& key,
            const Slice& value);
 
+  // Like Add(), but may be called by several threads at once.  Callers
+  // must not mix Add() and AddConcurrently() on the same memtable without
+  // external synchronization.
+  void AddConcurrently(SequenceNumber seq, ValueType type,
+                       const Slice& key,
+                       const Slice& value);
+
   // If memtable contains a value for key, store it in *value and return true.
   // If memtable contains a deletion for key, store a NotFound() error
-  // in *status and return true.
+  // in *status and return true.  In both cases the sequence number of
+  // the entry is stored in *seq.
   // Else, return false.
-  bool Get(const LookupKey& key, std::string* value, Status* s);
+  //
+  // Merge operands newer than the value or deletion are added to
+  // *operands.  Range tombstones are not consulted; see
+  // MaxCoveringTombstone().
+  bool Get(const LookupKey& key, std::string* value, Status* s,
+           SequenceNumber* seq, MergeOperandList* operands);
+
+  // Return the sequence number of the newest range tombstone that is
+  // visible at "snapshot" and covers "user_key", or zero if none does.
+  SequenceNumber MaxCoveringTombstone(const Slice& user_key,
+                                      SequenceNumber snapshot);
+
+  // Returns true iff the memtable holds any range tombstones.
+  bool HasRangeTombstones() const { return has_tombstones_; }
 
  private:
   ~MemTable();  // Private since only Unref() should be used to delete it
@@ -80,6 +112,8 @@ class MemTable {
   int refs_;
   Arena arena_;
   Table table_;
+  Table tombstones_;          // Range tombstones, ordered by start key
+  bool has_tombstones_;
 
   // No copying allowed
   MemTable(const MemTable&);
@@ -0,0 +1,86 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "db/range_tombstone.h"
+
+#include <algorithm>
+#include "leveldb/comparator.h"
+
+namespace leveldb {
+
+struct RangeTombstoneSet::BoundLess {
+  const Comparator* ucmp;
+  explicit BoundLess(const Comparator* c) : ucmp(c) { }
+  bool operator()(const std::string& a, const std::string& b) const {
+    return ucmp->Compare(a, b) < 0;
+  }
+  bool operator()(const std::string& a, const Slice& b) const {
+    return ucmp->Compare(a, b) < 0;
+  }
+  bool operator()(const Slice& a, const std::string& b) const {
+    return ucmp->Compare(a, b) < 0;
+  }
+};
+
+RangeTombstoneSet::RangeTombstoneSet(const Comparator* user_comparator)
+    : ucmp_(user_comparator) {
+}
+
+void RangeTombstoneSet::Add(const Slice& start, const Slice& end,
+                            SequenceNumber sequence) {
+  assert(bounds_.empty());
+  if (ucmp_->Compare(start, end) >= 0) {
+    // Empty range
+    return;
+  }
+  Tombstone t;
+  t.start = start.ToString();
+  t.end = end.ToString();
+  t.sequence = sequence;
+  tombstones_.push_back(t);
+}
+
+void RangeTombstoneSet::Finish(SequenceNumber snapshot) {
+  BoundLess less(ucmp_);
+  for (size_t i = 0; i < tombstones_.size(); i++) {
+    if (tombstones_[i].sequence <= snapshot) {
+      bounds_.push_back(tombstones_[i].start);
+      bounds_.push_back(tombstones_[i].end);
+    }
+  }
+  std::sort(bounds_.begin(), bounds_.end(), less);
+  size_t n = 0;
+  for (size_t i = 0; i < bounds_.size(); i++) {
+    if (n == 0 || less(bounds_[n - 1], bounds_[i])) {
+      if (n != i) bounds_[n].swap(bounds_[i]);
+      n++;
+    }
+  }
+  bounds_.resize(n);
+  seqs_.assign(n, 0);
+
+  for (size_t i = 0; i < tombstones_.size(); i++) {
+    const Tombstone& t = tombstones_[i];
+    if (t.sequence > snapshot) continue;
+    size_t f = std::lower_bound(bounds_.begin(), bounds_.end(), t.start, less)
+        - bounds_.begin();
+    for (; f < n && less(bounds_[f], t.end); f++) {
+      seqs_[f] = std::max(seqs_[f], t.sequence);
+    }
+  }
+  tombstones_.clear();
+}
+
+SequenceNumber RangeTombstoneSet::MaxCoveringSequence(
+    const Slice& user_key) const {
+  // Find the last boundary <= user_key
+  std::vector<std::string>::const_iterator it = std::upper_bound(
+      bounds_.begin(), bounds_.end(), user_key, BoundLess(ucmp_));
+  if (it == bounds_.begin()) {
+    return 0;
+  }
+  return seqs_[(it - bounds_.begin()) - 1];
+}
+
+}  // namespace leveldb
@@ -0,0 +1,71 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef STORAGE_LEVELDB_DB_RANGE_TOMBSTONE_H_
+#define STORAGE_LEVELDB_DB_RANGE_TOMBSTONE_H_
+
+#include <string>
+#include <vector>
+#include "db/dbformat.h"
+
+namespace leveldb {
+
+class Comparator;
+
+// A RangeTombstoneSet answers "which is the newest range tombstone that
+// covers this key?" for a fixed collection of tombstones.  The
+// tombstones are flattened into non-overlapping fragments, so each
+// lookup is a binary search.  Used by iterators and compactions, which
+// check every entry they see.
+class RangeTombstoneSet {
+ public:
+  explicit RangeTombstoneSet(const Comparator* user_comparator);
+
+  // Add a deletion of the user keys in [start,end) at "sequence".
+  // REQUIRES: Finish() has not been called
+  void Add(const Slice& start, const Slice& end, SequenceNumber sequence);
+
+  // Build the lookup structure.  Tombstones newer than "snapshot" are
+  // ignored.  Must be called exactly once, after all calls to Add().
+  void Finish(SequenceNumber snapshot);
+
+  // Returns true iff the set holds no visible tombstones.
+  // REQUIRES: Finish() has been called
+  bool empty() const { return bounds_.empty(); }
+
+  // Return the sequence number of the newest tombstone covering
+  // "user_key", or zero if no tombstone covers it.
+  // REQUIRES: Finish() has been called
+  SequenceNumber MaxCoveringSequence(const Slice& user_key) const;
+
+  // Returns true iff an entry for "user_key" written at "sequence" is
+  // hidden by a tombstone in this set.
+  bool Covers(const Slice& user_key, SequenceNumber sequence) const {
+    return !empty() && MaxCoveringSequence(user_key) > sequence;
+  }
+
+ private:
+  struct Tombstone {
+    std::string start;
+    std::string end;
+    SequenceNumber sequence;
+  };
+  struct BoundLess;
+
+  const Comparator* const ucmp_;
+  std::vector<Tombstone> tombstones_;
+
+  // Sorted, distinct fragment boundaries.  seqs_[i] is the sequence of
+  // the newest tombstone covering [bounds_[i],bounds_[i+1]), or zero.
+  std::vector<std::string> bounds_;
+  std::vector<SequenceNumber> seqs_;
+
+  // No copying allowed
+  RangeTombstoneSet(const RangeTombstoneSet&);
+  void operator=(const RangeTombstoneSet&);
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_DB_RANGE_TOMBSTONE_H_
@@ -11,9 +11,12 @@
 //      - log number is set to zero
 //      - next-file-number is set to 1 + largest file number we found
 //      - last-sequence-number is set to largest sequence# found across
-//        all tables (see 2c)
+//        all tables and range tombstones (see 2c)
 //      - compaction pointers are cleared
 //      - every table file is added at level 0
+//      - range tombstones are read back from the old descriptors and
+//        from the logs converted in (1); every table may hold entries
+//        they hide
 //
 // Possible optimization 1:
 //   (a) Compute total size and use to pick appropriate max-level M
@@ -24,6 +27,7 @@
 //   Store per-table metadata (smallest, largest, largest-seq#, ...)
 //   in the table's meta section to speed up ScanTable.
 
+#include <map>
 #include "db/builder.h"
 #include "db/db_impl.h"
 #include "db/dbformat.h"
@@ -69,6 +73,7 @@ class Repairer {
   Status Run() {
     Status status = FindFiles();
     if (status.ok()) {
+      RecoverRangeTombstones();
       ConvertLogFilesToTables();
       ExtractMetaData();
       status = WriteDescriptor();
@@ -111,6 +116,9 @@ class Repairer {
   std::vector<TableInfo> tables_;
   uint64_t next_file_number_;
 
+  // Range tombstones by sequence number
+  std::map<SequenceNumber, RangeTombstone> tombstones_;
+
   Status FindFiles() {
     std::vector<std::string> filenames;
     Status status = env_->GetChildren(dbname_, &filenames);
@@ -144,6 +152,71 @@ class Repairer {
     return status;
   }
 
+  struct ReadReporter : public log::Reader::Reporter {
+    Logger* info_log;
+    const char* fname;
+    virtual void Corruption(size_t bytes, const Status& s) {
+      Log(info_log, "%s: dropping %d bytes; %s",
+          fname, static_cast<int>(bytes), s.ToString().c_str());
+    }
+  };
+
+  // Range tombstones that have left the memtable live only in the
+  // descriptor, so replay the edits of every descriptor we find, oldest
+  // first.  A tombstone read from a stale descriptor only costs space:
+  // it was forgotten because no table held anything it hides.
+  void RecoverRangeTombstones() {
+    std::map<uint64_t, std::string> manifests;
+    for (size_t i = 0; i < manifests_.size(); i++) {
+      uint64_t number;
+      FileType type;
+      if (ParseFileName(manifests_[i], &number, &type)) {
+        manifests[number] = dbname_ + "/" + manifests_[i];
+      }
+    }
+
+    std::map<uint64_t, std::string>::const_iterator it;
+    for (it = manifests.begin(); it != manifests.end(); ++it) {
+      SequentialFile* file;
+      Status status = env_->NewSequentialFile(it->second, &file);
+      if (!status.ok()) {
+        Log(options_.info_log, "%s: ignoring %s",
+            it->second.c_str(), status.ToString().c_str());
+        continue;
+      }
+      ReadReporter reporter;
+      reporter.info_log = options_.info_log;
+      reporter.fname = it->second.c_str();
+      log::Reader reader(file, &reporter, true/*checksum*/,
+                         0/*initial_offset*/);
+      Slice record;
+      std::string scratch;
+      while (reader.ReadRecord(&record, &scratch)) {
+        VersionEdit edit;
+        if (!edit.DecodeFrom(record).ok()) {
+          reporter.Corruption(record.size(),
+                              Status::Corruption("bad version edit"));
+          continue;
+        }
+        const std::set<SequenceNumber>& deleted =
+            edit.deleted_range_tombstones();
+        for (std::set<SequenceNumber>::const_iterator d = deleted.begin();
+             d != deleted.end(); ++d) {
+          tombstones_.erase(*d);
+        }
+        const std::vector<RangeTombstone>& added =
+            edit.new_range_tombstones();
+        for (size_t i = 0; i < added.size(); i++) {
+          tombstones_[added[i].sequence] = added[i];
+        }
+      }
+      delete file;
+    }
+    Log(options_.info_log, "Recovered %d range tombstones from %d descriptors",
+        static_cast<int>(tombstones_.size()),
+        static_cast<int>(manifests.size()));
+  }
+
   void ConvertLogFilesToTables() {
     for (size_t i = 0; i < logs_.size(); i++) {
       std::string logname = LogFileName(dbname_, logs_[i]);
@@ -195,7 +268,8 @@ class Repairer {
     std::string scratch;
     Slice record;
     WriteBatch batch;
-    MemTable* mem = new MemTable(icmp_);
+    MemTable* mem = new MemTable(icmp_, options_.arena_block_size,
+                                 options_.memtable_huge_pages);
     mem->Ref();
     int counter = 0;
     while (reader.ReadRecord(&record, &scratch)) {
@@ -224,6 +298,23 @@ class Repairer {
     Iterator* iter = mem->NewIterator();
     status = BuildTable(dbname_, env_, options_, table_cache_, iter, &meta);
     delete iter;
+
+    // The table cannot hold range tombstones, so keep them for the
+    // descriptor
+    if (mem->HasRangeTombstones()) {
+      Iterator* titer = mem->NewRangeTombstoneIterator();
+      for (titer->SeekToFirst(); titer->Valid(); titer->Next()) {
+        ParsedInternalKey ikey;
+        if (ParseInternalKey(titer->key(), &ikey) &&
+            tombstones_.count(ikey.sequence) == 0) {
+          RangeTombstone& t = tombstones_[ikey.sequence];
+          t.sequence = ikey.sequence;
+          t.start = ikey.user_key.ToString();
+          t.end = titer->value().ToString();
+        }
+      }
+      delete titer;
+    }
     mem->Unref();
     mem = NULL;
     if (status.ok()) {
@@ -261,9 +352,20 @@ class Repairer {
     std::string fname = TableFileName(dbname_, t->meta.number);
     int counter = 0;
     Status status = env_->GetFileSize(fname, &t->meta.file_size);
+    if (status.ok()) {
+      // An ingested table records the sequence number of its entries
+      RandomAccessFile* file;
+      status = env_->NewRandomAccessFile(fname, &file);
+      if (status.ok()) {
+        status = ReadGlobalSequence(file, t->meta.file_size,
+                                    &t->meta.global_sequence);
+        delete file;
+      }
+    }
     if (status.ok()) {
       Iterator* iter = table_cache_->NewIterator(
-          ReadOptions(), t->meta.number, t->meta.file_size);
+          ReadOptions(), t->meta.number, t->meta.file_size,
+          t->meta.global_sequence);
       bool empty = true;
       ParsedInternalKey parsed;
       t->max_sequence = 0;
@@ -312,6 +414,11 @@ class Repairer {
         max_sequence = tables_[i].max_sequence;
       }
     }
+    if (!tombstones_.empty() &&
+        max_sequence < tombstones_.rbegin()->first) {
+      // Later writes must not be hidden by a recovered tombstone
+      max_sequence = tombstones_.rbegin()->first;
+    }
 
     edit_.SetComparatorName(icmp_.user_comparator()->Name());
     edit_.SetLogNumber(0);
@@ -322,7 +429,18 @@ class Repairer {
       // TODO(opt): separate out into multiple levels
       const TableInfo& t = tables_[i];
       edit_.AddFile(0, t.meta.number, t.meta.file_size,
-                    t.meta.smallest, t.meta.largest);
+                    t.meta.smallest, t.meta.largest,
+                    t.meta.global_sequence);
+    }
+
+    // Tables numbered below older_files were written before the tombstone
+    // and keep their numbers, but tables converted from logs may hold
+    // anything.
+    std::map<SequenceNumber, RangeTombstone>::iterator it;
+    for (it = tombstones_.begin(); it != tombstones_.end(); ++it) {
+      RangeTombstone& t = it->second;
+      t.hidden_files = next_file_number_;
+      edit_.AddRangeTombstone(t);
     }
 
     //fprintf(stderr, "NewDescriptor:\n%s\n", edit_.DebugString().c_str());
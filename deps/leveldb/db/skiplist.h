@@ -6,6 +6,8 @@
 // -------------
 //
 // Writes require external synchronization, most likely a mutex.
+// The exception is InsertConcurrently(), which may be called by any
+// number of threads at once (but never at the same time as Insert()).
 // Reads require a guarantee that the SkipList will not be destroyed
 // while the read is in progress.  Apart from that, reads progress
 // without any internal locking or synchronization.
@@ -18,9 +20,10 @@
 //
 // (2) The contents of a Node except for the next/prev pointers are
 // immutable after the Node has been linked into the SkipList.
-// Only Insert() modifies the list, and it is careful to initialize
-// a node and use release-stores to publish the nodes in one or
-// more lists.
+// Only Insert() and InsertConcurrently() modify the list, and they
+// are careful to initialize a node and use release-stores (or
+// compare-and-swap, which is a full barrier) to publish the nodes in
+// one or more lists.
 //
 // ... prev vs. next pointer ordering ...
 
@@ -49,6 +52,13 @@ class SkipList {
   // REQUIRES: nothing that compares equal to key is currently in the list.
   void Insert(const Key& key);
 
+  // Like Insert(), but safe to call from several threads at once.  Nodes
+  // are linked in with compare-and-swap, and the arena must support
+  // concurrent allocation (see Arena::AllocateAlignedConcurrently).
+  // REQUIRES: nothing that compares equal to key is currently in the list,
+  // and no thread is calling Insert() at the same time.
+  void InsertConcurrently(const Key& key);
+
   // Returns true iff an entry that compares equal to key is in the list.
   bool Contains(const Key& key) const;
 
@@ -100,8 +110,8 @@ class SkipList {
 
   Node* const head_;
 
-  // Modified only by Insert().  Read racily by readers, but stale
-  // values are ok.
+  // Modified only by Insert() and InsertConcurrently().  Read racily by
+  // readers, but stale values are ok.
   port::AtomicPointer max_height_;   // Height of the entire list
 
   inline int GetMaxHeight() const {
@@ -111,8 +121,14 @@ class SkipList {
   // Read/written only by Insert().
   Random rnd_;
 
+  // Random state shared by InsertConcurrently() callers.  Advanced with
+  // compare-and-swap so that each caller claims a distinct state.
+  port::AtomicPointer concurrent_seed_;
+
   Node* NewNode(const Key& key, int height);
+  Node* NewNodeConcurrently(const Key& key, int height);
   int RandomHeight();
+  int RandomHeightConcurrently();
   bool Equal(const Key& a, const Key& b) const { return (compare_(a, b) == 0); }
 
   // Return true if key is greater than the data stored in "n"
@@ -170,6 +186,14 @@ struct SkipList<Key,Comparator>::Node {
     next_[n].NoBarrier_Store(x);
   }
 
+  // Link x in after this node at level n, provided the current successor
+  // is still "expected".  The swap is a full barrier, so x is published
+  // fully initialized.
+  bool CASNext(int n, Node* expected, Node* x) {
+    assert(n >= 0);
+    return next_[n].CompareAndSwap(expected, x);
+  }
+
  private:
   // Array of length equal to the node height.  next_[0] is lowest level link.
   port::AtomicPointer next_[1];
@@ -183,6 +207,14 @@ SkipList<Key,Comparator>::NewNode(const Key& key, int height) {
   return new (mem) Node(key);
 }
 
+template<typename Key, class Comparator>
+typename SkipList<Key,Comparator>::Node*
+SkipList<Key,Comparator>::NewNodeConcurrently(const Key& key, int height) {
+  char* mem = arena_->AllocateAlignedConcurrently(
+      sizeof(Node) + sizeof(port::AtomicPointer) * (height - 1));
+  return new (mem) Node(key);
+}
+
 template<typename Key, class Comparator>
 inline SkipList<Key,Comparator>::Iterator::Iterator(const SkipList* list) {
   list_ = list;
@@ -248,6 +280,33 @@ int SkipList<Key,Comparator>::RandomHeight() {
   return height;
 }
 
+template<typename Key, class Comparator>
+int SkipList<Key,Comparator>::RandomHeightConcurrently() {
+  // Claim the next state of the shared generator, then draw the height
+  // from a private generator seeded with it.  This gives the same
+  // distribution as RandomHeight() with a single atomic operation.
+  uint32_t seed;
+  uint32_t next;
+  do {
+    seed = static_cast<uint32_t>(
+        reinterpret_cast<uintptr_t>(concurrent_seed_.NoBarrier_Load()));
+    Random rnd(seed);
+    next = rnd.Next();
+  } while (!concurrent_seed_.CompareAndSwap(
+               reinterpret_cast<void*>(static_cast<uintptr_t>(seed)),
+               reinterpret_cast<void*>(static_cast<uintptr_t>(next))));
+
+  static const unsigned int kBranching = 4;
+  Random rnd(next);
+  int height = 1;
+  while (height < kMaxHeight && ((rnd.Next() % kBranching) == 0)) {
+    height++;
+  }
+  assert(height > 0);
+  assert(height <= kMaxHeight);
+  return height;
+}
+
 template<typename Key, class Comparator>
 bool SkipList<Key,Comparator>::KeyIsAfterNode(const Key& key, Node* n) const {
   // NULL n is considered infinite
@@ -323,7 +382,8 @@ SkipList<Key,Comparator>::SkipList(Comparator cmp, Arena* arena)
       arena_(arena),
       head_(NewNode(0 /* any key will do */, kMaxHeight)),
       max_height_(reinterpret_cast<void*>(1)),
-      rnd_(0xdeadbeef) {
+      rnd_(0xdeadbeef),
+      concurrent_seed_(reinterpret_cast<void*>(0xdeadbeef)) {
   for (int i = 0; i < kMaxHeight; i++) {
     head_->SetNext(i, NULL);
   }
@@ -365,6 +425,47 @@ void SkipList<Key,Comparator>::Insert(const Key& key) {
   }
 }
 
+template<typename Key, class Comparator>
+void SkipList<Key,Comparator>::InsertConcurrently(const Key& key) {
+  int height = RandomHeightConcurrently();
+
+  // Raise max_height_ first so that the search below fills prev[] for
+  // every level the new node will occupy.  Readers tolerate a height
+  // that is ahead of the links actually present (see Insert()).
+  int max_height = GetMaxHeight();
+  while (height > max_height) {
+    if (max_height_.CompareAndSwap(reinterpret_cast<void*>(max_height),
+                                   reinterpret_cast<void*>(height))) {
+      break;
+    }
+    max_height = GetMaxHeight();
+  }
+
+  Node* prev[kMaxHeight];
+  Node* x = FindGreaterOrEqual(key, prev);
+
+  // Our data structure does not allow duplicate insertion
+  assert(x == NULL || !Equal(key, x->key));
+
+  x = NewNodeConcurrently(key, height);
+  for (int i = 0; i < height; i++) {
+    while (true) {
+      // Other threads may have linked nodes in after prev[i] since we
+      // searched; skip past any that sort before key.
+      Node* next = prev[i]->Next(i);
+      if (KeyIsAfterNode(key, next)) {
+        prev[i] = next;
+        continue;
+      }
+      assert(next == NULL || !Equal(key, next->key));
+      x->NoBarrier_SetNext(i, next);
+      if (prev[i]->CASNext(i, next, x)) {
+        break;
+      }
+    }
+  }
+}
+
 template<typename Key, class Comparator>
 bool SkipList<Key,Comparator>::Contains(const Key& key) const {
   Node* x = FindGreaterOrEqual(key, NULL);
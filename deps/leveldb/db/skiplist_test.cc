@@ -7,6 +7,7 @@
 #include "leveldb/env.h"
 #include "util/arena.h"
 #include "util/hash.h"
+#include "util/mutexlock.h"
 #include "util/random.h"
 #include "util/testharness.h"
 
@@ -371,6 +372,101 @@ TEST(SkipTest, Concurrent3) { RunConcurrent(3); }
 TEST(SkipTest, Concurrent4) { RunConcurrent(4); }
 TEST(SkipTest, Concurrent5) { RunConcurrent(5); }
 
+// Stress test for InsertConcurrently().  Several threads insert
+// disjoint random keys into one list at the same time; afterwards the
+// list must hold exactly the union of their keys, in order.
+class ConcurrentInsertState {
+ public:
+  static const int kPerThread = 20000;
+
+  Arena arena_;
+  SkipList<Key, Comparator> list_;
+  std::set<Key> expected_;
+  port::Mutex mu_;
+  port::CondVar cv_;
+  int seed_;
+  int next_id_;
+  int running_;
+
+  ConcurrentInsertState(int seed, int threads)
+      : list_(Comparator(), &arena_),
+        cv_(&mu_),
+        seed_(seed),
+        next_id_(0),
+        running_(threads) {
+  }
+
+  // Keys carry the thread id in their low byte, so no two threads ever
+  // insert the same key.
+  static Key MakeKey(Random* rnd, int id) {
+    return (static_cast<Key>(rnd->Next()) << 8) | id;
+  }
+};
+
+static void ConcurrentInserter(void* arg) {
+  ConcurrentInsertState* state = reinterpret_cast<ConcurrentInsertState*>(arg);
+  state->mu_.Lock();
+  const int id = state->next_id_++;
+  state->mu_.Unlock();
+
+  Random rnd(state->seed_ + id);
+  for (int i = 0; i < ConcurrentInsertState::kPerThread; i++) {
+    state->list_.InsertConcurrently(ConcurrentInsertState::MakeKey(&rnd, id));
+  }
+
+  MutexLock l(&state->mu_);
+  state->running_--;
+  state->cv_.SignalAll();
+}
+
+static void RunConcurrentInsert(int threads) {
+  const int seed = test::RandomSeed();
+  for (int run = 0; run < 5; run++) {
+    ConcurrentInsertState state(seed + run * 100, threads);
+    for (int id = 0; id < threads; id++) {
+      Random rnd(state.seed_ + id);
+      for (int i = 0; i < ConcurrentInsertState::kPerThread; i++) {
+        state.expected_.insert(ConcurrentInsertState::MakeKey(&rnd, id));
+      }
+    }
+    for (int i = 0; i < threads; i++) {
+      Env::Default()->StartThread(ConcurrentInserter, &state);
+    }
+    {
+      MutexLock l(&state.mu_);
+      while (state.running_ > 0) {
+        state.cv_.Wait();
+      }
+    }
+
+    SkipList<Key, Comparator>::Iterator iter(&state.list_);
+    iter.SeekToFirst();
+    for (std::set<Key>::iterator it = state.expected_.begin();
+         it != state.expected_.end(); ++it) {
+      ASSERT_TRUE(iter.Valid());
+      ASSERT_EQ(*it, iter.key());
+      ASSERT_TRUE(state.list_.Contains(*it));
+      iter.Next();
+    }
+    ASSERT_TRUE(!iter.Valid());
+
+    // Backward iteration exercises the upper levels of the list
+    iter.SeekToLast();
+    for (std::set<Key>::reverse_iterator it = state.expected_.rbegin();
+         it != state.expected_.rend(); ++it) {
+      ASSERT_TRUE(iter.Valid());
+      ASSERT_EQ(*it, iter.key());
+      iter.Prev();
+    }
+    ASSERT_TRUE(!iter.Valid());
+  }
+}
+
+TEST(SkipTest, ConcurrentInsert1) { RunConcurrentInsert(1); }
+TEST(SkipTest, ConcurrentInsert2) { RunConcurrentInsert(2); }
+TEST(SkipTest, ConcurrentInsert4) { RunConcurrentInsert(4); }
+TEST(SkipTest, ConcurrentInsert8) { RunConcurrentInsert(8); }
+
 }  // namespace leveldb
 
 int main(int argc, char** argv) {
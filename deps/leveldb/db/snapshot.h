@@ -16,6 +16,7 @@ class SnapshotList;
 class SnapshotImpl : public Snapshot {
  public:
   SequenceNumber number_;  // const after creation
+  uint64_t created_micros_;  // const after creation
 
  private:
   friend class SnapshotList;
@@ -29,7 +30,7 @@ class SnapshotImpl : public Snapshot {
 
 class SnapshotList {
  public:
-  SnapshotList() {
+  SnapshotList() : count_(0) {
     list_.prev_ = &list_;
     list_.next_ = &list_;
   }
@@ -38,14 +39,16 @@ class SnapshotList {
   SnapshotImpl* oldest() const { assert(!empty()); return list_.next_; }
   SnapshotImpl* newest() const { assert(!empty()); return list_.prev_; }
 
-  const SnapshotImpl* New(SequenceNumber seq) {
+  const SnapshotImpl* New(SequenceNumber seq, uint64_t now_micros) {
     SnapshotImpl* s = new SnapshotImpl;
     s->number_ = seq;
+    s->created_micros_ = now_micros;
     s->list_ = this;
     s->next_ = &list_;
     s->prev_ = list_.prev_;
     s->prev_->next_ = s;
     s->next_->prev_ = s;
+    count_++;
     return s;
   }
 
@@ -54,11 +57,15 @@ class SnapshotList {
     s->prev_->next_ = s->next_;
     s->next_->prev_ = s->prev_;
     delete s;
+    count_--;
   }
 
+  int count() const { return count_; }
+
  private:
   // Dummy head of doubly-linked list of snapshots
   SnapshotImpl list_;
+  int count_;
 };
 
 }  // namespace leveldb
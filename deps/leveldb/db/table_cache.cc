@@ -29,6 +29,56 @@ static void UnrefEntry(void* arg1, void* arg2) {
   cache->Release(h);
 }
 
+namespace {
+// Returns the keys of an ingested table with their sequence number
+// replaced.  Such a table holds each user key once, so the order of its
+// keys is unchanged.
+class GlobalSequenceIterator : public Iterator {
+ public:
+  GlobalSequenceIterator(const Comparator* icmp, Iterator* iter,
+                         SequenceNumber sequence)
+      : icmp_(icmp), iter_(iter), sequence_(sequence) { }
+  virtual ~GlobalSequenceIterator() { delete iter_; }
+
+  virtual bool Valid() const { return iter_->Valid(); }
+  virtual void SeekToFirst() { iter_->SeekToFirst(); Update(); }
+  virtual void SeekToLast() { iter_->SeekToLast(); Update(); }
+  virtual void Next() { iter_->Next(); Update(); }
+  virtual void Prev() { iter_->Prev(); Update(); }
+  virtual void Seek(const Slice& target) {
+    iter_->Seek(target);
+    Update();
+    // The entry for the target's user key sorts before the target if
+    // the target asks for an older sequence
+    if (Valid() && icmp_->Compare(key_, target) < 0) {
+      Next();
+    }
+  }
+  virtual Slice key() const { return key_; }
+  virtual Slice value() const { return iter_->value(); }
+  virtual Status status() const { return iter_->status(); }
+
+ private:
+  void Update() {
+    key_.clear();
+    if (iter_->Valid()) {
+      ParsedInternalKey ikey;
+      if (ParseInternalKey(iter_->key(), &ikey)) {
+        ikey.sequence = sequence_;
+        AppendInternalKey(&key_, ikey);
+      } else {
+        key_ = iter_->key().ToString();
+      }
+    }
+  }
+
+  const Comparator* const icmp_;
+  Iterator* const iter_;
+  const SequenceNumber sequence_;
+  std::string key_;
+};
+}  // namespace
+
 TableCache::TableCache(const std::string& dbname,
                        const Options* options,
                        int entries)
@@ -45,6 +95,7 @@ TableCache::~TableCache() {
 Iterator* TableCache::NewIterator(const ReadOptions& options,
                                   uint64_t file_number,
                                   uint64_t file_size,
+                                  SequenceNumber global_sequence,
                                   Table** tableptr) {
   if (tableptr != NULL) {
     *tableptr = NULL;
@@ -80,12 +131,29 @@ Iterator* TableCache::NewIterator(const ReadOptions& options,
   Table* table = reinterpret_cast<TableAndFile*>(cache_->Value(handle))->table;
   Iterator* result = table->NewIterator(options);
   result->RegisterCleanup(&UnrefEntry, cache_, handle);
+  if (global_sequence != 0) {
+    result = new GlobalSequenceIterator(options_->comparator, result,
+                                        global_sequence);
+  }
   if (tableptr != NULL) {
     *tableptr = table;
   }
   return result;
 }
 
+Status TableCache::Prefetch(const ReadOptions& options,
+                            uint64_t file_number,
+                            uint64_t file_size) {
+  Table* table = NULL;
+  Iterator* iter = NewIterator(options, file_number, file_size, 0, &table);
+  Status s = iter->status();
+  if (s.ok() && table != NULL) {
+    s = table->Prefetch(options);
+  }
+  delete iter;
+  return s;
+}
+
 void TableCache::Evict(uint64_t file_number) {
   char buf[sizeof(file_number)];
   EncodeFixed64(buf, file_number);
@@ -30,11 +30,21 @@ class TableCache {
   // the returned iterator.  The returned "*tableptr" object is owned by
   // the cache and should not be deleted, and is valid for as long as the
   // returned iterator is live.
+  //
+  // If "global_sequence" is non-zero, the iterator returns every key with
+  // that sequence number.  See FileMetaData::global_sequence.
   Iterator* NewIterator(const ReadOptions& options,
                         uint64_t file_number,
                         uint64_t file_size,
+                        SequenceNumber global_sequence,
                         Table** tableptr = NULL);
 
+  // Load the contents of the specified file ahead of use.  See
+  // Table::Prefetch().
+  Status Prefetch(const ReadOptions& options,
+                  uint64_t file_number,
+                  uint64_t file_size);
+
   // Evict any entry for the specified file number
   void Evict(uint64_t file_number);
 
@@ -0,0 +1,113 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "leveldb/table_file_writer.h"
+
+#include <assert.h>
+#include "db/dbformat.h"
+#include "leveldb/env.h"
+#include "leveldb/table_builder.h"
+
+namespace leveldb {
+
+// Entries are stored under internal keys with sequence number zero, so
+// that the file can be added to a database as it is.
+struct TableFileWriter::Rep {
+  InternalKeyComparator icmp;
+  Options options;
+  std::string fname;
+  WritableFile* file;
+  TableBuilder* builder;
+  std::string last_key;     // User key of the last entry added
+  std::string ikey;         // Scratch space for the internal key
+  uint64_t num_entries;
+  uint64_t file_size;
+
+  explicit Rep(const Options& opt)
+      : icmp(opt.comparator),
+        options(opt),
+        file(NULL),
+        builder(NULL),
+        num_entries(0),
+        file_size(0) {
+    options.comparator = &icmp;
+  }
+};
+
+TableFileWriter::TableFileWriter(const Options& options)
+    : rep_(new Rep(options)) {
+}
+
+TableFileWriter::~TableFileWriter() {
+  Rep* r = rep_;
+  if (r->builder != NULL) {
+    r->builder->Abandon();
+    delete r->builder;
+    delete r->file;
+    r->options.env->DeleteFile(r->fname);
+  }
+  delete r;
+}
+
+Status TableFileWriter::Open(const std::string& fname) {
+  Rep* r = rep_;
+  assert(r->builder == NULL);
+  r->options.env->DeleteFile(fname);  // Ignore error if it does not exist
+  Status s = r->options.env->NewWritableFile(fname, &r->file);
+  if (s.ok()) {
+    r->fname = fname;
+    r->builder = new TableBuilder(r->options, r->file);
+  }
+  return s;
+}
+
+Status TableFileWriter::Add(const Slice& key, const Slice& value) {
+  Rep* r = rep_;
+  assert(r->builder != NULL);
+  if (r->num_entries > 0 &&
+      r->icmp.user_comparator()->Compare(key, r->last_key) <= 0) {
+    return Status::InvalidArgument("keys must be added in ascending order",
+                                   key);
+  }
+  r->ikey.clear();
+  AppendInternalKey(&r->ikey, ParsedInternalKey(key, 0, kTypeValue));
+  r->builder->Add(r->ikey, value);
+  Status s = r->builder->status();
+  if (s.ok()) {
+    r->last_key.assign(key.data(), key.size());
+    r->num_entries++;
+  }
+  return s;
+}
+
+Status TableFileWriter::Finish() {
+  Rep* r = rep_;
+  assert(r->builder != NULL);
+  Status s = r->builder->Finish();
+  r->file_size = r->builder->FileSize();
+  delete r->builder;
+  r->builder = NULL;
+  if (s.ok()) {
+    s = r->file->Sync();
+  }
+  if (s.ok()) {
+    s = r->file->Close();
+  }
+  delete r->file;
+  r->file = NULL;
+  if (!s.ok()) {
+    r->options.env->DeleteFile(r->fname);
+  }
+  return s;
+}
+
+uint64_t TableFileWriter::NumEntries() const {
+  return rep_->num_entries;
+}
+
+uint64_t TableFileWriter::FileSize() const {
+  return rep_->builder != NULL ? rep_->builder->FileSize() : rep_->file_size;
+}
+
+}  // namespace leveldb
@@ -20,7 +20,10 @@ enum Tag {
   kDeletedFile          = 6,
   kNewFile              = 7,
   // 8 was used for large value refs
-  kPrevLogNumber        = 9
+  kPrevLogNumber        = 9,
+  kRangeTombstone       = 10,
+  kDeletedRangeTombstone = 11,
+  kIngestedFile         = 12
 };
 
 void VersionEdit::Clear() {
@@ -36,6 +39,8 @@ void VersionEdit::Clear() {
   has_last_sequence_ = false;
   deleted_files_.clear();
   new_files_.clear();
+  deleted_tombstones_.clear();
+  new_tombstones_.clear();
 }
 
 void VersionEdit::EncodeTo(std::string* dst) const {
@@ -76,12 +81,33 @@ void VersionEdit::EncodeTo(std::string* dst) const {
 
   for (size_t i = 0; i < new_files_.size(); i++) {
     const FileMetaData& f = new_files_[i].second;
-    PutVarint32(dst, kNewFile);
+    PutVarint32(dst, f.global_sequence != 0 ? kIngestedFile : kNewFile);
     PutVarint32(dst, new_files_[i].first);  // level
     PutVarint64(dst, f.number);
     PutVarint64(dst, f.file_size);
     PutLengthPrefixedSlice(dst, f.smallest.Encode());
     PutLengthPrefixedSlice(dst, f.largest.Encode());
+    if (f.global_sequence != 0) {
+      PutVarint64(dst, f.global_sequence);
+    }
+  }
+
+  for (std::set<SequenceNumber>::const_iterator iter =
+           deleted_tombstones_.begin();
+       iter != deleted_tombstones_.end();
+       ++iter) {
+    PutVarint32(dst, kDeletedRangeTombstone);
+    PutVarint64(dst, *iter);
+  }
+
+  for (size_t i = 0; i < new_tombstones_.size(); i++) {
+    const RangeTombstone& t = new_tombstones_[i];
+    PutVarint32(dst, kRangeTombstone);
+    PutVarint64(dst, t.sequence);
+    PutLengthPrefixedSlice(dst, t.start);
+    PutLengthPrefixedSlice(dst, t.end);
+    PutVarint64(dst, t.older_files);
+    PutVarint64(dst, t.hidden_files);
   }
 }
 
@@ -116,7 +142,9 @@ Status VersionEdit::DecodeFrom(const Slice& src) {
   int level;
   uint64_t number;
   FileMetaData f;
+  RangeTombstone t;
   Slice str;
+  Slice str2;
   InternalKey key;
 
   while (msg == NULL && GetVarint32(&input, &tag)) {
@@ -192,6 +220,42 @@ Status VersionEdit::DecodeFrom(const Slice& src) {
         }
         break;
 
+      case kIngestedFile:
+        if (GetLevel(&input, &level) &&
+            GetVarint64(&input, &f.number) &&
+            GetVarint64(&input, &f.file_size) &&
+            GetInternalKey(&input, &f.smallest) &&
+            GetInternalKey(&input, &f.largest) &&
+            GetVarint64(&input, &f.global_sequence)) {
+          new_files_.push_back(std::make_pair(level, f));
+          f.global_sequence = 0;
+        } else {
+          msg = "ingested-file entry";
+        }
+        break;
+
+      case kRangeTombstone:
+        if (GetVarint64(&input, &t.sequence) &&
+            GetLengthPrefixedSlice(&input, &str) &&
+            GetLengthPrefixedSlice(&input, &str2) &&
+            GetVarint64(&input, &t.older_files) &&
+            GetVarint64(&input, &t.hidden_files)) {
+          t.start = str.ToString();
+          t.end = str2.ToString();
+          new_tombstones_.push_back(t);
+        } else {
+          msg = "range tombstone";
+        }
+        break;
+
+      case kDeletedRangeTombstone:
+        if (GetVarint64(&input, &number)) {
+          deleted_tombstones_.insert(number);
+        } else {
+          msg = "deleted range tombstone";
+        }
+        break;
+
       default:
         msg = "unknown tag";
         break;
@@ -258,6 +322,30 @@ std::string VersionEdit::DebugString() const {
     r.append(f.smallest.DebugString());
     r.append(" .. ");
     r.append(f.largest.DebugString());
+    if (f.global_sequence != 0) {
+      r.append(" @ ");
+      AppendNumberTo(&r, f.global_sequence);
+    }
+  }
+  for (std::set<SequenceNumber>::const_iterator iter =
+           deleted_tombstones_.begin();
+       iter != deleted_tombstones_.end();
+       ++iter) {
+    r.append("\n  DeleteRangeTombstone: ");
+    AppendNumberTo(&r, *iter);
+  }
+  for (size_t i = 0; i < new_tombstones_.size(); i++) {
+    const RangeTombstone& t = new_tombstones_[i];
+    r.append("\n  AddRangeTombstone: ");
+    AppendNumberTo(&r, t.sequence);
+    r.append(" '");
+    AppendEscapedStringTo(&r, t.start);
+    r.append("' .. '");
+    AppendEscapedStringTo(&r, t.end);
+    r.append("' ");
+    AppendNumberTo(&r, t.older_files);
+    r.append(" ");
+    AppendNumberTo(&r, t.hidden_files);
   }
   r.append("\n}\n");
   return r;
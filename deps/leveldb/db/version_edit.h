@@ -22,7 +22,33 @@ struct FileMetaData {
   InternalKey smallest;       // Smallest internal key served by table
   InternalKey largest;        // Largest internal key served by table
 
-  FileMetaData() : refs(0), allowed_seeks(1 << 30), file_size(0) { }
+  // If non-zero, every entry in the file is read with this sequence
+  // number instead of the one it was written with.  Set for ingested
+  // files, whose entries are written with sequence zero.
+  SequenceNumber global_sequence;
+
+  FileMetaData()
+      : refs(0), allowed_seeks(1 << 30), file_size(0), global_sequence(0) { }
+};
+
+// A deletion of every key in the user key range [start,end) that is
+// older than "sequence".  Range tombstones live in the descriptor once
+// the memtable holding them has been compacted.
+struct RangeTombstone {
+  SequenceNumber sequence;
+  std::string start;          // Inclusive
+  std::string end;            // Exclusive
+
+  // Table files numbered below older_files only hold entries older than
+  // the tombstone, so they can be dropped once the range covers them.
+  uint64_t older_files;
+
+  // Table files numbered below hidden_files may hold entries hidden by
+  // the tombstone.  Once none of them overlap the range, the tombstone
+  // has no effect and can be forgotten.
+  uint64_t hidden_files;
+
+  RangeTombstone() : sequence(0), older_files(0), hidden_files(0) { }
 };
 
 class VersionEdit {
@@ -62,12 +88,14 @@ class VersionEdit {
   void AddFile(int level, uint64_t file,
                uint64_t file_size,
                const InternalKey& smallest,
-               const InternalKey& largest) {
+               const InternalKey& largest,
+               SequenceNumber global_sequence = 0) {
     FileMetaData f;
     f.number = file;
     f.file_size = file_size;
     f.smallest = smallest;
     f.largest = largest;
+    f.global_sequence = global_sequence;
     new_files_.push_back(std::make_pair(level, f));
   }
 
@@ -76,6 +104,25 @@ class VersionEdit {
     deleted_files_.insert(std::make_pair(level, file));
   }
 
+  // Add the specified range tombstone, replacing any existing tombstone
+  // with the same sequence number.
+  void AddRangeTombstone(const RangeTombstone& t) {
+    new_tombstones_.push_back(t);
+  }
+
+  // Forget the range tombstone written at "sequence".
+  void DeleteRangeTombstone(SequenceNumber sequence) {
+    deleted_tombstones_.insert(sequence);
+  }
+
+  // Range tombstones added and forgotten by this edit
+  const std::vector<RangeTombstone>& new_range_tombstones() const {
+    return new_tombstones_;
+  }
+  const std::set<SequenceNumber>& deleted_range_tombstones() const {
+    return deleted_tombstones_;
+  }
+
   void EncodeTo(std::string* dst) const;
   Status DecodeFrom(const Slice& src);
 
@@ -100,6 +147,8 @@ class VersionEdit {
   std::vector< std::pair<int, InternalKey> > compact_pointers_;
   DeletedFileSet deleted_files_;
   std::vector< std::pair<int, FileMetaData> > new_files_;
+  std::set<SequenceNumber> deleted_tombstones_;
+  std::vector<RangeTombstone> new_tombstones_;
 };
 
 }  // namespace leveldb
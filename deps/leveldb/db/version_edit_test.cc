@@ -28,8 +28,20 @@ TEST(VersionEditTest, EncodeDecode) {
     edit.AddFile(3, kBig + 300 + i, kBig + 400 + i,
                  InternalKey("foo", kBig + 500 + i, kTypeValue),
                  InternalKey("zoo", kBig + 600 + i, kTypeDeletion));
+    edit.AddFile(6, kBig + 310 + i, kBig + 410 + i,
+                 InternalKey("foo", kBig + 510 + i, kTypeValue),
+                 InternalKey("zoo", kBig + 510 + i, kTypeValue),
+                 kBig + 510 + i);
     edit.DeleteFile(4, kBig + 700 + i);
     edit.SetCompactPointer(i, InternalKey("x", kBig + 900 + i, kTypeValue));
+    RangeTombstone t;
+    t.sequence = kBig + 800 + i;
+    t.start = "bar";
+    t.end = "baz";
+    t.older_files = kBig + 300 + i;
+    t.hidden_files = kBig + 301 + i;
+    edit.AddRangeTombstone(t);
+    edit.DeleteRangeTombstone(kBig + 850 + i);
   }
 
   edit.SetComparatorName("foo");
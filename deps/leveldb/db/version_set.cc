@@ -163,8 +163,8 @@ bool SomeFileOverlapsRange(
 // An internal iterator.  For a given version/level pair, yields
 // information about the files in the level.  For a given entry, key()
 // is the largest key that occurs in the file, and value() is an
-// 16-byte value containing the file number and file size, both
-// encoded using EncodeFixed64.
+// 24-byte value containing the file number, file size and global
+// sequence number, all encoded using EncodeFixed64.
 class Version::LevelFileNumIterator : public Iterator {
  public:
   LevelFileNumIterator(const InternalKeyComparator& icmp,
@@ -203,6 +203,7 @@ class Version::LevelFileNumIterator : public Iterator {
     assert(Valid());
     EncodeFixed64(value_buf_, (*flist_)[index_]->number);
     EncodeFixed64(value_buf_+8, (*flist_)[index_]->file_size);
+    EncodeFixed64(value_buf_+16, (*flist_)[index_]->global_sequence);
     return Slice(value_buf_, sizeof(value_buf_));
   }
   virtual Status status() const { return Status::OK(); }
@@ -211,21 +212,23 @@ class Version::LevelFileNumIterator : public Iterator {
   const std::vector<FileMetaData*>* const flist_;
   uint32_t index_;
 
-  // Backing store for value().  Holds the file number and size.
-  mutable char value_buf_[16];
+  // Backing store for value().  Holds the file number, size and global
+  // sequence number.
+  mutable char value_buf_[24];
 };
 
 static Iterator* GetFileIterator(void* arg,
                                  const ReadOptions& options,
                                  const Slice& file_value) {
   TableCache* cache = reinterpret_cast<TableCache*>(arg);
-  if (file_value.size() != 16) {
+  if (file_value.size() != 24) {
     return NewErrorIterator(
         Status::Corruption("FileReader invoked with unexpected value"));
   } else {
     return cache->NewIterator(options,
                               DecodeFixed64(file_value.data()),
-                              DecodeFixed64(file_value.data() + 8));
+                              DecodeFixed64(file_value.data() + 8),
+                              DecodeFixed64(file_value.data() + 16));
   }
 }
 
@@ -242,7 +245,8 @@ void Version::AddIterators(const ReadOptions& options,
   for (size_t i = 0; i < files_[0].size(); i++) {
     iters->push_back(
         vset_->table_cache_->NewIterator(
-            options, files_[0][i]->number, files_[0][i]->file_size));
+            options, files_[0][i]->number, files_[0][i]->file_size,
+            files_[0][i]->global_sequence));
   }
 
   // For levels > 0, we can use a concatenating iterator that sequentially
@@ -256,34 +260,45 @@ void Version::AddIterators(const ReadOptions& options,
 }
 
 // If "*iter" points at a value or deletion for user_key, store
-// either the value, or a NotFound error and return true.
+// either the value, or a NotFound error and return true.  Merge
+// operands for user_key on the way are added to *operands.
 // Else return false.
 static bool GetValue(const Comparator* cmp,
                      Iterator* iter, const Slice& user_key,
                      std::string* value,
-                     Status* s) {
-  if (!iter->Valid()) {
-    return false;
-  }
-  ParsedInternalKey parsed_key;
-  if (!ParseInternalKey(iter->key(), &parsed_key)) {
-    *s = Status::Corruption("corrupted key for ", user_key);
-    return true;
-  }
-  if (cmp->Compare(parsed_key.user_key, user_key) != 0) {
-    return false;
-  }
-  switch (parsed_key.type) {
-    case kTypeDeletion:
-      *s = Status::NotFound(Slice());  // Use an empty error message for speed
-      break;
-    case kTypeValue: {
-      Slice v = iter->value();
-      value->assign(v.data(), v.size());
-      break;
+                     Status* s,
+                     SequenceNumber* seq,
+                     MergeOperandList* operands) {
+  for (; iter->Valid(); iter->Next()) {
+    ParsedInternalKey parsed_key;
+    if (!ParseInternalKey(iter->key(), &parsed_key)) {
+      *s = Status::Corruption("corrupted key for ", user_key);
+      return true;
+    }
+    if (cmp->Compare(parsed_key.user_key, user_key) != 0) {
+      return false;
+    }
+    switch (parsed_key.type) {
+      case kTypeDeletion:
+        *s = Status::NotFound(Slice());  // Use an empty error message for speed
+        *seq = parsed_key.sequence;
+        return true;
+      case kTypeValue: {
+        Slice v = iter->value();
+        value->assign(v.data(), v.size());
+        *seq = parsed_key.sequence;
+        return true;
+      }
+      case kTypeMerge:
+        operands->Add(iter->value(), parsed_key.sequence);
+        break;
+      case kTypeRangeDeletion:
+        // Range tombstones are kept in the version, never in tables
+        *s = Status::Corruption("range tombstone in table for ", user_key);
+        return true;
     }
   }
-  return true;
+  return false;
 }
 
 static bool NewestFirst(FileMetaData* a, FileMetaData* b) {
@@ -293,7 +308,9 @@ static bool NewestFirst(FileMetaData* a, FileMetaData* b) {
 Status Version::Get(const ReadOptions& options,
                     const LookupKey& k,
                     std::string* value,
-                    GetStats* stats) {
+                    GetStats* stats,
+                    SequenceNumber* seq,
+                    MergeOperandList* operands) {
   Slice ikey = k.internal_key();
   Slice user_key = k.user_key();
   const Comparator* ucmp = vset_->icmp_.user_comparator();
@@ -364,9 +381,11 @@ Status Version::Get(const ReadOptions& options,
       Iterator* iter = vset_->table_cache_->NewIterator(
           options,
           f->number,
-          f->file_size);
+          f->file_size,
+          f->global_sequence);
       iter->Seek(ikey);
-      const bool done = GetValue(ucmp, iter, user_key, value, &s);
+      const bool done = GetValue(ucmp, iter, user_key, value, &s, seq,
+                                 operands);
       if (!iter->status().ok()) {
         s = iter->status();
         delete iter;
@@ -383,6 +402,23 @@ Status Version::Get(const ReadOptions& options,
   return Status::NotFound(Slice());  // Use an empty error message for speed
 }
 
+SequenceNumber Version::MaxCoveringTombstone(const Slice& user_key,
+                                             SequenceNumber snapshot) const {
+  // Tombstones are garbage collected once they stop hiding anything, so
+  // the list is expected to be short.
+  const Comparator* ucmp = vset_->icmp_.user_comparator();
+  SequenceNumber result = 0;
+  for (size_t i = 0; i < tombstones_.size(); i++) {
+    const RangeTombstone& t = tombstones_[i];
+    if (t.sequence <= snapshot && t.sequence > result &&
+        ucmp->Compare(t.start, user_key) <= 0 &&
+        ucmp->Compare(user_key, t.end) < 0) {
+      result = t.sequence;
+    }
+  }
+  return result;
+}
+
 bool Version::UpdateStats(const GetStats& stats) {
   FileMetaData* f = stats.seek_file;
   if (f != NULL) {
@@ -506,6 +542,26 @@ std::string Version::DebugString() const {
       r.append("]\n");
     }
   }
+  if (!tombstones_.empty()) {
+    // E.g.,
+    //   --- range tombstones ---
+    //   @ 35 ['a' .. 'd') 17 21
+    r.append("--- range tombstones ---\n");
+    for (size_t i = 0; i < tombstones_.size(); i++) {
+      const RangeTombstone& t = tombstones_[i];
+      r.append(" @ ");
+      AppendNumberTo(&r, t.sequence);
+      r.append(" ['");
+      AppendEscapedStringTo(&r, t.start);
+      r.append("' .. '");
+      AppendEscapedStringTo(&r, t.end);
+      r.append("') ");
+      AppendNumberTo(&r, t.older_files);
+      r.push_back(' ');
+      AppendNumberTo(&r, t.hidden_files);
+      r.push_back('\n');
+    }
+  }
   return r;
 }
 
@@ -538,6 +594,7 @@ class VersionSet::Builder {
   VersionSet* vset_;
   Version* base_;
   LevelState levels_[config::kNumLevels];
+  std::map<SequenceNumber, RangeTombstone> tombstones_;
 
  public:
   // Initialize a builder with the files from *base and other info from *vset
@@ -550,6 +607,10 @@ class VersionSet::Builder {
     for (int level = 0; level < config::kNumLevels; level++) {
       levels_[level].added_files = new FileSet(cmp);
     }
+    for (size_t i = 0; i < base_->tombstones_.size(); i++) {
+      const RangeTombstone& t = base_->tombstones_[i];
+      tombstones_[t.sequence] = t;
+    }
   }
 
   ~Builder() {
@@ -617,10 +678,29 @@ class VersionSet::Builder {
       levels_[level].deleted_files.erase(f->number);
       levels_[level].added_files->insert(f);
     }
+
+    // Update range tombstones
+    for (std::set<SequenceNumber>::const_iterator iter =
+             edit->deleted_tombstones_.begin();
+         iter != edit->deleted_tombstones_.end();
+         ++iter) {
+      tombstones_.erase(*iter);
+    }
+    for (size_t i = 0; i < edit->new_tombstones_.size(); i++) {
+      const RangeTombstone& t = edit->new_tombstones_[i];
+      tombstones_[t.sequence] = t;
+    }
   }
 
   // Save the current state in *v.
   void SaveTo(Version* v) {
+    for (std::map<SequenceNumber, RangeTombstone>::const_iterator iter =
+             tombstones_.begin();
+         iter != tombstones_.end();
+         ++iter) {
+      v->tombstones_.push_back(iter->second);
+    }
+
     BySmallestKey cmp;
     cmp.internal_comparator = &vset_->icmp_;
     for (int level = 0; level < config::kNumLevels; level++) {
@@ -698,6 +778,7 @@ VersionSet::VersionSet(const std::string& dbname,
       last_sequence_(0),
       log_number_(0),
       prev_log_number_(0),
+      read_records_(0),
       descriptor_file_(NULL),
       descriptor_log_(NULL),
       dummy_versions_(this),
@@ -742,7 +823,11 @@ Status VersionSet::LogAndApply(VersionEdit* edit, port::Mutex* mu) {
   }
 
   edit->SetNextFile(next_file_number_);
-  edit->SetLastSequence(last_sequence_);
+  if (!edit->has_last_sequence_ || edit->last_sequence_ < last_sequence_) {
+    // An edit may record a sequence number that is not yet in use; see
+    // DBImpl::InstallIngestedFiles()
+    edit->SetLastSequence(last_sequence_);
+  }
 
   Version* v = new Version(this);
   {
@@ -811,7 +896,7 @@ Status VersionSet::LogAndApply(VersionEdit* edit, port::Mutex* mu) {
   return s;
 }
 
-Status VersionSet::Recover() {
+Status VersionSet::ReadDescriptor(bool catch_up) {
   struct LogReporter : public log::Reader::Reporter {
     Status* status;
     virtual void Corruption(size_t bytes, const Status& s) {
@@ -837,23 +922,35 @@ Status VersionSet::Recover() {
     return s;
   }
 
-  bool have_log_number = false;
-  bool have_prev_log_number = false;
-  bool have_next_file = false;
-  bool have_last_sequence = false;
-  uint64_t next_file = 0;
-  uint64_t last_sequence = 0;
-  uint64_t log_number = 0;
-  uint64_t prev_log_number = 0;
-  Builder builder(this, current_);
+  // Only the records added since the descriptor was last read are
+  // applied to the current version
+  const bool resume = catch_up && dscname == read_descriptor_;
+  const uint64_t skip = resume ? read_records_ : 0;
+  uint64_t records = 0;
+
+  bool have_log_number = resume;
+  bool have_prev_log_number = resume;
+  bool have_next_file = resume;
+  bool have_last_sequence = resume;
+  uint64_t next_file = resume ? manifest_file_number_ : 0;
+  uint64_t last_sequence = resume ? last_sequence_ : 0;
+  uint64_t log_number = resume ? log_number_ : 0;
+  uint64_t prev_log_number = resume ? prev_log_number_ : 0;
+  Builder builder(this, resume ? current_ : new Version(this));
 
   {
+    // Errors reading a catch-up's records are taken as the end of what
+    // has been written so far
+    Status tail;
     LogReporter reporter;
-    reporter.status = &s;
+    reporter.status = catch_up ? &tail : &s;
     log::Reader reader(file, &reporter, true/*checksum*/, 0/*initial_offset*/);
     Slice record;
     std::string scratch;
-    while (reader.ReadRecord(&record, &scratch) && s.ok()) {
+    while (reader.ReadRecord(&record, &scratch) && s.ok() && tail.ok()) {
+      if (records++ < skip) {
+        continue;
+      }
       VersionEdit edit;
       s = edit.DecodeFrom(record);
       if (s.ok()) {
@@ -910,7 +1007,7 @@ Status VersionSet::Recover() {
     MarkFileNumberUsed(log_number);
   }
 
-  if (s.ok()) {
+  if (s.ok() && records > skip) {
     Version* v = new Version(this);
     builder.SaveTo(v);
     // Install recovered version
@@ -918,10 +1015,18 @@ Status VersionSet::Recover() {
     AppendVersion(v);
     manifest_file_number_ = next_file;
     next_file_number_ = next_file + 1;
-    last_sequence_ = last_sequence;
+    // A catch-up may already have replayed later writes from the logs,
+    // so the sequence number only moves forward
+    if (!catch_up || last_sequence_ < last_sequence) {
+      last_sequence_ = last_sequence;
+    }
     log_number_ = log_number;
     prev_log_number_ = prev_log_number;
   }
+  if (s.ok()) {
+    read_descriptor_ = dscname;
+    read_records_ = records;
+  }
 
   return s;
 }
@@ -969,19 +1074,16 @@ void VersionSet::Finalize(Version* v) {
   v->compaction_score_ = best_score;
 }
 
-Status VersionSet::WriteSnapshot(log::Writer* log) {
-  // TODO: Break up into multiple records to reduce memory usage on recovery?
-
+void VersionSet::SaveCurrent(VersionEdit* edit) {
   // Save metadata
-  VersionEdit edit;
-  edit.SetComparatorName(icmp_.user_comparator()->Name());
+  edit->SetComparatorName(icmp_.user_comparator()->Name());
 
   // Save compaction pointers
   for (int level = 0; level < config::kNumLevels; level++) {
     if (!compact_pointer_[level].empty()) {
       InternalKey key;
       key.DecodeFrom(compact_pointer_[level]);
-      edit.SetCompactPointer(level, key);
+      edit->SetCompactPointer(level, key);
     }
   }
 
@@ -990,15 +1092,45 @@ Status VersionSet::WriteSnapshot(log::Writer* log) {
     const std::vector<FileMetaData*>& files = current_->files_[level];
     for (size_t i = 0; i < files.size(); i++) {
       const FileMetaData* f = files[i];
-      edit.AddFile(level, f->number, f->file_size, f->smallest, f->largest);
+      edit->AddFile(level, f->number, f->file_size, f->smallest, f->largest,
+                    f->global_sequence);
     }
   }
 
+  // Save range tombstones
+  for (size_t i = 0; i < current_->tombstones_.size(); i++) {
+    edit->AddRangeTombstone(current_->tombstones_[i]);
+  }
+}
+
+Status VersionSet::WriteSnapshot(log::Writer* log) {
+  // TODO: Break up into multiple records to reduce memory usage on recovery?
+  VersionEdit edit;
+  SaveCurrent(&edit);
+
   std::string record;
   edit.EncodeTo(&record);
   return log->AddRecord(record);
 }
 
+void VersionSet::EncodeCheckpoint(std::string* record,
+                                  std::vector<uint64_t>* files) {
+  VersionEdit edit;
+  SaveCurrent(&edit);
+  edit.SetLogNumber(log_number_);
+  edit.SetPrevLogNumber(0);
+  edit.SetNextFile(next_file_number_);
+  edit.SetLastSequence(last_sequence_);
+  edit.EncodeTo(record);
+
+  for (int level = 0; level < config::kNumLevels; level++) {
+    const std::vector<FileMetaData*>& level_files = current_->files_[level];
+    for (size_t i = 0; i < level_files.size(); i++) {
+      files->push_back(level_files[i]->number);
+    }
+  }
+}
+
 int VersionSet::NumLevelFiles(int level) const {
   assert(level >= 0);
   assert(level < config::kNumLevels);
@@ -1041,7 +1173,8 @@ uint64_t VersionSet::ApproximateOffsetOf(Version* v, const InternalKey& ikey) {
         // approximate offset of "ikey" within the table.
         Table* tableptr;
         Iterator* iter = table_cache_->NewIterator(
-            ReadOptions(), files[i]->number, files[i]->file_size, &tableptr);
+            ReadOptions(), files[i]->number, files[i]->file_size,
+            files[i]->global_sequence, &tableptr);
         if (tableptr != NULL) {
           result += tableptr->ApproximateOffsetOf(ikey.Encode());
         }
@@ -1142,7 +1275,8 @@ Iterator* VersionSet::MakeInputIterator(Compaction* c) {
         const std::vector<FileMetaData*>& files = c->inputs_[which];
         for (size_t i = 0; i < files.size(); i++) {
           list[num++] = table_cache_->NewIterator(
-              options, files[i]->number, files[i]->file_size);
+              options, files[i]->number, files[i]->file_size,
+              files[i]->global_sequence);
         }
       } else {
         // Create concatenating iterator for the files from this level
@@ -1394,4 +1528,15 @@ void Compaction::ReleaseInputs() {
   }
 }
 
+Compaction* Compaction::NewSubcompaction() const {
+  assert(input_version_ != NULL);
+  Compaction* c = new Compaction(level_);
+  c->input_version_ = input_version_;
+  c->input_version_->Ref();
+  c->inputs_[0] = inputs_[0];
+  c->inputs_[1] = inputs_[1];
+  c->grandparents_ = grandparents_;
+  return c;
+}
+
 }  // namespace leveldb
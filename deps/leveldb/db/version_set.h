@@ -63,14 +63,17 @@ class Version {
   void AddIterators(const ReadOptions&, std::vector<Iterator*>* iters);
 
   // Lookup the value for key.  If found, store it in *val and
-  // return OK.  Else return a non-OK status.  Fills *stats.
+  // return OK.  Else return a non-OK status.  Fills *stats, and stores
+  // the sequence number of the entry that was found in *seq.  Merge
+  // operands newer than that entry are added to *operands.
   // REQUIRES: lock is not held
   struct GetStats {
     FileMetaData* seek_file;
     int seek_file_level;
   };
   Status Get(const ReadOptions&, const LookupKey& key, std::string* val,
-             GetStats* stats);
+             GetStats* stats, SequenceNumber* seq,
+             MergeOperandList* operands);
 
   // Adds "stats" into the current state.  Returns true if a new
   // compaction may need to be triggered, false otherwise.
@@ -103,6 +106,20 @@ class Version {
 
   int NumFiles(int level) const { return files_[level].size(); }
 
+  // Return the ith file of the specified level.
+  FileMetaData* file(int level, int i) const { return files_[level][i]; }
+
+  // Range tombstones that have been compacted out of the memtable,
+  // ordered by sequence number.
+  const std::vector<RangeTombstone>& range_tombstones() const {
+    return tombstones_;
+  }
+
+  // Return the sequence number of the newest range tombstone that is
+  // visible at "snapshot" and covers "user_key", or zero if none does.
+  SequenceNumber MaxCoveringTombstone(const Slice& user_key,
+                                      SequenceNumber snapshot) const;
+
   // Return a human readable string that describes this version's contents.
   std::string DebugString() const;
 
@@ -121,6 +138,9 @@ class Version {
   // List of files per level
   std::vector<FileMetaData*> files_[config::kNumLevels];
 
+  // Range tombstones, ordered by sequence number
+  std::vector<RangeTombstone> tombstones_;
+
   // Next file to compact based on seek stats.
   FileMetaData* file_to_compact_;
   int file_to_compact_level_;
@@ -162,7 +182,13 @@ class VersionSet {
   Status LogAndApply(VersionEdit* edit, port::Mutex* mu);
 
   // Recover the last saved descriptor from persistent storage.
-  Status Recover();
+  Status Recover() { return ReadDescriptor(false); }
+
+  // Apply the records another process has added to the descriptor since
+  // the last Recover() or CatchUp(), or read all of it if CURRENT names
+  // a new one.  A record that cannot be read yet ends the catch-up
+  // instead of failing it, since the writer may still be appending it.
+  Status CatchUp() { return ReadDescriptor(true); }
 
   // Return the current version.
   Version* current() const { return current_; }
@@ -227,6 +253,12 @@ class VersionSet {
     return (v->compaction_score_ >= 1) || (v->file_to_compact_ != NULL);
   }
 
+  // Encode into *record a descriptor that recreates the current version
+  // as a database of its own, with the current file and sequence
+  // numbers, and append the numbers of its table files to *files.  Used
+  // to write the descriptor of a checkpoint.
+  void EncodeCheckpoint(std::string* record, std::vector<uint64_t>* files);
+
   // Add all files listed in any live version to *live.
   // May also mutate some internal state.
   void AddLiveFiles(std::set<uint64_t>* live);
@@ -261,9 +293,15 @@ class VersionSet {
 
   void SetupOtherInputs(Compaction* c);
 
+  Status ReadDescriptor(bool catch_up);
+
   // Save current contents to *log
   Status WriteSnapshot(log::Writer* log);
 
+  // Add the comparator, compaction pointers, files and range tombstones
+  // of the current version to *edit
+  void SaveCurrent(VersionEdit* edit);
+
   void AppendVersion(Version* v);
 
   Env* const env_;
@@ -277,6 +315,10 @@ class VersionSet {
   uint64_t log_number_;
   uint64_t prev_log_number_;  // 0 or backing store for memtable being compacted
 
+  // The descriptor last read by ReadDescriptor(), and its number of records
+  std::string read_descriptor_;
+  uint64_t read_records_;
+
   // Opened lazily
   WritableFile* descriptor_file_;
   log::Writer* descriptor_log_;
@@ -334,6 +376,13 @@ class Compaction {
   // is successful.
   void ReleaseInputs();
 
+  // Return a compaction over the same inputs that keeps its own state
+  // for IsBaseLevelForKey() and ShouldStopBefore(), so that disjoint
+  // key ranges of this compaction can be processed by different threads.
+  // The caller should delete the result when no longer needed.
+  // REQUIRES: the DB mutex is held, both here and when deleting the result
+  Compaction* NewSubcompaction() const;
+
  private:
   friend class Version;
   friend class VersionSet;
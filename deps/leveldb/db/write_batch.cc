@@ -8,7 +8,9 @@
 //    data: record[count]
 // record :=
 //    kTypeValue varstring varstring         |
-//    kTypeDeletion varstring
+//    kTypeDeletion varstring                |
+//    kTypeRangeDeletion varstring varstring |
+//    kTypeMerge varstring varstring
 // varstring :=
 //    len: varint32
 //    data: uint8[len]
@@ -31,6 +33,12 @@ WriteBatch::~WriteBatch() { }
 
 WriteBatch::Handler::~Handler() { }
 
+void WriteBatch::Handler::DeleteRange(const Slice& start, const Slice& limit) {
+}
+
+void WriteBatch::Handler::Merge(const Slice& key, const Slice& value) {
+}
+
 void WriteBatch::Clear() {
   rep_.clear();
   rep_.resize(12);
@@ -65,6 +73,22 @@ Status WriteBatch::Iterate(Handler* handler) const {
           return Status::Corruption("bad WriteBatch Delete");
         }
         break;
+      case kTypeRangeDeletion:
+        if (GetLengthPrefixedSlice(&input, &key) &&
+            GetLengthPrefixedSlice(&input, &value)) {
+          handler->DeleteRange(key, value);
+        } else {
+          return Status::Corruption("bad WriteBatch DeleteRange");
+        }
+        break;
+      case kTypeMerge:
+        if (GetLengthPrefixedSlice(&input, &key) &&
+            GetLengthPrefixedSlice(&input, &value)) {
+          handler->Merge(key, value);
+        } else {
+          return Status::Corruption("bad WriteBatch Merge");
+        }
+        break;
       default:
         return Status::Corruption("unknown WriteBatch tag");
     }
@@ -105,19 +129,46 @@ void WriteBatch::Delete(const Slice& key) {
   PutLengthPrefixedSlice(&rep_, key);
 }
 
+void WriteBatch::DeleteRange(const Slice& start, const Slice& limit) {
+  WriteBatchInternal::SetCount(this, WriteBatchInternal::Count(this) + 1);
+  rep_.push_back(static_cast<char>(kTypeRangeDeletion));
+  PutLengthPrefixedSlice(&rep_, start);
+  PutLengthPrefixedSlice(&rep_, limit);
+}
+
+void WriteBatch::Merge(const Slice& key, const Slice& value) {
+  WriteBatchInternal::SetCount(this, WriteBatchInternal::Count(this) + 1);
+  rep_.push_back(static_cast<char>(kTypeMerge));
+  PutLengthPrefixedSlice(&rep_, key);
+  PutLengthPrefixedSlice(&rep_, value);
+}
+
 namespace {
 class MemTableInserter : public WriteBatch::Handler {
  public:
   SequenceNumber sequence_;
   MemTable* mem_;
+  bool concurrent_;
 
-  virtual void Put(const Slice& key, const Slice& value) {
-    mem_->Add(sequence_, kTypeValue, key, value);
+  void Add(ValueType type, const Slice& key, const Slice& value) {
+    if (concurrent_) {
+      mem_->AddConcurrently(sequence_, type, key, value);
+    } else {
+      mem_->Add(sequence_, type, key, value);
+    }
     sequence_++;
   }
+  virtual void Put(const Slice& key, const Slice& value) {
+    Add(kTypeValue, key, value);
+  }
   virtual void Delete(const Slice& key) {
-    mem_->Add(sequence_, kTypeDeletion, key, Slice());
-    sequence_++;
+    Add(kTypeDeletion, key, Slice());
+  }
+  virtual void DeleteRange(const Slice& start, const Slice& limit) {
+    Add(kTypeRangeDeletion, start, limit);
+  }
+  virtual void Merge(const Slice& key, const Slice& value) {
+    Add(kTypeMerge, key, value);
   }
 };
 }  // namespace
@@ -127,6 +178,16 @@ Status WriteBatchInternal::InsertInto(const WriteBatch* b,
   MemTableInserter inserter;
   inserter.sequence_ = WriteBatchInternal::Sequence(b);
   inserter.mem_ = memtable;
+  inserter.concurrent_ = false;
+  return b->Iterate(&inserter);
+}
+
+Status WriteBatchInternal::InsertIntoConcurrently(const WriteBatch* b,
+                                                  MemTable* memtable) {
+  MemTableInserter inserter;
+  inserter.sequence_ = WriteBatchInternal::Sequence(b);
+  inserter.mem_ = memtable;
+  inserter.concurrent_ = true;
   return b->Iterate(&inserter);
 }
 
@@ -39,6 +39,11 @@ class WriteBatchInternal {
   static void SetContents(WriteBatch* batch, const Slice& contents);
 
   static Status InsertInto(const WriteBatch* batch, MemTable* memtable);
+
+  // Like InsertInto(), but other threads may be inserting into memtable
+  // at the same time.
+  static Status InsertIntoConcurrently(const WriteBatch* batch,
+                                       MemTable* memtable);
 };
 
 }  // namespace leveldb
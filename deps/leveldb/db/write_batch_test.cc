@@ -35,11 +35,33 @@ static std::string PrintContents(WriteBatch* b) {
         state.append(ikey.user_key.ToString());
         state.append(")");
         break;
+      case kTypeMerge:
+        state.append("Merge(");
+        state.append(ikey.user_key.ToString());
+        state.append(", ");
+        state.append(iter->value().ToString());
+        state.append(")");
+        break;
+      case kTypeRangeDeletion:
+        state.append("Unexpected()");
+        break;
     }
     state.append("@");
     state.append(NumberToString(ikey.sequence));
   }
   delete iter;
+  iter = mem->NewRangeTombstoneIterator();
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    ParsedInternalKey ikey;
+    ASSERT_TRUE(ParseInternalKey(iter->key(), &ikey));
+    state.append("DeleteRange(");
+    state.append(ikey.user_key.ToString());
+    state.append(", ");
+    state.append(iter->value().ToString());
+    state.append(")@");
+    state.append(NumberToString(ikey.sequence));
+  }
+  delete iter;
   if (!s.ok()) {
     state.append("ParseError()");
   }
@@ -69,6 +91,32 @@ TEST(WriteBatchTest, Multiple) {
             PrintContents(&batch));
 }
 
+TEST(WriteBatchTest, DeleteRange) {
+  WriteBatch batch;
+  batch.Put(Slice("foo"), Slice("bar"));
+  batch.DeleteRange(Slice("a"), Slice("g"));
+  batch.Put(Slice("baz"), Slice("boo"));
+  WriteBatchInternal::SetSequence(&batch, 100);
+  ASSERT_EQ(3, WriteBatchInternal::Count(&batch));
+  ASSERT_EQ("Put(baz, boo)@102"
+            "Put(foo, bar)@100"
+            "DeleteRange(a, g)@101",
+            PrintContents(&batch));
+}
+
+TEST(WriteBatchTest, Merge) {
+  WriteBatch batch;
+  batch.Put(Slice("foo"), Slice("1"));
+  batch.Merge(Slice("foo"), Slice("2"));
+  batch.Merge(Slice("bar"), Slice("3"));
+  WriteBatchInternal::SetSequence(&batch, 100);
+  ASSERT_EQ(3, WriteBatchInternal::Count(&batch));
+  ASSERT_EQ("Merge(bar, 3)@102"
+            "Merge(foo, 2)@101"
+            "Put(foo, 1)@100",
+            PrintContents(&batch));
+}
+
 TEST(WriteBatchTest, Corruption) {
   WriteBatch batch;
   batch.Put(Slice("foo"), Slice("bar"));
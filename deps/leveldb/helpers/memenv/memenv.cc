@@ -9,6 +9,9 @@
 #include "port/port.h"
 #include "util/mutexlock.h"
 #include <map>
+#include <set>
+#include <stdarg.h>
+#include <stdio.h>
 #include <string.h>
 #include <string>
 #include <vector>
@@ -221,6 +224,53 @@ class WritableFileImpl : public WritableFile {
   FileState* file_;
 };
 
+// Appends each message as a line to an in-memory file.
+class LoggerImpl : public Logger {
+ public:
+  explicit LoggerImpl(FileState* file) : file_(file) { file_->Ref(); }
+
+  ~LoggerImpl() { file_->Unref(); }
+
+  virtual void Logv(const char* format, va_list ap) {
+    char buffer[500];
+    va_list backup_ap;
+    va_copy(backup_ap, ap);
+    int n = vsnprintf(buffer, sizeof(buffer), format, backup_ap);
+    va_end(backup_ap);
+
+    std::string line;
+    if (n < 0) {
+      return;
+    } else if (static_cast<size_t>(n) < sizeof(buffer)) {
+      line.assign(buffer, n);
+    } else {
+      line.resize(n + 1);
+      vsnprintf(&line[0], n + 1, format, ap);
+      line.resize(n);
+    }
+    if (line.empty() || line[line.size() - 1] != '\n') {
+      line.push_back('\n');
+    }
+
+    // Loggers may be called from several threads at once
+    MutexLock lock(&mutex_);
+    file_->Append(line);
+  }
+
+ private:
+  port::Mutex mutex_;
+  FileState* file_;
+};
+
+class FileLockImpl : public FileLock {
+ public:
+  explicit FileLockImpl(const std::string& fname) : fname_(fname) { }
+  const std::string& fname() const { return fname_; }
+
+ private:
+  std::string fname_;
+};
+
 class InMemoryEnv : public EnvWrapper {
  public:
   explicit InMemoryEnv(Env* base_env) : EnvWrapper(base_env) { }
@@ -271,6 +321,18 @@ class InMemoryEnv : public EnvWrapper {
     return Status::OK();
   }
 
+  virtual Status NewAppendableFile(const std::string& fname,
+                                   WritableFile** result) {
+    MutexLock lock(&mutex_);
+    if (file_map_.find(fname) == file_map_.end()) {
+      *result = NULL;
+      return Status::IOError(fname, "File not found");
+    }
+
+    *result = new WritableFileImpl(file_map_[fname]);
+    return Status::OK();
+  }
+
   virtual bool FileExists(const std::string& fname) {
     MutexLock lock(&mutex_);
     return file_map_.find(fname) != file_map_.end();
@@ -344,12 +406,32 @@ class InMemoryEnv : public EnvWrapper {
   }
 
   virtual Status LockFile(const std::string& fname, FileLock** lock) {
-    *lock = new FileLock;
+    MutexLock l(&mutex_);
+    if (!locks_.insert(fname).second) {
+      *lock = NULL;
+      return Status::IOError("lock " + fname, "already held by process");
+    }
+    *lock = new FileLockImpl(fname);
     return Status::OK();
   }
 
   virtual Status UnlockFile(FileLock* lock) {
-    delete lock;
+    MutexLock l(&mutex_);
+    FileLockImpl* impl = reinterpret_cast<FileLockImpl*>(lock);
+    locks_.erase(impl->fname());
+    delete impl;
+    return Status::OK();
+  }
+
+  virtual Status NewLogger(const std::string& fname, Logger** result) {
+    MutexLock lock(&mutex_);
+    DeleteFileInternal(fname);
+
+    FileState* file = new FileState();
+    file->Ref();
+    file_map_[fname] = file;
+
+    *result = new LoggerImpl(file);
     return Status::OK();
   }
 
@@ -363,6 +445,7 @@ class InMemoryEnv : public EnvWrapper {
   typedef std::map<std::string, FileState*> FileSystem;
   port::Mutex mutex_;
   FileSystem file_map_;  // Protected by mutex_.
+  std::set<std::string> locks_;  // Protected by mutex_.
 };
 
 }  // namespace
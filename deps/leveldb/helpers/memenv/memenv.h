@@ -10,8 +10,9 @@ namespace leveldb {
 class Env;
 
 // Returns a new environment that stores its data in memory and delegates
-// all non-file-storage tasks to base_env. The caller must delete the result
-// when it is no longer needed.
+// all non-file-storage tasks to base_env. Info logs are kept in memory
+// too, and file locks exclude each other as they do on disk. The caller
+// must delete the result when it is no longer needed.
 // *base_env must remain live while the result is in use.
 Env* NewMemEnv(Env* base_env);
 
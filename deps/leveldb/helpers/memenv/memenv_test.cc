@@ -128,12 +128,39 @@ TEST(MemEnvTest, ReadWrite) {
 
 TEST(MemEnvTest, Locks) {
   FileLock* lock;
+  FileLock* other;
 
-  // These are no-ops, but we test they return success.
+  ASSERT_OK(env_->LockFile("some file", &lock));
+  ASSERT_TRUE(!env_->LockFile("some file", &other).ok());
+  ASSERT_OK(env_->LockFile("other file", &other));
+  ASSERT_OK(env_->UnlockFile(other));
+  ASSERT_OK(env_->UnlockFile(lock));
+
+  // Released locks can be taken again
   ASSERT_OK(env_->LockFile("some file", &lock));
   ASSERT_OK(env_->UnlockFile(lock));
 }
 
+TEST(MemEnvTest, Logger) {
+  Logger* logger;
+  ASSERT_OK(env_->NewLogger("/dir/LOG", &logger));
+  Log(logger, "hello %d", 1);
+  Log(logger, "%s", std::string(1000, 'x').c_str());
+  delete logger;
+
+  uint64_t file_size;
+  ASSERT_OK(env_->GetFileSize("/dir/LOG", &file_size));
+  ASSERT_EQ(8 + 1001, file_size);
+
+  SequentialFile* file;
+  Slice result;
+  char scratch[8];
+  ASSERT_OK(env_->NewSequentialFile("/dir/LOG", &file));
+  ASSERT_OK(file->Read(8, &result, scratch));
+  ASSERT_EQ("hello 1\n", result.ToString());
+  delete file;
+}
+
 TEST(MemEnvTest, Misc) {
   std::string test_dir;
   ASSERT_OK(env_->GetTestDirectory(&test_dir));
@@ -223,6 +250,14 @@ TEST(MemEnvTest, DBTest) {
   }
 
   delete db;
+
+  // The database stays locked while it is open
+  ASSERT_OK(DB::Open(options, "/dir/db", &db));
+  DB* other;
+  ASSERT_TRUE(!DB::Open(options, "/dir/db", &other).ok());
+  delete db;
+  ASSERT_OK(DestroyDB("/dir/db", options));
+  ASSERT_TRUE(!env_->FileExists("/dir/db/CURRENT"));
 }
 
 }  // namespace leveldb
@@ -0,0 +1,50 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_COMPACTION_FILTER_H_
+#define STORAGE_LEVELDB_INCLUDE_COMPACTION_FILTER_H_
+
+#include <stdint.h>
+
+namespace leveldb {
+
+class Env;
+class Slice;
+
+// A CompactionFilter decides which values are garbage, e.g. because
+// they have expired.  Compactions drop such values as they rewrite
+// them, so getting rid of them costs no extra writes.  Older values for
+// the same key stay hidden.
+//
+// A CompactionFilter implementation must be thread-safe since leveldb
+// may invoke its methods concurrently from multiple threads.
+class CompactionFilter {
+ public:
+  virtual ~CompactionFilter();
+
+  // Return true if "value", the current value of "key", should be
+  // dropped.  Compactions only ask about values that every snapshot
+  // sees.  Reads ask as well if Options::compaction_filter_on_read is
+  // set.
+  virtual bool Filter(const Slice& key, const Slice& value) const = 0;
+
+  // The name of the filter, for logging.
+  virtual const char* Name() const = 0;
+};
+
+// Return a new filter that drops values once they are "ttl_seconds"
+// old.  Each value must end (or start, if "timestamp_prefix" is true)
+// with the time it was written, in seconds since the epoch, as a 4-byte
+// big-endian number.  With a zero "ttl_seconds" the timestamp is the
+// time at which the value expires instead.  The current time is taken
+// from "env".  Values too short to hold a timestamp never expire.
+//
+// The caller should delete the result when it is no longer needed,
+// after the DB that uses it has been deleted.
+extern CompactionFilter* NewTTLFilter(Env* env, uint32_t ttl_seconds,
+                                      bool timestamp_prefix);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_COMPACTION_FILTER_H_
@@ -7,6 +7,8 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <string>
+#include <vector>
 #include "leveldb/iterator.h"
 #include "leveldb/options.h"
 
@@ -67,6 +69,23 @@ class DB {
   // Note: consider setting options.sync = true.
   virtual Status Delete(const WriteOptions& options, const Slice& key) = 0;
 
+  // Remove every database entry whose key is in the range [start,limit).
+  // Returns OK on success, and a non-OK status on error.  The entries are
+  // hidden immediately; their space is reclaimed by later compactions,
+  // which drop table files lying wholly inside the range without
+  // reading them.
+  // Note: consider setting options.sync = true.
+  virtual Status DeleteRange(const WriteOptions& options,
+                             const Slice& start, const Slice& limit);
+
+  // Merge "value" into the database entry for "key" with
+  // Options::merge_operator.  Returns OK on success, and a non-OK status
+  // on error.  The merge is applied lazily, by later reads and
+  // compactions.
+  // Note: consider setting options.sync = true.
+  virtual Status Merge(const WriteOptions& options,
+                       const Slice& key, const Slice& value);
+
   // Apply the specified updates to the database.
   // Returns OK on success, non-OK on failure.
   // Note: consider setting options.sync = true.
@@ -114,6 +133,17 @@ class DB {
   //     about the internal operation of the DB.
   //  "leveldb.sstables" - returns a multi-line string that describes all
   //     of the sstables that make up the db contents.
+  //  "leveldb.num-immutable-memtables" - returns the number of memtables
+  //     waiting to be compacted.
+  //  "leveldb.approximate-memory-usage" - returns the approximate number
+  //     of bytes of memory held by the memtables.
+  //  "leveldb.num-snapshots" - returns the number of unreleased snapshots.
+  //  "leveldb.oldest-snapshot-age" - returns the number of seconds since
+  //     the oldest unreleased snapshot was taken, or 0 if there is none.
+  //  "leveldb.num-iterators" - returns the number of iterators that have
+  //     not been deleted yet.
+  //  "leveldb.oldest-iterator-age" - returns the number of seconds since
+  //     the oldest live iterator was created, or 0 if there is none.
   virtual bool GetProperty(const Slice& property, std::string* value) = 0;
 
   // For each i in [0,n-1], store in "sizes[i]", the approximate
@@ -139,6 +169,85 @@ class DB {
   //    db->CompactRange(NULL, NULL);
   virtual void CompactRange(const Slice* begin, const Slice* end) = 0;
 
+  // Load the sstables that hold levels [0,max_level] of the current
+  // database state ahead of use, so that the first reads after opening
+  // a database do not have to go to disk.  The operating system is asked
+  // to read the files into its page cache and, unless options.fill_cache
+  // is false, their data blocks are inserted into the block cache.
+  // Levels are loaded in order and loading stops before the first file
+  // that would take the total past "max_bytes" (0 means no limit).
+  //
+  // If "progress" is non-NULL, it is called after every file with the
+  // number of bytes loaded so far and the total number of bytes that
+  // will be loaded.  It is invoked on the thread that called Warmup().
+  virtual Status Warmup(const ReadOptions& options,
+                        int max_level, uint64_t max_bytes,
+                        void (*progress)(void* arg, uint64_t done,
+                                         uint64_t total),
+                        void* arg) = 0;
+
+  // Add the table files named by "files", written with TableFileWriter,
+  // to the database.  Each file is hard-linked into the database
+  // directory if the Env supports it and copied otherwise, and is added
+  // as it is to the deepest level that no level above it overlaps, so
+  // bulk loaded data is written exactly once.  Either all of the files
+  // are added or none is.
+  //
+  // The files may not overlap each other; InvalidArgument is returned
+  // otherwise.  They may overlap data in the database, which they
+  // replace: all of the ingested entries take the next sequence number,
+  // as one write would, so snapshots taken before the call do not see
+  // them.  The memtable is flushed first if it holds any of the keys.
+  // Writes wait while the files are installed.
+  //
+  // The sequence number is recorded in a small trailer appended to each
+  // file, which a linked source file shares, so that RepairDB() can
+  // recover it.  A file that already has one is copied instead.
+  //
+  // The default implementation returns NotSupported.
+  virtual Status IngestFiles(const std::vector<std::string>& files);
+
+  // Create a consistent copy of the database in the directory "dir",
+  // which may not hold a database already.  The memtables are flushed
+  // first, so the copy holds every write completed before the call.
+  // Table files are hard-linked if the Env supports it and copied
+  // otherwise, so a checkpoint of a large database takes little time and
+  // disk space.  Writes only wait for the flush.  The copy may be opened
+  // as a database of its own.
+  //
+  // The default implementation returns NotSupported.
+  virtual Status Checkpoint(const std::string& dir);
+
+  // Append to *updates the write batches committed with sequence numbers
+  // from "sequence" on, oldest first, stopping once they add up to
+  // max_bytes if that is non-zero.  Each update is the contents of a
+  // batch as logged: its first sequence number as a fixed 64-bit
+  // little-endian number, its number of entries as a fixed 32-bit
+  // number, then the entries.  A batch that includes "sequence" is
+  // returned whole even if it starts before it.
+  //
+  // Updates are read back from the log files, so only those still in a
+  // log are available; see Options::log_retention_bytes.  NotFound is
+  // returned if some of the requested updates no longer are.  Files
+  // added with IngestFiles() are not logged either: the batches before
+  // their sequence number are returned, and NotFound once "sequence"
+  // reaches it.
+  //
+  // The default implementation returns NotSupported.
+  virtual Status GetUpdatesSince(uint64_t sequence, size_t max_bytes,
+                                 std::vector<std::string>* updates);
+
+  // Return the sequence number of the latest write, or 0 if the
+  // implementation does not track them.
+  virtual uint64_t GetLatestSequenceNumber();
+
+  // For databases opened with Options::read_only: read what the process
+  // writing the database has added to its descriptor and log files
+  // since the last call or the open, so that later reads see it.
+  //
+  // The default implementation returns NotSupported.
+  virtual Status CatchUp();
+
  private:
   // No copying allowed
   DB(const DB&);
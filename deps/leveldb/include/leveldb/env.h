@@ -69,6 +69,14 @@ class Env {
   virtual Status NewWritableFile(const std::string& fname,
                                  WritableFile** result) = 0;
 
+  // Create an object that appends to the existing file "fname".  On
+  // success, stores a pointer to it in *result and returns OK.  On
+  // failure stores NULL in *result and returns non-OK.
+  //
+  // The default implementation returns NotSupported.
+  virtual Status NewAppendableFile(const std::string& fname,
+                                   WritableFile** result);
+
   // Returns true iff the named file exists.
   virtual bool FileExists(const std::string& fname) = 0;
 
@@ -94,6 +102,11 @@ class Env {
   virtual Status RenameFile(const std::string& src,
                             const std::string& target) = 0;
 
+  // Create "target" as another name for the existing file "src".
+  // The default implementation returns NotSupported, in which case
+  // callers fall back to copying the file.
+  virtual Status LinkFile(const std::string& src, const std::string& target);
+
   // Lock the specified file.  Used to prevent concurrent access to
   // the same db by multiple processes.  On failure, stores NULL in
   // *lock and returns non-OK.
@@ -194,6 +207,13 @@ class RandomAccessFile {
   // Safe for concurrent use by multiple threads.
   virtual Status Read(uint64_t offset, size_t n, Slice* result,
                       char* scratch) const = 0;
+
+  // Hint that bytes [offset..offset+n-1] of the file will be read soon,
+  // so that the implementation may start loading them in the background.
+  // The default implementation does nothing.
+  //
+  // Safe for concurrent use by multiple threads.
+  virtual Status Prefetch(uint64_t offset, size_t n) const;
 };
 
 // A file abstraction for sequential writing.  The implementation
@@ -279,6 +299,9 @@ class EnvWrapper : public Env {
   Status NewWritableFile(const std::string& f, WritableFile** r) {
     return target_->NewWritableFile(f, r);
   }
+  Status NewAppendableFile(const std::string& f, WritableFile** r) {
+    return target_->NewAppendableFile(f, r);
+  }
   bool FileExists(const std::string& f) { return target_->FileExists(f); }
   Status GetChildren(const std::string& dir, std::vector<std::string>* r) {
     return target_->GetChildren(dir, r);
@@ -292,6 +315,9 @@ class EnvWrapper : public Env {
   Status RenameFile(const std::string& s, const std::string& t) {
     return target_->RenameFile(s, t);
   }
+  Status LinkFile(const std::string& s, const std::string& t) {
+    return target_->LinkFile(s, t);
+  }
   Status LockFile(const std::string& f, FileLock** l) {
     return target_->LockFile(f, l);
   }
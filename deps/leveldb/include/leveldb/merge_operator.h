@@ -0,0 +1,60 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_MERGE_OPERATOR_H_
+#define STORAGE_LEVELDB_INCLUDE_MERGE_OPERATOR_H_
+
+#include <string>
+
+namespace leveldb {
+
+class Slice;
+
+// A MergeOperator folds the operands written with WriteBatch::Merge()
+// into the value of a key, so that read-modify-write updates such as
+// counters need neither a read nor a lock.  Operands are stored as they
+// are written and folded lazily by reads and compactions.
+//
+// The operator must be associative: merging "a" with "b" and then the
+// result with "c" must give the same value as merging "a" with the
+// result of merging "b" with "c", because compactions combine runs of
+// operands before the value they apply to is known.
+//
+// A MergeOperator implementation must be thread-safe since leveldb may
+// invoke its methods concurrently from multiple threads.
+class MergeOperator {
+ public:
+  virtual ~MergeOperator();
+
+  // Merge "value" into "*existing_value", which is NULL if the key has
+  // no value, and store the result in *new_value.  When a compaction
+  // combines a run of operands, *existing_value is the older operand.
+  // Return false if the inputs cannot be merged: reads of the key then
+  // fail with a corruption error, and compactions keep the operands as
+  // they are.
+  virtual bool Merge(const Slice& key, const Slice* existing_value,
+                     const Slice& value, std::string* new_value) const = 0;
+
+  // The name of the operator, for logging.
+  virtual const char* Name() const = 0;
+};
+
+// Built-in operators.  The results are owned by leveldb and must not
+// be deleted.
+
+// Values and operands are unsigned 64-bit integers in decimal ASCII
+// ("42").  Merging adds them, wrapping around at 2^64; a missing value
+// counts as zero.
+extern const MergeOperator* UInt64AddOperator();
+
+// Values and operands are unsigned 64-bit integers in decimal ASCII.
+// Merging keeps the larger one.
+extern const MergeOperator* UInt64MaxOperator();
+
+// Merging appends the bytes of the operand to the value.
+extern const MergeOperator* AppendOperator();
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_MERGE_OPERATOR_H_
@@ -6,13 +6,16 @@
 #define STORAGE_LEVELDB_INCLUDE_OPTIONS_H_
 
 #include <stddef.h>
+#include <stdint.h>
 
 namespace leveldb {
 
 class Cache;
+class CompactionFilter;
 class Comparator;
 class Env;
 class Logger;
+class MergeOperator;
 class Snapshot;
 
 // DB contents are stored in a set of blocks, each of which holds a
@@ -39,6 +42,25 @@ struct Options {
   // comparator provided to previous open calls on the same DB.
   const Comparator* comparator;
 
+  // Operator that folds the operands written with WriteBatch::Merge()
+  // into values.  Reading a key that has merge operands fails with a
+  // NotSupported error if this is NULL.
+  //
+  // REQUIRES: The client must supply an operator that merges exactly
+  // like the one used by earlier opens of the same DB.
+  // Default: NULL
+  const MergeOperator* merge_operator;
+
+  // If non-NULL, compactions drop the values this filter rejects.
+  // Default: NULL
+  const CompactionFilter* compaction_filter;
+
+  // If true, Get() and iterators also hide the values that
+  // compaction_filter rejects, so they disappear as soon as the filter
+  // rejects them instead of at the next compaction that rewrites them.
+  // Default: false
+  bool compaction_filter_on_read;
+
   // If true, the database will be created if it is missing.
   // Default: false
   bool create_if_missing;
@@ -55,6 +77,16 @@ struct Options {
   // Default: false
   bool paranoid_checks;
 
+  // If true, the database is opened for reading only: it is not locked,
+  // so any number of processes may open it this way, and recovery
+  // replays the log files into memory instead of writing a new table
+  // file and descriptor.  Writes, compactions, ingestion and checkpoints
+  // fail with NotSupported, and no info log is written unless info_log
+  // is set.  A process that has the database open for writing may still
+  // delete files that the reader needs; DB::CatchUp() follows its writes.
+  // Default: false
+  bool read_only;
+
   // Use the specified object to interact with the environment,
   // e.g. to read/write files, schedule background work, etc.
   // Default: Env::Default()
@@ -66,6 +98,12 @@ struct Options {
   // Default: NULL
   Logger* info_log;
 
+  // Log files that are no longer needed for recovery are kept, newest
+  // first, while their combined size is at most this many bytes, so that
+  // DB::GetUpdatesSince() can read the updates they hold.
+  // Default: 0
+  uint64_t log_retention_bytes;
+
   // -------------------
   // Parameters that affect performance
 
@@ -81,6 +119,52 @@ struct Options {
   // Default: 4MB
   size_t write_buffer_size;
 
+  // If true, concurrent calls to DB::Write() insert their batches into
+  // the memtable in parallel once each batch has been appended to the
+  // log.  Only the log append is serialized.  This helps when several
+  // threads write large batches at the same time.
+  //
+  // Default: false
+  bool allow_concurrent_memtable_write;
+
+  // Memtable memory is carved out of blocks of up to this many bytes.
+  // Blocks start at 4K and double until they reach this size.  Larger
+  // blocks mean fewer allocations and better TLB behaviour for big write
+  // buffers; values larger than a quarter of the block size still get an
+  // allocation of their own.
+  //
+  // Default: 4K
+  size_t arena_block_size;
+
+  // If true, full sized memtable blocks are backed by huge pages when
+  // the platform supports them, and arena_block_size is rounded up to
+  // a multiple of the huge page size (2MB).
+  //
+  // Default: false
+  bool memtable_huge_pages;
+
+  // Number of full memtables that may wait to be compacted while writes
+  // go on into a new one.  Raising this lets the DB absorb short bursts
+  // of writes without stalling them behind a compaction, at the cost of
+  // memory and of reads that have more memtables to search.
+  //
+  // Default: 1
+  int max_immutable_memtables;
+
+  // If non-zero, writes also wait for a compaction once the memtables
+  // waiting to be compacted would use more than this many bytes,
+  // however few of them there are.
+  //
+  // Default: 0
+  size_t max_immutable_memtable_bytes;
+
+  // Large compactions are split into up to this many disjoint key ranges
+  // that are compacted in parallel, each on a thread of its own.  Every
+  // range gets at least one output file's worth of input.
+  //
+  // Default: 1
+  int max_subcompactions;
+
   // Number of open files that can be used by the DB.  You may need to
   // increase this if your database has a large working set (budget
   // one open file per 2MB of working set).
@@ -150,10 +234,21 @@ struct ReadOptions {
   // Default: NULL
   const Snapshot* snapshot;
 
+  // If non-zero, iterators that move forward through consecutive data
+  // blocks of a table read this many bytes at a time and serve the
+  // following blocks from that buffer, trading memory for fewer and
+  // larger reads during long scans.  Reads that are not sequential are
+  // unaffected.  When fill_cache is false, such iterators also bypass
+  // the block cache entirely.  Values between 256KB and 2MB work well
+  // for storage with high per-request latency.
+  // Default: 0
+  size_t readahead_size;
+
   ReadOptions()
       : verify_checksums(false),
         fill_cache(true),
-        snapshot(NULL) {
+        snapshot(NULL),
+        readahead_size(0) {
   }
 };
 
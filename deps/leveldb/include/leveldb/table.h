@@ -53,6 +53,12 @@ class Table {
   // be close to the file length.
   uint64_t ApproximateOffsetOf(const Slice& key) const;
 
+  // Load the data blocks of the table ahead of use.  The operating
+  // system is asked to read the blocks into its page cache and, unless
+  // options.fill_cache is false, every block is also inserted into the
+  // block cache.
+  Status Prefetch(const ReadOptions& options) const;
+
  private:
   struct Rep;
   Rep* rep_;
@@ -60,6 +66,14 @@ class Table {
   explicit Table(Rep* rep) { rep_ = rep; }
   static Iterator* BlockReader(void*, const ReadOptions&, const Slice&);
 
+  // Support for iterators that read ahead (see ReadOptions::readahead_size)
+  class Readahead;
+  static Iterator* ReadaheadBlockReader(void*, const ReadOptions&,
+                                        const Slice&);
+  static void DeleteReadahead(void*, void*);
+  Iterator* BlockIterator(const ReadOptions&, const Slice&,
+                          Readahead*) const;
+
   // No copying allowed
   Table(const Table&);
   void operator=(const Table&);
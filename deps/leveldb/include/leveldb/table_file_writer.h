@@ -0,0 +1,66 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// TableFileWriter writes a sorted table file outside of any database,
+// for bulk loading with DB::IngestFiles().  Writing the files directly
+// means the data is written exactly once instead of going through the
+// log, the memtable and every level of compactions.
+//
+// A TableFileWriter is not safe for concurrent use.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_TABLE_FILE_WRITER_H_
+#define STORAGE_LEVELDB_INCLUDE_TABLE_FILE_WRITER_H_
+
+#include <stdint.h>
+#include <string>
+#include "leveldb/options.h"
+#include "leveldb/status.h"
+
+namespace leveldb {
+
+class TableFileWriter {
+ public:
+  // "options" must use the same comparator as the database the file
+  // will be ingested into.
+  explicit TableFileWriter(const Options& options);
+
+  // Abandons the file if Finish() has not been called.
+  ~TableFileWriter();
+
+  // Create the file "fname", which must not be inside a database
+  // directory.  An existing file of that name is unlinked first rather
+  // than overwritten, since it may have been ingested already.
+  Status Open(const std::string& fname);
+
+  // Add an entry to the file.
+  // REQUIRES: key is after any previously added key according to the
+  // comparator.  A key that is not is rejected with an InvalidArgument
+  // status.
+  // REQUIRES: Open() has succeeded, Finish() has not been called
+  Status Add(const Slice& key, const Slice& value);
+
+  // Write out the index, sync the file and close it.  A file without
+  // entries is not a valid input to DB::IngestFiles().
+  // REQUIRES: Open() has succeeded, Finish() has not been called
+  Status Finish();
+
+  // Number of calls to Add() so far.
+  uint64_t NumEntries() const;
+
+  // Size of the file generated so far.  If invoked after a successful
+  // Finish() call, returns the size of the final generated file.
+  uint64_t FileSize() const;
+
+ private:
+  struct Rep;
+  Rep* rep_;
+
+  // No copying allowed
+  TableFileWriter(const TableFileWriter&);
+  void operator=(const TableFileWriter&);
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_TABLE_FILE_WRITER_H_
@@ -39,6 +39,15 @@ class WriteBatch {
   // If the database contains a mapping for "key", erase it.  Else do nothing.
   void Delete(const Slice& key);
 
+  // Erase every mapping whose key is in the range [start,limit), as
+  // ordered by the database comparator.  Costs the same as a single
+  // Delete() no matter how many keys are in the range.
+  void DeleteRange(const Slice& start, const Slice& limit);
+
+  // Merge "value" into the value of "key" with the merge operator the
+  // database is opened with.
+  void Merge(const Slice& key, const Slice& value);
+
   // Clear all updates buffered in this batch.
   void Clear();
 
@@ -48,6 +57,9 @@ class WriteBatch {
     virtual ~Handler();
     virtual void Put(const Slice& key, const Slice& value) = 0;
     virtual void Delete(const Slice& key) = 0;
+    // The default implementations ignore range deletions and merges.
+    virtual void DeleteRange(const Slice& start, const Slice& limit);
+    virtual void Merge(const Slice& key, const Slice& value);
   };
   Status Iterate(Handler* handler) const;
 
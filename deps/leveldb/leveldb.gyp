@@ -78,27 +78,35 @@
         'db/log_writer.h',
         'db/memtable.cc',
         'db/memtable.h',
+        'db/range_tombstone.cc',
+        'db/range_tombstone.h',
         'db/repair.cc',
         'db/skiplist.h',
         'db/snapshot.h',
         'db/table_cache.cc',
         'db/table_cache.h',
+        'db/table_file_writer.cc',
         'db/version_edit.cc',
         'db/version_edit.h',
         'db/version_set.cc',
         'db/version_set.h',
         'db/write_batch.cc',
         'db/write_batch_internal.h',
+        'helpers/memenv/memenv.cc',
+        'helpers/memenv/memenv.h',
         'include/leveldb/cache.h',
+        'include/leveldb/compaction_filter.h',
         'include/leveldb/comparator.h',
         'include/leveldb/db.h',
         'include/leveldb/env.h',
         'include/leveldb/iterator.h',
+        'include/leveldb/merge_operator.h',
         'include/leveldb/options.h',
         'include/leveldb/slice.h',
         'include/leveldb/status.h',
         'include/leveldb/table.h',
         'include/leveldb/table_builder.h',
+        'include/leveldb/table_file_writer.h',
         'include/leveldb/write_batch.h',
         'port/port.h',
         'port/port_example.h',
@@ -123,6 +131,7 @@
         'util/cache.cc',
         'util/coding.cc',
         'util/coding.h',
+        'util/compaction_filter.cc',
         'util/comparator.cc',
         'util/crc32c.cc',
         'util/crc32c.h',
@@ -132,10 +141,13 @@
         'util/hash.h',
         'util/logging.cc',
         'util/logging.h',
+        'util/merge_operator.cc',
         'util/mutexlock.h',
         'util/options.cc',
         'util/random.h',
         'util/status.cc',
+        'util/thread_local.cc',
+        'util/thread_local.h',
       ],
       'sources/': [
         ['exclude', '_(android|example|portable)\\.cc$'],
@@ -270,6 +282,16 @@
         'db/log_test.cc',
       ],
     },
+    {
+      'target_name': 'leveldb_merger_test',
+      'type': 'executable',
+      'dependencies': [
+        'leveldb_testutil',
+      ],
+      'sources': [
+        'table/merger_test.cc',
+      ],
+    },
     {
       'target_name': 'leveldb_skiplist_test',
       'type': 'executable',
@@ -290,6 +312,16 @@
         'table/table_test.cc',
       ],
     },
+    {
+      'target_name': 'leveldb_thread_local_test',
+      'type': 'executable',
+      'dependencies': [
+        'leveldb_testutil',
+      ],
+      'sources': [
+        'util/thread_local_test.cc',
+      ],
+    },
     {
       'target_name': 'leveldb_version_edit_test',
       'type': 'executable',
@@ -104,6 +104,15 @@ class AtomicPointer {
     MemoryBarrier();
     rep_ = v;
   }
+  inline bool CompareAndSwap(void* expected, void* v) {
+#if defined(OS_WIN) && defined(COMPILER_MSVC)
+    return InterlockedCompareExchangePointer(&rep_, v, expected) == expected;
+#elif defined(OS_MACOSX)
+    return OSAtomicCompareAndSwapPtrBarrier(expected, v, &rep_);
+#else
+    return __sync_bool_compare_and_swap(&rep_, expected, v);
+#endif
+  }
 };
 
 // AtomicPointer based on <cstdatomic>
@@ -126,6 +135,9 @@ class AtomicPointer {
   inline void NoBarrier_Store(void* v) {
     rep_.store(v, std::memory_order_relaxed);
   }
+  inline bool CompareAndSwap(void* expected, void* v) {
+    return rep_.compare_exchange_strong(expected, v);
+  }
 };
 
 // We have neither MemoryBarrier(), nor <cstdatomic>
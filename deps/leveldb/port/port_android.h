@@ -150,6 +150,13 @@ inline bool GetHeapProfile(void (*func)(void*, const char*, int), void* arg) {
   return false;
 }
 
+inline char* AllocateHugePages(size_t n) {
+  return NULL;
+}
+
+inline void FreeHugePages(char* p, size_t n) {
+}
+
 }  // namespace port
 }  // namespace leveldb
 
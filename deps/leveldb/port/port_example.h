@@ -87,6 +87,11 @@ class AtomicPointer {
 
   // Set va as the stored pointer with no ordering guarantees.
   void NoBarrier_Store(void* v);
+
+  // If the stored pointer equals "expected", atomically replace it with v
+  // and return true.  Else leave it unchanged and return false.  Acts as
+  // a full memory barrier.
+  bool CompareAndSwap(void* expected, void* v);
 };
 
 // ------------------ Compression -------------------
@@ -119,6 +124,13 @@ extern bool Snappy_Uncompress(const char* input_data, size_t input_length,
 // The concatenation of all "data[0,n-1]" fragments is the heap profile.
 extern bool GetHeapProfile(void (*func)(void*, const char*, int), void* arg);
 
+// Allocate "n" bytes of memory backed by huge pages, if the platform
+// supports them.  Returns NULL otherwise, in which case the caller should
+// fall back to ordinary allocation.  Memory returned by this function
+// must be released with FreeHugePages(p, n).
+extern char* AllocateHugePages(size_t n);
+extern void FreeHugePages(char* p, size_t n);
+
 }  // namespace port
 }  // namespace leveldb
 
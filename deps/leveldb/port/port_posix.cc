@@ -7,6 +7,7 @@
 #include <cstdlib>
 #include <stdio.h>
 #include <string.h>
+#include <sys/mman.h>
 #include "util/logging.h"
 
 namespace leveldb {
@@ -46,5 +47,31 @@ void CondVar::SignalAll() {
   PthreadCall("broadcast", pthread_cond_broadcast(&cv_));
 }
 
+char* AllocateHugePages(size_t n) {
+  void* p;
+#if defined(MAP_HUGETLB)
+  // Explicit huge pages, if the administrator has reserved some
+  p = mmap(NULL, n, PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (p != MAP_FAILED) {
+    return reinterpret_cast<char*>(p);
+  }
+#endif
+#if defined(MADV_HUGEPAGE)
+  // Otherwise ask for transparent huge pages
+  p = mmap(NULL, n, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p != MAP_FAILED) {
+    madvise(p, n, MADV_HUGEPAGE);
+    return reinterpret_cast<char*>(p);
+  }
+#endif
+  (void) p;
+  return NULL;
+}
+
+void FreeHugePages(char* p, size_t n) {
+  munmap(p, n);
+}
+
 }  // namespace port
 }  // namespace leveldb
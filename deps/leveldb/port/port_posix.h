@@ -115,6 +115,9 @@ inline bool GetHeapProfile(void (*func)(void*, const char*, int), void* arg) {
   return false;
 }
 
+extern char* AllocateHugePages(size_t n);
+extern void FreeHugePages(char* p, size_t n);
+
 } // namespace port
 } // namespace leveldb
 
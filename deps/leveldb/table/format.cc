@@ -63,45 +63,32 @@ Status Footer::DecodeFrom(Slice* input) {
   return result;
 }
 
-Status ReadBlock(RandomAccessFile* file,
-                 const ReadOptions& options,
-                 const BlockHandle& handle,
-                 Block** block) {
-  *block = NULL;
-
-  // Read the block contents as well as the type/crc footer.
-  // See table_builder.cc for the code that built this structure.
-  size_t n = static_cast<size_t>(handle.size());
-  char* buf = new char[n + kBlockTrailerSize];
-  Slice contents;
-  Status s = file->Read(handle.offset(), n + kBlockTrailerSize, &contents, buf);
-  if (!s.ok()) {
-    delete[] buf;
-    return s;
-  }
-  if (contents.size() != n + kBlockTrailerSize) {
-    delete[] buf;
-    return Status::Corruption("truncated block read");
-  }
-
+// Verify and decompress the block whose contents and trailer are
+// stored in data[0..n+kBlockTrailerSize-1].  "buf" is either NULL or
+// the heap-allocated array that holds the data; it is handed over to
+// the block or deleted.
+static Status FinishBlock(const char* data, size_t n, char* buf,
+                          const ReadOptions& options,
+                          Block** block) {
   // Check the crc of the type and the block contents
-  const char* data = contents.data();    // Pointer to where Read put the data
   if (options.verify_checksums) {
     const uint32_t crc = crc32c::Unmask(DecodeFixed32(data + n + 1));
     const uint32_t actual = crc32c::Value(data, n + 1);
     if (actual != crc) {
       delete[] buf;
-      s = Status::Corruption("block checksum mismatch");
-      return s;
+      return Status::Corruption("block checksum mismatch");
     }
   }
 
   switch (data[n]) {
     case kNoCompression:
       if (data != buf) {
-        // File implementation gave us pointer to some other data.
-        // Copy into buf[].
-        memcpy(buf, data, n + kBlockTrailerSize);
+        // Data lives elsewhere (in a file mapping or a readahead
+        // buffer).  Copy into buf[].
+        if (buf == NULL) {
+          buf = new char[n];
+        }
+        memcpy(buf, data, n);
       }
 
       // Ok
@@ -132,4 +119,39 @@ Status ReadBlock(RandomAccessFile* file,
   return Status::OK();
 }
 
+Status ReadBlock(RandomAccessFile* file,
+                 const ReadOptions& options,
+                 const BlockHandle& handle,
+                 Block** block) {
+  *block = NULL;
+
+  // Read the block contents as well as the type/crc footer.
+  // See table_builder.cc for the code that built this structure.
+  size_t n = static_cast<size_t>(handle.size());
+  char* buf = new char[n + kBlockTrailerSize];
+  Slice contents;
+  Status s = file->Read(handle.offset(), n + kBlockTrailerSize, &contents, buf);
+  if (!s.ok()) {
+    delete[] buf;
+    return s;
+  }
+  if (contents.size() != n + kBlockTrailerSize) {
+    delete[] buf;
+    return Status::Corruption("truncated block read");
+  }
+
+  return FinishBlock(contents.data(), n, buf, options, block);
+}
+
+Status DecodeBlock(const Slice& contents,
+                   const ReadOptions& options,
+                   Block** block) {
+  *block = NULL;
+  if (contents.size() < kBlockTrailerSize) {
+    return Status::Corruption("truncated block read");
+  }
+  return FinishBlock(contents.data(), contents.size() - kBlockTrailerSize,
+                     NULL, options, block);
+}
+
 }  // namespace leveldb
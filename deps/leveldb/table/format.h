@@ -91,6 +91,13 @@ extern Status ReadBlock(RandomAccessFile* file,
                         const BlockHandle& handle,
                         Block** block);
 
+// Like ReadBlock(), but the block contents followed by the block trailer
+// have already been read into "contents".  The contents are copied, so
+// the caller keeps ownership of the underlying storage.
+extern Status DecodeBlock(const Slice& contents,
+                          const ReadOptions& options,
+                          Block** block);
+
 // Implementation details follow.  Clients should ignore,
 
 inline BlockHandle::BlockHandle()
@@ -0,0 +1,160 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "table/merger.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "leveldb/comparator.h"
+#include "leveldb/iterator.h"
+#include "util/random.h"
+#include "util/testharness.h"
+#include "util/testutil.h"
+
+namespace leveldb {
+
+// Iterates over a sorted vector of keys.  The value of each entry is
+// the name of the child it came from.
+class VectorIterator : public Iterator {
+ public:
+  VectorIterator(const std::vector<std::string>& keys, const std::string& name)
+      : keys_(keys), name_(name), pos_(keys.size()) {
+  }
+
+  virtual bool Valid() const { return pos_ < keys_.size(); }
+  virtual void SeekToFirst() { pos_ = 0; }
+  virtual void SeekToLast() {
+    pos_ = keys_.empty() ? keys_.size() : keys_.size() - 1;
+  }
+  virtual void Seek(const Slice& target) {
+    pos_ = std::lower_bound(keys_.begin(), keys_.end(), target.ToString())
+        - keys_.begin();
+  }
+  virtual void Next() { assert(Valid()); pos_++; }
+  virtual void Prev() {
+    assert(Valid());
+    pos_ = (pos_ == 0) ? keys_.size() : pos_ - 1;
+  }
+  virtual Slice key() const { return keys_[pos_]; }
+  virtual Slice value() const { return name_; }
+  virtual Status status() const { return Status::OK(); }
+
+ private:
+  const std::vector<std::string> keys_;
+  const std::string name_;
+  size_t pos_;
+};
+
+class MergerTest {
+ public:
+  Random rnd_;
+  std::vector<std::string> all_;      // Every key, sorted
+
+  MergerTest() : rnd_(test::RandomSeed()) { }
+
+  // Spread "num" distinct keys over "n" children
+  Iterator* NewMerger(int n, int num) {
+    std::vector<std::vector<std::string> > keys(n);
+    all_.clear();
+    for (int i = 0; i < num; i++) {
+      char buf[20];
+      snprintf(buf, sizeof(buf), "%08d", i);
+      all_.push_back(buf);
+      keys[rnd_.Uniform(n)].push_back(buf);
+    }
+    std::vector<Iterator*> children;
+    for (int i = 0; i < n; i++) {
+      char name[20];
+      snprintf(name, sizeof(name), "%d", i);
+      children.push_back(new VectorIterator(keys[i], name));
+    }
+    return NewMergingIterator(BytewiseComparator(),
+                              children.empty() ? NULL : &children[0], n);
+  }
+
+  void Check(int n, int num) {
+    Iterator* iter = NewMerger(n, num);
+
+    size_t i = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), i++) {
+      ASSERT_EQ(all_[i], iter->key().ToString());
+    }
+    ASSERT_EQ(all_.size(), i);
+
+    for (iter->SeekToLast(); iter->Valid(); iter->Prev()) {
+      ASSERT_EQ(all_[--i], iter->key().ToString());
+    }
+    ASSERT_EQ(0, i);
+
+    // Random walk that keeps switching direction
+    if (num > 0) {
+      iter->Seek(all_[num / 2]);
+      i = num / 2;
+      for (int step = 0; step < 1000; step++) {
+        ASSERT_TRUE(iter->Valid());
+        ASSERT_EQ(all_[i], iter->key().ToString());
+        if (rnd_.OneIn(2)) {
+          if (i + 1 == all_.size()) continue;
+          iter->Next();
+          i++;
+        } else {
+          if (i == 0) continue;
+          iter->Prev();
+          i--;
+        }
+      }
+    }
+    ASSERT_OK(iter->status());
+    delete iter;
+  }
+};
+
+TEST(MergerTest, Empty) {
+  for (int n = 0; n < 4; n++) {
+    Check(n, 0);
+  }
+}
+
+TEST(MergerTest, FewChildren) {
+  for (int n = 1; n <= 4; n++) {
+    Check(n, 500);
+  }
+}
+
+TEST(MergerTest, ManyChildren) {
+  Check(16, 2000);
+  Check(64, 5000);
+  Check(100, 50);      // Some children are empty
+}
+
+TEST(MergerTest, EqualKeys) {
+  // Children holding the same key are yielded in child order moving
+  // forward, and in reverse child order moving backwards.
+  std::vector<std::string> keys;
+  keys.push_back("a");
+  keys.push_back("b");
+  Iterator* children[3];
+  children[0] = new VectorIterator(keys, "0");
+  children[1] = new VectorIterator(keys, "1");
+  children[2] = new VectorIterator(keys, "2");
+  Iterator* iter = NewMergingIterator(BytewiseComparator(), children, 3);
+  std::string result;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    result += iter->key().ToString() + iter->value().ToString() + " ";
+  }
+  ASSERT_EQ("a0 a1 a2 b0 b1 b2 ", result);
+  result.clear();
+  for (iter->SeekToLast(); iter->Valid(); iter->Prev()) {
+    result += iter->key().ToString() + iter->value().ToString() + " ";
+  }
+  ASSERT_EQ("b2 b1 b0 a2 a1 a0 ", result);
+  delete iter;
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  return leveldb::test::RunAllTests();
+}
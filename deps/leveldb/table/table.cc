@@ -88,16 +88,117 @@ static void ReleaseBlock(void* arg, void* h) {
   cache->Release(handle);
 }
 
+// Buffer for an iterator that reads ahead: once the iterator asks for
+// two blocks in a row that are adjacent in the file, the following
+// "size" bytes of data blocks are read with a single request and
+// subsequent blocks are decoded from that buffer.
+class Table::Readahead {
+ public:
+  Readahead(const Table* table, size_t size)
+      : table_(table),
+        size_(size),
+        buf_(NULL),
+        capacity_(0),
+        offset_(0),
+        next_(~static_cast<uint64_t>(0)) {
+  }
+
+  ~Readahead() {
+    delete[] buf_;
+  }
+
+  const Table* table() const { return table_; }
+
+  Status Read(const ReadOptions& options, const BlockHandle& handle,
+              Block** block) {
+    const Rep* rep = table_->rep_;
+    const uint64_t offset = handle.offset();
+    const size_t n = static_cast<size_t>(handle.size()) + kBlockTrailerSize;
+    const bool sequential = (offset == next_);
+    next_ = offset + n;
+
+    if (offset < offset_ || offset + n > offset_ + data_.size()) {
+      if (!sequential) {
+        // Probably a seek: do not read ahead until the scan continues
+        return ReadBlock(rep->file, options, handle, block);
+      }
+
+      // Data blocks end where the metaindex block starts
+      const uint64_t limit = rep->metaindex_handle.offset();
+      size_t len = size_;
+      if (offset + len > limit) {
+        len = (limit > offset) ? static_cast<size_t>(limit - offset) : 0;
+      }
+      if (len < n) {
+        len = n;
+      }
+      if (len > capacity_) {
+        delete[] buf_;
+        buf_ = new char[len];
+        capacity_ = len;
+      }
+      offset_ = offset;
+      Status s = rep->file->Read(offset, len, &data_, buf_);
+      if (s.ok() && data_.size() < n) {
+        s = Status::Corruption("truncated block read");
+      }
+      if (!s.ok()) {
+        data_ = Slice();
+        *block = NULL;
+        return s;
+      }
+    }
+
+    return DecodeBlock(Slice(data_.data() + (offset - offset_), n),
+                       options, block);
+  }
+
+ private:
+  const Table* table_;
+  const size_t size_;
+  char* buf_;
+  size_t capacity_;
+  Slice data_;        // Holds file bytes [offset_..offset_+data_.size()-1]
+  uint64_t offset_;
+  uint64_t next_;     // Offset just past the last block that was read
+
+  // No copying allowed
+  Readahead(const Readahead&);
+  void operator=(const Readahead&);
+};
+
+void Table::DeleteReadahead(void* arg, void* ignored) {
+  delete reinterpret_cast<Readahead*>(arg);
+}
+
 // Convert an index iterator value (i.e., an encoded BlockHandle)
 // into an iterator over the contents of the corresponding block.
 Iterator* Table::BlockReader(void* arg,
                              const ReadOptions& options,
                              const Slice& index_value) {
   Table* table = reinterpret_cast<Table*>(arg);
-  Cache* block_cache = table->rep_->options.block_cache;
+  return table->BlockIterator(options, index_value, NULL);
+}
+
+Iterator* Table::ReadaheadBlockReader(void* arg,
+                                      const ReadOptions& options,
+                                      const Slice& index_value) {
+  Readahead* readahead = reinterpret_cast<Readahead*>(arg);
+  return readahead->table()->BlockIterator(options, index_value, readahead);
+}
+
+Iterator* Table::BlockIterator(const ReadOptions& options,
+                               const Slice& index_value,
+                               Readahead* readahead) const {
+  Cache* block_cache = rep_->options.block_cache;
   Block* block = NULL;
   Cache::Handle* cache_handle = NULL;
 
+  if (readahead != NULL && !options.fill_cache) {
+    // Bulk scans should neither pollute nor probe the block cache
+    block_cache = NULL;
+  }
+
   BlockHandle handle;
   Slice input = index_value;
   Status s = handle.DecodeFrom(&input);
@@ -107,27 +208,33 @@ Iterator* Table::BlockReader(void* arg,
   if (s.ok()) {
     if (block_cache != NULL) {
       char cache_key_buffer[16];
-      EncodeFixed64(cache_key_buffer, table->rep_->cache_id);
+      EncodeFixed64(cache_key_buffer, rep_->cache_id);
       EncodeFixed64(cache_key_buffer+8, handle.offset());
       Slice key(cache_key_buffer, sizeof(cache_key_buffer));
       cache_handle = block_cache->Lookup(key);
       if (cache_handle != NULL) {
         block = reinterpret_cast<Block*>(block_cache->Value(cache_handle));
       } else {
-        s = ReadBlock(table->rep_->file, options, handle, &block);
+        if (readahead != NULL) {
+          s = readahead->Read(options, handle, &block);
+        } else {
+          s = ReadBlock(rep_->file, options, handle, &block);
+        }
         if (s.ok() && options.fill_cache) {
           cache_handle = block_cache->Insert(
               key, block, block->size(), &DeleteCachedBlock);
         }
       }
+    } else if (readahead != NULL) {
+      s = readahead->Read(options, handle, &block);
     } else {
-      s = ReadBlock(table->rep_->file, options, handle, &block);
+      s = ReadBlock(rep_->file, options, handle, &block);
     }
   }
 
   Iterator* iter;
   if (block != NULL) {
-    iter = block->NewIterator(table->rep_->options.comparator);
+    iter = block->NewIterator(rep_->options.comparator);
     if (cache_handle == NULL) {
       iter->RegisterCleanup(&DeleteBlock, block, NULL);
     } else {
@@ -140,9 +247,41 @@ Iterator* Table::BlockReader(void* arg,
 }
 
 Iterator* Table::NewIterator(const ReadOptions& options) const {
-  return NewTwoLevelIterator(
-      rep_->index_block->NewIterator(rep_->options.comparator),
-      &Table::BlockReader, const_cast<Table*>(this), options);
+  Iterator* index_iter =
+      rep_->index_block->NewIterator(rep_->options.comparator);
+  if (options.readahead_size == 0) {
+    return NewTwoLevelIterator(index_iter, &Table::BlockReader,
+                               const_cast<Table*>(this), options);
+  }
+
+  Readahead* readahead = new Readahead(this, options.readahead_size);
+  Iterator* iter = NewTwoLevelIterator(index_iter,
+                                       &Table::ReadaheadBlockReader,
+                                       readahead, options);
+  iter->RegisterCleanup(&DeleteReadahead, readahead, NULL);
+  return iter;
+}
+
+Status Table::Prefetch(const ReadOptions& options) const {
+  // Data blocks are laid out contiguously before the metaindex block
+  Status s = rep_->file->Prefetch(0, rep_->metaindex_handle.offset());
+  if (!s.ok() || !options.fill_cache || rep_->options.block_cache == NULL) {
+    return s;
+  }
+
+  Iterator* index_iter =
+      rep_->index_block->NewIterator(rep_->options.comparator);
+  for (index_iter->SeekToFirst(); s.ok() && index_iter->Valid();
+       index_iter->Next()) {
+    Iterator* block_iter = BlockIterator(options, index_iter->value(), NULL);
+    s = block_iter->status();
+    delete block_iter;
+  }
+  if (s.ok()) {
+    s = index_iter->status();
+  }
+  delete index_iter;
+  return s;
 }
 
 uint64_t Table::ApproximateOffsetOf(const Slice& key) const {
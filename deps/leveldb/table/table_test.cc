@@ -110,15 +110,19 @@ class StringSink: public WritableFile {
 class StringSource: public RandomAccessFile {
  public:
   StringSource(const Slice& contents)
-      : contents_(contents.data(), contents.size()) {
+      : contents_(contents.data(), contents.size()), reads_(0) {
   }
 
   virtual ~StringSource() { }
 
   uint64_t Size() const { return contents_.size(); }
 
+  // Number of calls to Read() so far
+  int reads() const { return reads_; }
+
   virtual Status Read(uint64_t offset, size_t n, Slice* result,
                        char* scratch) const {
+    reads_++;
     if (offset > contents_.size()) {
       return Status::InvalidArgument("invalid Read offset");
     }
@@ -132,6 +136,7 @@ class StringSource: public RandomAccessFile {
 
  private:
   std::string contents_;
+  mutable int reads_;
 };
 
 typedef std::map<std::string, std::string, STLLessThan> KVMap;
@@ -259,6 +264,12 @@ class TableConstructor: public Constructor {
     return table_->NewIterator(ReadOptions());
   }
 
+  Iterator* NewIterator(const ReadOptions& options) const {
+    return table_->NewIterator(options);
+  }
+
+  int NumReads() const { return source_->reads(); }
+
   uint64_t ApproximateOffsetOf(const Slice& key) const {
     return table_->ApproximateOffsetOf(key);
   }
@@ -813,6 +824,68 @@ TEST(TableTest, ApproximateOffsetOfPlain) {
 
 }
 
+TEST(TableTest, Readahead) {
+  TableConstructor c(BytewiseComparator());
+  Random rnd(301);
+  for (int i = 0; i < 1000; i++) {
+    char key[20];
+    snprintf(key, sizeof(key), "k%05d", i);
+    std::string value;
+    c.Add(key, test::RandomString(&rnd, 100 + rnd.Uniform(200), &value));
+  }
+  std::vector<std::string> keys;
+  KVMap kvmap;
+  Options options;
+  options.block_size = 1024;
+  c.Finish(options, &keys, &kvmap);
+
+  const size_t kSizes[] = { 1, 4096, 256 * 1024 };
+  for (int i = 0; i < 3; i++) {
+    for (int fill = 0; fill < 2; fill++) {
+      ReadOptions read_options;
+      read_options.readahead_size = kSizes[i];
+      read_options.fill_cache = fill;
+      Iterator* iter = c.NewIterator(read_options);
+
+      // Forward scan
+      const int reads = c.NumReads();
+      KVMap::const_iterator model = kvmap.begin();
+      for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++model) {
+        ASSERT_TRUE(model != kvmap.end());
+        ASSERT_EQ(model->first, iter->key().ToString());
+        ASSERT_EQ(model->second, iter->value().ToString());
+      }
+      ASSERT_TRUE(model == kvmap.end());
+      ASSERT_OK(iter->status());
+      if (kSizes[i] == 256 * 1024) {
+        // The first block is read alone, the rest in one request
+        ASSERT_EQ(reads + 2, c.NumReads());
+      }
+
+      // Seek and continue forward
+      iter->Seek("k00500");
+      for (int k = 500; k < 1000; k++, iter->Next()) {
+        ASSERT_TRUE(iter->Valid());
+        ASSERT_EQ(keys[k], iter->key().ToString());
+        ASSERT_EQ(kvmap[keys[k]], iter->value().ToString());
+      }
+      ASSERT_TRUE(!iter->Valid());
+
+      // Reverse scan
+      model = kvmap.end();
+      for (iter->SeekToLast(); iter->Valid(); iter->Prev()) {
+        ASSERT_TRUE(model != kvmap.begin());
+        --model;
+        ASSERT_EQ(model->first, iter->key().ToString());
+        ASSERT_EQ(model->second, iter->value().ToString());
+      }
+      ASSERT_TRUE(model == kvmap.begin());
+      ASSERT_OK(iter->status());
+      delete iter;
+    }
+  }
+}
+
 static bool SnappyCompressionSupported() {
   std::string out;
   Slice in = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa";
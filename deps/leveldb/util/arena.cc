@@ -4,12 +4,30 @@
 
 #include "util/arena.h"
 #include <assert.h>
+#include "util/mutexlock.h"
 
 namespace leveldb {
 
 static const int kBlockSize = 4096;
+static const size_t kHugePageSize = 2 << 20;
 
-Arena::Arena() {
+Arena::Arena()
+    : block_size_(kBlockSize),
+      next_block_size_(kBlockSize),
+      huge_pages_(false) {
+  blocks_memory_ = 0;
+  alloc_ptr_ = NULL;  // First allocation will allocate a block
+  alloc_bytes_remaining_ = 0;
+}
+
+Arena::Arena(size_t block_size, bool huge_pages)
+    : block_size_(block_size < kBlockSize ? kBlockSize : block_size),
+      next_block_size_(kBlockSize),
+      huge_pages_(huge_pages) {
+  if (huge_pages_) {
+    block_size_ = ((block_size_ + kHugePageSize - 1) / kHugePageSize) *
+        kHugePageSize;
+  }
   blocks_memory_ = 0;
   alloc_ptr_ = NULL;  // First allocation will allocate a block
   alloc_bytes_remaining_ = 0;
@@ -19,19 +37,34 @@ Arena::~Arena() {
   for (size_t i = 0; i < blocks_.size(); i++) {
     delete[] blocks_[i];
   }
+  for (size_t i = 0; i < huge_blocks_.size(); i++) {
+    port::FreeHugePages(huge_blocks_[i].first, huge_blocks_[i].second);
+  }
 }
 
 char* Arena::AllocateFallback(size_t bytes) {
-  if (bytes > kBlockSize / 4) {
+  if (bytes > block_size_ / 4) {
     // Object is more than a quarter of our block size.  Allocate it separately
     // to avoid wasting too much space in leftover bytes.
     char* result = AllocateNewBlock(bytes);
     return result;
   }
 
+  // Pick the next size class, large enough that the object uses at most
+  // a quarter of the block.
+  size_t block_bytes = next_block_size_;
+  while (block_bytes < bytes * 4) {
+    block_bytes *= 2;
+  }
+  if (block_bytes > block_size_) {
+    block_bytes = block_size_;
+  }
+  next_block_size_ = block_bytes < block_size_ / 2 ? block_bytes * 2
+                                                   : block_size_;
+
   // We waste the remaining space in the current block.
-  alloc_ptr_ = AllocateNewBlock(kBlockSize);
-  alloc_bytes_remaining_ = kBlockSize;
+  alloc_ptr_ = AllocateNewBlock(block_bytes);
+  alloc_bytes_remaining_ = block_bytes;
 
   char* result = alloc_ptr_;
   alloc_ptr_ += bytes;
@@ -58,7 +91,26 @@ char* Arena::AllocateAligned(size_t bytes) {
   return result;
 }
 
+char* Arena::AllocateConcurrently(size_t bytes) {
+  MutexLock l(&mu_);
+  return Allocate(bytes);
+}
+
+char* Arena::AllocateAlignedConcurrently(size_t bytes) {
+  MutexLock l(&mu_);
+  return AllocateAligned(bytes);
+}
+
 char* Arena::AllocateNewBlock(size_t block_bytes) {
+  if (huge_pages_ && block_bytes == block_size_) {
+    char* result = port::AllocateHugePages(block_bytes);
+    if (result != NULL) {
+      blocks_memory_ += block_bytes;
+      huge_blocks_.push_back(std::make_pair(result, block_bytes));
+      return result;
+    }
+    // Fall back to ordinary memory
+  }
   char* result = new char[block_bytes];
   blocks_memory_ += block_bytes;
   blocks_.push_back(result);
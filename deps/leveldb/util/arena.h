@@ -9,12 +9,22 @@
 #include <vector>
 #include <assert.h>
 #include <stdint.h>
+#include "port/port.h"
 
 namespace leveldb {
 
 class Arena {
  public:
   Arena();
+
+  // Create an arena whose blocks grow up to "block_size" bytes.  Blocks
+  // start small and double in size, so a lightly used arena stays small.
+  // Requests larger than a quarter of block_size get a block of their
+  // own.  If huge_pages is true, block_size is rounded up to a multiple
+  // of the huge page size and full sized blocks are backed by huge pages
+  // where the platform provides them.
+  Arena(size_t block_size, bool huge_pages);
+
   ~Arena();
 
   // Return a pointer to a newly allocated memory block of "bytes" bytes.
@@ -23,11 +33,18 @@ class Arena {
   // Allocate memory with the normal alignment guarantees provided by malloc
   char* AllocateAligned(size_t bytes);
 
+  // Variants of Allocate() and AllocateAligned() that may be called from
+  // several threads at once.  They must not be mixed with concurrent
+  // calls to the unsynchronized variants above.
+  char* AllocateConcurrently(size_t bytes);
+  char* AllocateAlignedConcurrently(size_t bytes);
+
   // Returns an estimate of the total memory usage of data allocated
   // by the arena (including space allocated but not yet used for user
   // allocations).
   size_t MemoryUsage() const {
-    return blocks_memory_ + blocks_.capacity() * sizeof(char*);
+    return blocks_memory_ + blocks_.capacity() * sizeof(char*) +
+        huge_blocks_.capacity() * sizeof(huge_blocks_[0]);
   }
 
  private:
@@ -38,12 +55,23 @@ class Arena {
   char* alloc_ptr_;
   size_t alloc_bytes_remaining_;
 
+  // Maximum size of a regular block, and the size of the next one
+  size_t block_size_;
+  size_t next_block_size_;
+  bool huge_pages_;
+
   // Array of new[] allocated memory blocks
   std::vector<char*> blocks_;
 
+  // Blocks obtained from port::AllocateHugePages(), with their sizes
+  std::vector<std::pair<char*, size_t> > huge_blocks_;
+
   // Bytes of memory in blocks allocated so far
   size_t blocks_memory_;
 
+  // Serializes the *Concurrently() allocation variants
+  port::Mutex mu_;
+
   // No copying allowed
   Arena(const Arena&);
   void operator=(const Arena&);
@@ -4,6 +4,7 @@
 
 #include "util/arena.h"
 
+#include <string.h>
 #include "util/random.h"
 #include "util/testharness.h"
 
@@ -61,6 +62,48 @@ TEST(ArenaTest, Simple) {
   }
 }
 
+static void TestLargeBlocks(bool huge_pages) {
+  Arena arena(1 << 20, huge_pages);
+  const size_t kValueSize = 4096;
+  const int N = 4096;
+  std::vector<char*> allocated;
+  size_t bytes = 0;
+  for (int i = 0; i < N; i++) {
+    char* r = (i % 2) ? arena.AllocateAligned(kValueSize)
+                      : arena.Allocate(kValueSize);
+    memset(r, i % 256, kValueSize);
+    bytes += kValueSize;
+    allocated.push_back(r);
+    ASSERT_GE(arena.MemoryUsage(), bytes);
+  }
+  // 4K values share the large blocks rather than getting blocks of their
+  // own, and the growing block sizes waste little on the way up: beyond
+  // the data itself there is at most one partly used (huge page) block.
+  ASSERT_LE(arena.MemoryUsage(), bytes + (2 << 20) + 4096);
+
+  // Objects too large for a block still get an allocation of their own
+  const size_t kLargeSize = 1 << 20;
+  char* large = arena.Allocate(kLargeSize);
+  memset(large, 0xff, kLargeSize);
+  bytes += kLargeSize;
+  ASSERT_GE(arena.MemoryUsage(), bytes);
+
+  for (int i = 0; i < N; i++) {
+    for (size_t b = 0; b < kValueSize; b++) {
+      ASSERT_EQ(int(allocated[i][b]) & 0xff, i % 256);
+    }
+  }
+}
+
+TEST(ArenaTest, LargeBlocks) {
+  TestLargeBlocks(false);
+}
+
+TEST(ArenaTest, HugePages) {
+  // Falls back to ordinary memory if huge pages are unavailable
+  TestLargeBlocks(true);
+}
+
 }  // namespace leveldb
 
 int main(int argc, char** argv) {
@@ -0,0 +1,53 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "leveldb/compaction_filter.h"
+
+#include "leveldb/env.h"
+#include "leveldb/slice.h"
+
+namespace leveldb {
+
+CompactionFilter::~CompactionFilter() { }
+
+namespace {
+class TTLFilter : public CompactionFilter {
+ public:
+  TTLFilter(Env* env, uint32_t ttl_seconds, bool timestamp_prefix)
+      : env_(env),
+        ttl_seconds_(ttl_seconds),
+        timestamp_prefix_(timestamp_prefix) {
+  }
+
+  virtual bool Filter(const Slice& key, const Slice& value) const {
+    if (value.size() < 4) {
+      return false;
+    }
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(
+        timestamp_prefix_ ? value.data() : value.data() + value.size() - 4);
+    const uint64_t timestamp =
+        (static_cast<uint32_t>(p[0]) << 24) |
+        (static_cast<uint32_t>(p[1]) << 16) |
+        (static_cast<uint32_t>(p[2]) << 8) |
+        (static_cast<uint32_t>(p[3]));
+    return timestamp + ttl_seconds_ <= env_->NowMicros() / 1000000;
+  }
+
+  virtual const char* Name() const {
+    return "leveldb.TTLFilter";
+  }
+
+ private:
+  Env* const env_;
+  const uint64_t ttl_seconds_;
+  const bool timestamp_prefix_;
+};
+}  // namespace
+
+CompactionFilter* NewTTLFilter(Env* env, uint32_t ttl_seconds,
+                               bool timestamp_prefix) {
+  return new TTLFilter(env, ttl_seconds, timestamp_prefix);
+}
+
+}  // namespace leveldb
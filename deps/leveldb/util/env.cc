@@ -9,12 +9,26 @@ namespace leveldb {
 Env::~Env() {
 }
 
+Status Env::NewAppendableFile(const std::string& fname,
+                              WritableFile** result) {
+  *result = NULL;
+  return Status::NotSupported("NewAppendableFile", fname);
+}
+
+Status Env::LinkFile(const std::string& src, const std::string& target) {
+  return Status::NotSupported("LinkFile", src);
+}
+
 SequentialFile::~SequentialFile() {
 }
 
 RandomAccessFile::~RandomAccessFile() {
 }
 
+Status RandomAccessFile::Prefetch(uint64_t offset, size_t n) const {
+  return Status::OK();
+}
+
 WritableFile::~WritableFile() {
 }
 
@@ -87,6 +87,18 @@ class PosixRandomAccessFile: public RandomAccessFile {
     }
     return s;
   }
+
+  virtual Status Prefetch(uint64_t offset, size_t n) const {
+    Status s;
+#if defined(POSIX_FADV_WILLNEED)
+    int r = posix_fadvise(fd_, static_cast<off_t>(offset),
+                          static_cast<off_t>(n), POSIX_FADV_WILLNEED);
+    if (r != 0) {
+      s = IOError(filename_, r);
+    }
+#endif
+    return s;
+  }
 };
 
 // We preallocate up to an extra megabyte and use memcpy to append new
@@ -259,6 +271,61 @@ class PosixMmapFile : public WritableFile {
   }
 };
 
+// Appends with write(2), for the occasional append to an existing file
+class PosixAppendableFile : public WritableFile {
+ private:
+  std::string filename_;
+  int fd_;
+
+ public:
+  PosixAppendableFile(const std::string& fname, int fd)
+      : filename_(fname), fd_(fd) { }
+
+  ~PosixAppendableFile() {
+    if (fd_ >= 0) {
+      PosixAppendableFile::Close();
+    }
+  }
+
+  virtual Status Append(const Slice& data) {
+    const char* src = data.data();
+    size_t left = data.size();
+    while (left > 0) {
+      ssize_t n = write(fd_, src, left);
+      if (n < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return IOError(filename_, errno);
+      }
+      src += n;
+      left -= n;
+    }
+    return Status::OK();
+  }
+
+  virtual Status Close() {
+    Status s;
+    if (close(fd_) < 0) {
+      s = IOError(filename_, errno);
+    }
+    fd_ = -1;
+    return s;
+  }
+
+  virtual Status Flush() {
+    return Status::OK();
+  }
+
+  virtual Status Sync() {
+    Status s;
+    if (fdatasync(fd_) < 0) {
+      s = IOError(filename_, errno);
+    }
+    return s;
+  }
+};
+
 static int LockOrUnlock(int fd, bool lock) {
   errno = 0;
   struct flock f;
@@ -319,6 +386,19 @@ class PosixEnv : public Env {
     return s;
   }
 
+  virtual Status NewAppendableFile(const std::string& fname,
+                                   WritableFile** result) {
+    Status s;
+    const int fd = open(fname.c_str(), O_WRONLY | O_APPEND);
+    if (fd < 0) {
+      *result = NULL;
+      s = IOError(fname, errno);
+    } else {
+      *result = new PosixAppendableFile(fname, fd);
+    }
+    return s;
+  }
+
   virtual bool FileExists(const std::string& fname) {
     return access(fname.c_str(), F_OK) == 0;
   }
@@ -382,6 +462,14 @@ class PosixEnv : public Env {
     return result;
   }
 
+  virtual Status LinkFile(const std::string& src, const std::string& target) {
+    Status result;
+    if (link(src.c_str(), target.c_str()) != 0) {
+      result = IOError(src, errno);
+    }
+    return result;
+  }
+
   virtual Status LockFile(const std::string& fname, FileLock** lock) {
     *lock = NULL;
     Status result;
@@ -0,0 +1,96 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "leveldb/merge_operator.h"
+
+#include <stdint.h>
+#include "leveldb/slice.h"
+#include "util/logging.h"
+
+namespace leveldb {
+
+MergeOperator::~MergeOperator() { }
+
+namespace {
+// Parse a whole slice as a decimal number
+static bool ParseNumber(const Slice& s, uint64_t* val) {
+  Slice in = s;
+  return !in.empty() && ConsumeDecimalNumber(&in, val) && in.empty();
+}
+
+class UInt64AddOperatorImpl : public MergeOperator {
+ public:
+  virtual bool Merge(const Slice& key, const Slice* existing_value,
+                     const Slice& value, std::string* new_value) const {
+    uint64_t base = 0, delta;
+    if ((existing_value != NULL && !ParseNumber(*existing_value, &base)) ||
+        !ParseNumber(value, &delta)) {
+      return false;
+    }
+    new_value->clear();
+    AppendNumberTo(new_value, base + delta);
+    return true;
+  }
+
+  virtual const char* Name() const {
+    return "leveldb.UInt64AddOperator";
+  }
+};
+
+class UInt64MaxOperatorImpl : public MergeOperator {
+ public:
+  virtual bool Merge(const Slice& key, const Slice* existing_value,
+                     const Slice& value, std::string* new_value) const {
+    uint64_t base = 0, v;
+    if ((existing_value != NULL && !ParseNumber(*existing_value, &base)) ||
+        !ParseNumber(value, &v)) {
+      return false;
+    }
+    new_value->clear();
+    AppendNumberTo(new_value, (existing_value == NULL || v > base) ? v : base);
+    return true;
+  }
+
+  virtual const char* Name() const {
+    return "leveldb.UInt64MaxOperator";
+  }
+};
+
+class AppendOperatorImpl : public MergeOperator {
+ public:
+  virtual bool Merge(const Slice& key, const Slice* existing_value,
+                     const Slice& value, std::string* new_value) const {
+    new_value->clear();
+    if (existing_value != NULL) {
+      new_value->assign(existing_value->data(), existing_value->size());
+    }
+    new_value->append(value.data(), value.size());
+    return true;
+  }
+
+  virtual const char* Name() const {
+    return "leveldb.AppendOperator";
+  }
+};
+}  // namespace
+
+// Intentionally not destroyed to prevent destructor racing
+// with background threads.
+static const MergeOperator* uint64_add = new UInt64AddOperatorImpl;
+static const MergeOperator* uint64_max = new UInt64MaxOperatorImpl;
+static const MergeOperator* append = new AppendOperatorImpl;
+
+const MergeOperator* UInt64AddOperator() {
+  return uint64_add;
+}
+
+const MergeOperator* UInt64MaxOperator() {
+  return uint64_max;
+}
+
+const MergeOperator* AppendOperator() {
+  return append;
+}
+
+}  // namespace leveldb
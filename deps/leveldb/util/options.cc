@@ -11,12 +11,23 @@ namespace leveldb {
 
 Options::Options()
     : comparator(BytewiseComparator()),
+      merge_operator(NULL),
+      compaction_filter(NULL),
+      compaction_filter_on_read(false),
       create_if_missing(false),
       error_if_exists(false),
       paranoid_checks(false),
+      read_only(false),
       env(Env::Default()),
       info_log(NULL),
+      log_retention_bytes(0),
       write_buffer_size(4<<20),
+      allow_concurrent_memtable_write(false),
+      arena_block_size(4096),
+      memtable_huge_pages(false),
+      max_immutable_memtables(1),
+      max_immutable_memtable_bytes(0),
+      max_subcompactions(1),
       max_open_files(1000),
       block_cache(NULL),
       block_size(4096),
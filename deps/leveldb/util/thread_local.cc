@@ -0,0 +1,171 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "util/thread_local.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "util/mutexlock.h"
+
+namespace leveldb {
+
+static void PthreadCall(const char* label, int result) {
+  if (result != 0) {
+    fprintf(stderr, "pthread %s: %s\n", label, strerror(result));
+    abort();
+  }
+}
+
+// The values of one thread for every ThreadLocalPtr, indexed by id.
+// Only the owning thread grows "values", and only while holding the
+// registry mutex, so the owner may read it without locking.
+struct ThreadData {
+  port::AtomicPointer* values;
+  uint32_t size;
+  ThreadData* prev;
+  ThreadData* next;
+};
+
+struct ThreadLocalRegistry {
+  port::Mutex mu;
+  pthread_key_t key;
+  ThreadData head;                          // Dummy head of a circular list
+  std::vector<ThreadLocalPtr*> instances;   // Indexed by id, NULL if free
+
+  ThreadLocalRegistry() {
+    head.values = NULL;
+    head.size = 0;
+    head.prev = &head;
+    head.next = &head;
+    PthreadCall("key_create", pthread_key_create(&key, &OnThreadExit));
+  }
+
+  uint32_t Register(ThreadLocalPtr* p) {
+    MutexLock l(&mu);
+    for (uint32_t id = 0; id < instances.size(); id++) {
+      if (instances[id] == NULL) {
+        instances[id] = p;
+        return id;
+      }
+    }
+    instances.push_back(p);
+    return instances.size() - 1;
+  }
+
+  // Make sure the calling thread has room for the value of "id".
+  ThreadData* Grow(ThreadData* t, uint32_t id) {
+    MutexLock l(&mu);
+    if (t == NULL) {
+      t = new ThreadData;
+      t->values = NULL;
+      t->size = 0;
+      t->next = &head;
+      t->prev = head.prev;
+      t->prev->next = t;
+      head.prev = t;
+      PthreadCall("setspecific", pthread_setspecific(key, t));
+    }
+    uint32_t size = instances.size();
+    if (size <= id) size = id + 1;
+    port::AtomicPointer* values = new port::AtomicPointer[size];
+    for (uint32_t i = 0; i < size; i++) {
+      values[i].NoBarrier_Store(i < t->size ? t->values[i].Acquire_Load()
+                                            : NULL);
+    }
+    delete[] t->values;
+    t->values = values;
+    t->size = size;
+    return t;
+  }
+
+  static void OnThreadExit(void* arg);
+};
+
+static pthread_once_t registry_once = PTHREAD_ONCE_INIT;
+static ThreadLocalRegistry* registry = NULL;
+static void InitRegistry() { registry = new ThreadLocalRegistry; }
+
+static ThreadLocalRegistry* Registry() {
+  PthreadCall("once", pthread_once(&registry_once, InitRegistry));
+  return registry;
+}
+
+void ThreadLocalRegistry::OnThreadExit(void* arg) {
+  ThreadLocalRegistry* r = Registry();
+  ThreadData* t = reinterpret_cast<ThreadData*>(arg);
+  {
+    MutexLock l(&r->mu);
+    t->prev->next = t->next;
+    t->next->prev = t->prev;
+    // Hand the values over to their instances; Scrape() collects them.
+    for (uint32_t id = 0; id < t->size; id++) {
+      void* v = t->values[id].Acquire_Load();
+      if (v != NULL && r->instances[id] != NULL) {
+        r->instances[id]->orphans_.push_back(v);
+      }
+    }
+  }
+  delete[] t->values;
+  delete t;
+}
+
+ThreadLocalPtr::ThreadLocalPtr()
+    : id_(Registry()->Register(this)) {
+}
+
+ThreadLocalPtr::~ThreadLocalPtr() {
+  ThreadLocalRegistry* r = Registry();
+  MutexLock l(&r->mu);
+  for (ThreadData* t = r->head.next; t != &r->head; t = t->next) {
+    if (id_ < t->size) {
+      t->values[id_].Release_Store(NULL);
+    }
+  }
+  r->instances[id_] = NULL;
+}
+
+port::AtomicPointer* ThreadLocalPtr::Slot() {
+  ThreadLocalRegistry* r = Registry();
+  ThreadData* t = reinterpret_cast<ThreadData*>(pthread_getspecific(r->key));
+  if (t == NULL || id_ >= t->size) {
+    t = r->Grow(t, id_);
+  }
+  return &t->values[id_];
+}
+
+static void* SwapValue(port::AtomicPointer* slot, void* ptr) {
+  while (true) {
+    void* old = slot->Acquire_Load();
+    if (slot->CompareAndSwap(old, ptr)) {
+      return old;
+    }
+  }
+}
+
+void* ThreadLocalPtr::Swap(void* ptr) {
+  return SwapValue(Slot(), ptr);
+}
+
+bool ThreadLocalPtr::CompareAndSwap(void* expected, void* ptr) {
+  return Slot()->CompareAndSwap(expected, ptr);
+}
+
+void ThreadLocalPtr::Scrape(std::vector<void*>* ptrs, void* replacement) {
+  ThreadLocalRegistry* r = Registry();
+  MutexLock l(&r->mu);
+  for (ThreadData* t = r->head.next; t != &r->head; t = t->next) {
+    if (id_ < t->size) {
+      void* v = SwapValue(&t->values[id_], replacement);
+      if (v != NULL) {
+        ptrs->push_back(v);
+      }
+    }
+  }
+  ptrs->insert(ptrs->end(), orphans_.begin(), orphans_.end());
+  orphans_.clear();
+}
+
+}  // namespace leveldb
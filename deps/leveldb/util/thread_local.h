@@ -0,0 +1,57 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// ThreadLocalPtr holds one pointer per thread for each instance.  Unlike
+// a plain thread-local variable, the owner of an instance can visit and
+// replace the values of every thread with Scrape().  DBImpl uses this to
+// let each reader cache a referenced read view, and to take those
+// references back when the view changes.
+
+#ifndef STORAGE_LEVELDB_UTIL_THREAD_LOCAL_H_
+#define STORAGE_LEVELDB_UTIL_THREAD_LOCAL_H_
+
+#include <stdint.h>
+#include <vector>
+#include "port/port.h"
+
+namespace leveldb {
+
+class ThreadLocalPtr {
+ public:
+  // Every thread starts out with a NULL value.
+  ThreadLocalPtr();
+
+  // REQUIRES: Scrape() has already collected every non-NULL value.
+  ~ThreadLocalPtr();
+
+  // Set the calling thread's value to "ptr" and return the old value.
+  void* Swap(void* ptr);
+
+  // If the calling thread's value is "expected", set it to "ptr" and
+  // return true.  Else return false.
+  bool CompareAndSwap(void* expected, void* ptr);
+
+  // Set every thread's value to "replacement" and append the non-NULL
+  // values it replaces to *ptrs.  The values of threads that have
+  // exited since the last call are appended too.
+  void Scrape(std::vector<void*>* ptrs, void* replacement);
+
+ private:
+  friend struct ThreadLocalRegistry;
+
+  port::AtomicPointer* Slot();
+
+  const uint32_t id_;
+
+  // Values of exited threads.  Protected by the registry mutex.
+  std::vector<void*> orphans_;
+
+  // No copying allowed
+  ThreadLocalPtr(const ThreadLocalPtr&);
+  void operator=(const ThreadLocalPtr&);
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_UTIL_THREAD_LOCAL_H_
@@ -0,0 +1,136 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "util/thread_local.h"
+
+#include <algorithm>
+#include "leveldb/env.h"
+#include "port/port.h"
+#include "util/testharness.h"
+
+namespace leveldb {
+
+class ThreadLocalTest { };
+
+static char a, b, c;
+
+TEST(ThreadLocalTest, SwapAndCompareAndSwap) {
+  ThreadLocalPtr tls;
+  ASSERT_TRUE(tls.Swap(&a) == NULL);
+  ASSERT_TRUE(tls.Swap(&b) == &a);
+  ASSERT_TRUE(!tls.CompareAndSwap(&a, &c));
+  ASSERT_TRUE(tls.CompareAndSwap(&b, &c));
+  ASSERT_TRUE(tls.Swap(NULL) == &c);
+}
+
+TEST(ThreadLocalTest, Independent) {
+  ThreadLocalPtr tls1;
+  ThreadLocalPtr tls2;
+  tls1.Swap(&a);
+  tls2.Swap(&b);
+  ASSERT_TRUE(tls1.Swap(NULL) == &a);
+  ASSERT_TRUE(tls2.Swap(NULL) == &b);
+
+  // A new instance does not see values left by an old one with the same id
+  ThreadLocalPtr* tls3 = new ThreadLocalPtr;
+  tls3->Swap(&c);
+  std::vector<void*> values;
+  tls3->Scrape(&values, NULL);
+  delete tls3;
+  ThreadLocalPtr tls4;
+  ASSERT_TRUE(tls4.Swap(NULL) == NULL);
+}
+
+namespace {
+struct ThreadState {
+  ThreadLocalPtr* tls;
+  void* value;
+  port::AtomicPointer stored;     // Set once value has been stored
+  port::AtomicPointer scraped;    // Set once the owner has scraped
+  port::AtomicPointer seen;       // What the thread found after scraping
+  port::AtomicPointer done;
+};
+
+static void StoreAndWait(void* arg) {
+  ThreadState* s = reinterpret_cast<ThreadState*>(arg);
+  s->tls->Swap(s->value);
+  s->stored.Release_Store(s);
+  while (s->scraped.Acquire_Load() == NULL) {
+    Env::Default()->SleepForMicroseconds(1000);
+  }
+  s->seen.Release_Store(s->tls->Swap(NULL));
+  s->done.Release_Store(s);
+}
+
+static void StoreAndExit(void* arg) {
+  ThreadState* s = reinterpret_cast<ThreadState*>(arg);
+  s->tls->Swap(s->value);
+  s->done.Release_Store(s);
+}
+
+static void InitState(ThreadState* s, ThreadLocalPtr* tls, void* value) {
+  s->tls = tls;
+  s->value = value;
+  s->stored.Release_Store(NULL);
+  s->scraped.Release_Store(NULL);
+  s->seen.Release_Store(NULL);
+  s->done.Release_Store(NULL);
+}
+}  // namespace
+
+TEST(ThreadLocalTest, Scrape) {
+  ThreadLocalPtr tls;
+  ThreadState s1, s2;
+  InitState(&s1, &tls, &a);
+  InitState(&s2, &tls, &b);
+  Env::Default()->StartThread(&StoreAndWait, &s1);
+  Env::Default()->StartThread(&StoreAndWait, &s2);
+  while (s1.stored.Acquire_Load() == NULL ||
+         s2.stored.Acquire_Load() == NULL) {
+    Env::Default()->SleepForMicroseconds(1000);
+  }
+  tls.Swap(&c);
+
+  std::vector<void*> values;
+  tls.Scrape(&values, &c);
+  ASSERT_EQ(3, values.size());
+  ASSERT_TRUE(std::find(values.begin(), values.end(), &a) != values.end());
+  ASSERT_TRUE(std::find(values.begin(), values.end(), &b) != values.end());
+  ASSERT_TRUE(std::find(values.begin(), values.end(), &c) != values.end());
+
+  // Every thread now holds the replacement
+  s1.scraped.Release_Store(&s1);
+  s2.scraped.Release_Store(&s2);
+  while (s1.done.Acquire_Load() == NULL || s2.done.Acquire_Load() == NULL) {
+    Env::Default()->SleepForMicroseconds(1000);
+  }
+  ASSERT_TRUE(s1.seen.Acquire_Load() == &c);
+  ASSERT_TRUE(s2.seen.Acquire_Load() == &c);
+  ASSERT_TRUE(tls.Swap(NULL) == &c);
+}
+
+TEST(ThreadLocalTest, ValuesOfExitedThreads) {
+  ThreadLocalPtr tls;
+  ThreadState s;
+  InitState(&s, &tls, &a);
+  Env::Default()->StartThread(&StoreAndExit, &s);
+  while (s.done.Acquire_Load() == NULL) {
+    Env::Default()->SleepForMicroseconds(1000);
+  }
+
+  // The value is collected whether or not the thread has exited yet
+  std::vector<void*> values;
+  for (int i = 0; i < 1000 && values.empty(); i++) {
+    tls.Scrape(&values, NULL);
+    Env::Default()->SleepForMicroseconds(1000);
+  }
+  ASSERT_EQ(1, values.size());
+  ASSERT_TRUE(values[0] == &a);
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  return leveldb::test::RunAllTests();
+}
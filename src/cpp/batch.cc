@@ -1,5 +1,6 @@
 #include <vector>
 
+#include <db/write_batch_internal.h>
 #include <leveldb/write_batch.h>
 #include <node.h>
 #include <node_buffer.h>
@@ -20,9 +21,6 @@ JBatch::~JBatch() {
 }
 
 void JBatch::Clear() {
-  std::vector< Persistent<Value> >::iterator it;
-  for (it = buffers_.begin(); it < buffers_.end(); ++it) it->Dispose();
-  buffers_.clear();
   wb_.Clear();
 }
 
@@ -35,8 +33,13 @@ void JBatch::Initialize(Handle<Object> target) {
   constructor->SetClassName(String::NewSymbol("Batch"));
 
   NODE_SET_PROTOTYPE_METHOD(constructor, "put", Put);
+  NODE_SET_PROTOTYPE_METHOD(constructor, "putMany", PutMany);
   NODE_SET_PROTOTYPE_METHOD(constructor, "del", Del);
+  NODE_SET_PROTOTYPE_METHOD(constructor, "delRange", DelRange);
+  NODE_SET_PROTOTYPE_METHOD(constructor, "merge", Merge);
   NODE_SET_PROTOTYPE_METHOD(constructor, "clear", Clear);
+  NODE_SET_PROTOTYPE_METHOD(constructor, "toBuffer", ToBuffer);
+  NODE_SET_PROTOTYPE_METHOD(constructor, "setContents", SetContents);
 
   target->Set(String::NewSymbol("Batch"), constructor->GetFunction());
 }
@@ -54,33 +57,120 @@ Handle<Value> JBatch::Put(const Arguments& args) {
   HandleScope scope;
 
   if (args.Length() != 2 ||
-      !Buffer::HasInstance(args[0]) || !Buffer::HasInstance(args[1]))
+      !IsStringOrBuffer(args[0]) || !IsStringOrBuffer(args[1]))
     return ThrowTypeError("Invalid arguments");
 
   JBatch* self = ObjectWrap::Unwrap<JBatch>(args.This());
 
-  leveldb::Slice key = ToSlice(args[0], self->buffers_);
-  leveldb::Slice val = ToSlice(args[1], self->buffers_);
+  ValueSlice key(args[0]);
+  ValueSlice val(args[1]);
 
   self->wb_.Put(key, val);
 
   return Undefined();
 }
 
+// Record i of "data" has its key in [offsets[2i], offsets[2i+1]) and its
+// value in [offsets[2i+1], offsets[2i+2]).  The offsets are either a
+// Uint32Array, which is read in place, or an array of numbers.
+Handle<Value> JBatch::PutMany(const Arguments& args) {
+  HandleScope scope;
+
+  if (args.Length() != 2 || !Buffer::HasInstance(args[0]) ||
+      !args[1]->IsObject())
+    return ThrowTypeError("Invalid arguments");
+
+  JBatch* self = ObjectWrap::Unwrap<JBatch>(args.This());
+
+  Local<Object> data = args[0]->ToObject();
+  const char* base = Buffer::Data(data);
+  const size_t size = Buffer::Length(data);
+
+  std::vector<uint32_t> copy;
+  const uint32_t* offsets;
+  size_t len;
+
+  Local<Object> obj = args[1]->ToObject();
+  if (obj->HasIndexedPropertiesInExternalArrayData() &&
+      obj->GetIndexedPropertiesExternalArrayDataType() ==
+        kExternalUnsignedIntArray) {
+    offsets = static_cast<const uint32_t*>(
+      obj->GetIndexedPropertiesExternalArrayData());
+    len = obj->GetIndexedPropertiesExternalArrayDataLength();
+  } else if (args[1]->IsArray()) {
+    Local<Array> array(Array::Cast(*args[1]));
+    len = array->Length();
+    copy.resize(len);
+    for (size_t i = 0; i < len; ++i) copy[i] = array->Get(i)->Uint32Value();
+    offsets = len > 0 ? &copy[0] : NULL;
+  } else {
+    return ThrowTypeError("Invalid arguments");
+  }
+
+  // Check every record before adding any
+  if (len % 2 != 1) return ThrowTypeError("Invalid offsets");
+  for (size_t i = 1; i < len; ++i) {
+    if (offsets[i] < offsets[i - 1]) return ThrowTypeError("Invalid offsets");
+  }
+  if (offsets[len - 1] > size) return ThrowTypeError("Invalid offsets");
+
+  for (size_t i = 0; i + 2 < len; i += 2) {
+    leveldb::Slice key(base + offsets[i], offsets[i + 1] - offsets[i]);
+    leveldb::Slice val(base + offsets[i + 1], offsets[i + 2] - offsets[i + 1]);
+    self->wb_.Put(key, val);
+  }
+
+  return Undefined();
+}
+
 Handle<Value> JBatch::Del(const Arguments& args) {
   HandleScope scope;
 
-  if (args.Length() != 1 || !Buffer::HasInstance(args[0]))
+  if (args.Length() != 1 || !IsStringOrBuffer(args[0]))
     return ThrowTypeError("Invalid arguments");
 
   JBatch* self = ObjectWrap::Unwrap<JBatch>(args.This());
 
-  leveldb::Slice key = ToSlice(args[0], self->buffers_);
+  ValueSlice key(args[0]);
   self->wb_.Delete(key);
 
   return Undefined();
 }
 
+Handle<Value> JBatch::DelRange(const Arguments& args) {
+  HandleScope scope;
+
+  if (args.Length() != 2 ||
+      !IsStringOrBuffer(args[0]) || !IsStringOrBuffer(args[1]))
+    return ThrowTypeError("Invalid arguments");
+
+  JBatch* self = ObjectWrap::Unwrap<JBatch>(args.This());
+
+  ValueSlice start(args[0]);
+  ValueSlice limit(args[1]);
+
+  self->wb_.DeleteRange(start, limit);
+
+  return Undefined();
+}
+
+Handle<Value> JBatch::Merge(const Arguments& args) {
+  HandleScope scope;
+
+  if (args.Length() != 2 ||
+      !IsStringOrBuffer(args[0]) || !IsStringOrBuffer(args[1]))
+    return ThrowTypeError("Invalid arguments");
+
+  JBatch* self = ObjectWrap::Unwrap<JBatch>(args.This());
+
+  ValueSlice key(args[0]);
+  ValueSlice val(args[1]);
+
+  self->wb_.Merge(key, val);
+
+  return Undefined();
+}
+
 Handle<Value> JBatch::Clear(const Arguments& args) {
   HandleScope scope;
 
@@ -91,4 +181,51 @@ Handle<Value> JBatch::Clear(const Arguments& args) {
   return Undefined();
 }
 
+// The serialized batch, as logged and as returned by db.updatesSince()
+Handle<Value> JBatch::ToBuffer(const Arguments& args) {
+  HandleScope scope;
+
+  JBatch* self = ObjectWrap::Unwrap<JBatch>(args.This());
+
+  leveldb::Slice contents = leveldb::WriteBatchInternal::Contents(&self->wb_);
+  Buffer* buf = Buffer::New(contents.data(), contents.size());
+
+  return scope.Close(buf->handle_);
+}
+
+// Accepts every operation, so that Iterate() only checks the format
+class NoopHandler : public leveldb::WriteBatch::Handler {
+ public:
+  virtual void Put(const leveldb::Slice& key, const leveldb::Slice& value) {}
+  virtual void Delete(const leveldb::Slice& key) {}
+};
+
+// Replace the operations with those of a serialized batch.  It is checked
+// first, since a malformed batch would only fail once it has been logged.
+Handle<Value> JBatch::SetContents(const Arguments& args) {
+  HandleScope scope;
+
+  if (args.Length() != 1 || !Buffer::HasInstance(args[0]))
+    return ThrowTypeError("Invalid arguments");
+
+  JBatch* self = ObjectWrap::Unwrap<JBatch>(args.This());
+
+  Local<Object> buf = args[0]->ToObject();
+  leveldb::Slice contents(Buffer::Data(buf), Buffer::Length(buf));
+
+  leveldb::WriteBatch wb;
+  if (contents.size() < 12)
+    return ThrowError("Invalid batch");
+  leveldb::WriteBatchInternal::SetContents(&wb, contents);
+
+  NoopHandler handler;
+  leveldb::Status status = wb.Iterate(&handler);
+  if (!status.ok())
+    return ThrowError(status.ToString().c_str());
+
+  self->wb_ = wb;
+
+  return Undefined();
+}
+
 } // namespace node_leveldb
@@ -4,8 +4,6 @@
 #include <assert.h>
 #include <pthread.h>
 
-#include <vector>
-
 #include <leveldb/write_batch.h>
 #include <node.h>
 #include <v8.h>
@@ -41,11 +39,16 @@ class JBatch : ObjectWrap {
   static Handle<Value> New(const Arguments& args);
 
   static Handle<Value> Put(const Arguments& args);
+  static Handle<Value> PutMany(const Arguments& args);
   static Handle<Value> Del(const Arguments& args);
+  static Handle<Value> DelRange(const Arguments& args);
+  static Handle<Value> Merge(const Arguments& args);
   static Handle<Value> Clear(const Arguments& args);
+  static Handle<Value> ToBuffer(const Arguments& args);
+  static Handle<Value> SetContents(const Arguments& args);
 
+  // Copies the keys and values, so no buffers are retained
   leveldb::WriteBatch wb_;
-  std::vector< Persistent<Value> > buffers_;
 };
 
 } // node_leveldb
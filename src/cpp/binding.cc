@@ -4,6 +4,8 @@
 #include "comparator.h"
 #include "handle.h"
 #include "iterator.h"
+#include "keys.h"
+#include "table_writer.h"
 
 namespace node_leveldb {
 
@@ -13,6 +15,8 @@ static void init(Handle<Object> target) {
   JHandle::Initialize(target);
   JBatch::Initialize(target);
   JIterator::Initialize(target);
+  JTableWriter::Initialize(target);
+  KeyCodec::Initialize(target);
   PartitionedBitwiseComparator::Initialize(target);
 }
 
@@ -1,3 +1,5 @@
+#include <stdint.h>
+
 #include <algorithm>
 #include <vector>
 #include <sstream>
@@ -16,7 +18,7 @@ namespace node_leveldb {
 
 PartitionedBitwiseComparator::PartitionedBitwiseComparator(
   const vector< pair<uint32_t, bool> >& partitions)
-  : partitions_(partitions)
+  : partitions_(partitions), layout_(partitions)
 {
   stringstream name("node_leveldb.PartitionedBitwiseComparator(",
                     stringstream::out | stringstream::app);
@@ -39,36 +41,7 @@ const char* PartitionedBitwiseComparator::Name() const {
 int PartitionedBitwiseComparator::Compare(
   const leveldb::Slice& a, const leveldb::Slice& b) const
 {
-  size_t start = 0;
-  size_t rem = min(a.size(), b.size());
-
-  bool reverse = false;
-
-  vector< pair<uint32_t, bool> >::const_iterator it = partitions_.begin();
-  for (it = partitions_.begin(); it < partitions_.end(); ++it) {
-    size_t len = it->first;
-    reverse = it->second;
-
-    if (len <= 0 || len >= rem) break;
-
-    // slice this partition
-    leveldb::Slice as = leveldb::Slice(a.data() + start, len);
-    leveldb::Slice bs = leveldb::Slice(b.data() + start, len);
-
-    // compare partition
-    int comp = as.compare(bs);
-    if (comp != 0) return reverse ? -comp : comp;
-
-    start += len;
-    rem -= len;
-  }
-
-  leveldb::Slice as = leveldb::Slice(a.data() + start, a.size() - start);
-  leveldb::Slice bs = leveldb::Slice(b.data() + start, b.size() - start);
-
-  // compare end
-  int comp = as.compare(bs);
-  return reverse ? -comp : comp;
+  return layout_.Compare(a, b);
 }
 
 void PartitionedBitwiseComparator::FindShortestSeparator(
@@ -9,6 +9,8 @@
 #include <node.h>
 #include <v8.h>
 
+#include "partition_layout.h"
+
 using namespace v8;
 using namespace node;
 
@@ -22,6 +24,8 @@ namespace node_leveldb {
     For example, the key abc123 could be bitwise ordered in normal order for
     bytes 1-3 (abc) and in reverse for bytes 4-6 (123).
 
+    Compare() is PartitionLayout::Compare(); see partition_layout.h.
+
  */
 
 class PartitionedBitwiseComparator : leveldb::Comparator {
@@ -39,6 +43,7 @@ class PartitionedBitwiseComparator : leveldb::Comparator {
 
   std::string name_;
   const std::vector< std::pair<uint32_t, bool> > partitions_;
+  const PartitionLayout layout_;
 };
 
 } // node_leveldb
@@ -6,9 +6,14 @@
 #include <sstream>
 #include <vector>
 
+#include <helpers/memenv/memenv.h>
+#include <leveldb/compaction_filter.h>
+#include <leveldb/comparator.h>
 #include <leveldb/db.h>
+#include <leveldb/env.h>
 #include <node.h>
 #include <node_buffer.h>
+#include <util/coding.h>
 #include <v8.h>
 
 #include "batch.h"
@@ -39,6 +44,8 @@ static inline Handle<Value> Error(const leveldb::Status& status) {
 JHandle::JHandle(leveldb::DB* db)
   : ObjectWrap()
   , db_(db)
+  , inMemory_(false)
+  , filter_(NULL)
 {
 }
 
@@ -46,9 +53,31 @@ JHandle::~JHandle() {
   assert(db_ != NULL);
   delete db_;
   db_ = NULL;
+  delete filter_;
   comparator_.Dispose();
 };
 
+// Shared by every database opened with in_memory, so that like one on
+// disk an in-memory database outlives its handle until it is destroyed.
+leveldb::Env* InMemoryEnv() {
+  static leveldb::Env* env = leveldb::NewMemEnv(leveldb::Env::Default());
+  return env;
+}
+
+// Bytes held by the files of the in-memory database "name"
+static uint64_t InMemoryBytes(const std::string& name) {
+  leveldb::Env* env = InMemoryEnv();
+  std::vector<std::string> files;
+  env->GetChildren(name, &files);
+
+  uint64_t total = 0;
+  for (size_t i = 0; i < files.size(); ++i) {
+    uint64_t size;
+    if (env->GetFileSize(name + "/" + files[i], &size).ok()) total += size;
+  }
+  return total;
+}
+
 
 
 
@@ -61,20 +90,29 @@ JHandle::~JHandle() {
 
 class JHandle::OpAsync {
  public:
+  OpAsync() : status_(leveldb::Status()) {}
+
   OpAsync(const Handle<Value>& callback)
     : status_(leveldb::Status())
   {
+    SetCallback(callback);
+  }
+
+  virtual ~OpAsync() {
+    if (!callback_.IsEmpty()) callback_.Dispose();
+  }
+
+  void SetCallback(const Handle<Value>& callback) {
     assert(callback->IsFunction());
     Handle<Function> cb = Handle<Function>::Cast(callback);
     callback_ = Persistent<Function>::New(cb);
   }
 
-  virtual ~OpAsync() {
-    callback_.Dispose();
-  }
+  // Called once the callback has run.  Pooled ops go back to their pool.
+  virtual void Release() { delete this; }
 
   template <class T> static Handle<Value> AsyncEnqueue(T* op) {
-    return AsyncQueue(op, AsyncWorker<T>, AsyncCallback<T>);
+    return AsyncQueue(&op->req_, op, AsyncWorker<T>, AsyncCallback<T>);
   }
 
   template <class T> static void AsyncWorker(uv_work_t* req) {
@@ -101,17 +139,83 @@ class JHandle::OpAsync {
     op->callback_->Call(Context::GetCurrent()->Global(), 2, args);
     if (tryCatch.HasCaught()) FatalException(tryCatch);
 
-    delete op;
-    delete req;
+    op->callback_.Dispose();
+    op->callback_.Clear();
+    op->Release();
   }
   leveldb::Status status_;
   Persistent<Function> callback_;
+  uv_work_t req_;
 };
 
 
 
 
 
+/**
+
+    Op pools
+
+ */
+
+// A free list of ops of one type, so that steady-state requests reuse
+// ops instead of allocating them.  Ops are only acquired and released
+// on the main thread.
+template <class T> class OpPool {
+ public:
+  static T* Acquire(const Handle<Value>& callback) {
+    T* op;
+    if (free_.empty()) {
+      op = new T;
+      ++allocated_;
+    } else {
+      op = free_.back();
+      free_.pop_back();
+      ++reused_;
+    }
+    op->SetCallback(callback);
+    return op;
+  }
+
+  static void Release(T* op) {
+    op->Reset();
+    if (free_.size() < kMaxFree) {
+      if (free_.capacity() == 0) free_.reserve(kMaxFree);
+      free_.push_back(op);
+    } else {
+      delete op;
+    }
+  }
+
+  static Handle<Value> Stats() {
+    HandleScope scope;
+    Local<Object> stats = Object::New();
+    stats->Set(String::NewSymbol("allocated"),
+               Number::New(static_cast<double>(allocated_)));
+    stats->Set(String::NewSymbol("reused"),
+               Number::New(static_cast<double>(reused_)));
+    stats->Set(String::NewSymbol("free"),
+               Integer::New(static_cast<int32_t>(free_.size())));
+    return scope.Close(stats);
+  }
+
+ private:
+  // Enough for the requests a busy process keeps in flight
+  static const size_t kMaxFree = 256;
+
+  static std::vector<T*> free_;
+  static uint64_t allocated_;
+  static uint64_t reused_;
+};
+
+template <class T> std::vector<T*> OpPool<T>::free_;
+template <class T> uint64_t OpPool<T>::allocated_ = 0;
+template <class T> uint64_t OpPool<T>::reused_ = 0;
+
+
+
+
+
 /**
 
     Open, destroy or repair
@@ -121,7 +225,10 @@ class JHandle::OpAsync {
 class JHandle::OpenAsync : public OpAsync {
  public:
   OpenAsync(const Handle<Value>& callback) : OpAsync(callback) {}
-  virtual ~OpenAsync() { comparator_.Dispose(); }
+  virtual ~OpenAsync() {
+    comparator_.Dispose();
+    delete options_.compaction_filter;
+  }
 
   template <class T> static Handle<Value> Hook(const Arguments& args) {
     HandleScope scope;
@@ -135,7 +242,10 @@ class JHandle::OpenAsync : public OpAsync {
     op->name_ = *String::Utf8Value(args[0]);
 
     // Optional options
-    UnpackOptions(args[1], op->options_, &op->comparator_);
+    if (!UnpackOptions(args[1], op->options_, &op->comparator_)) {
+      delete op;
+      return Undefined();
+    }
 
     return AsyncEnqueue<T>(op);
   }
@@ -146,9 +256,20 @@ class JHandle::OpenAsync : public OpAsync {
 
   void Result(Handle<Value>& error, Handle<Value>& result) {
     if (status_.ok()) {
-      Handle<Value> args[] = { External::New(db_), Undefined() };
+      Handle<Value> args[] = {
+        External::New(db_), Undefined(), Undefined(), String::New(name_.c_str()),
+        Boolean::New(options_.env == InMemoryEnv())
+      };
       if (!comparator_.IsEmpty()) args[1] = comparator_;
-      result = JHandle::constructor->GetFunction()->NewInstance(2, args);
+
+      // The handle takes ownership of the filter
+      if (options_.compaction_filter != NULL) {
+        args[2] = External::New(
+          const_cast<leveldb::CompactionFilter*>(options_.compaction_filter));
+        options_.compaction_filter = NULL;
+      }
+
+      result = JHandle::constructor->GetFunction()->NewInstance(5, args);
     }
   }
 
@@ -206,51 +327,77 @@ class JHandle::RepairAsync : public OpenAsync {
 
 class JHandle::ReadAsync : public OpAsync {
  public:
-  ReadAsync(const Handle<Value>& callback) : OpAsync(callback) {}
-  virtual ~ReadAsync() { keyHandle_.Dispose(); }
+  ReadAsync() : asBuffer_(false) {}
 
   static Handle<Value> Hook(const Arguments& args) {
     HandleScope scope;
 
-    if (args.Length() != 3 || !Buffer::HasInstance(args[0]) ||
+    if (args.Length() != 3 || !IsStringOrBuffer(args[0]) ||
         !args[2]->IsFunction())
       return ThrowTypeError("Invalid arguments");
 
-    ReadAsync* op = new ReadAsync(args[2]);
-
     // Required self
-    op->self_ = ObjectWrap::Unwrap<JHandle>(args.This());
-
-    // Required key
-    op->key_ = ToSlice(args[0], op->keyHandle_);
+    JHandle* self = ObjectWrap::Unwrap<JHandle>(args.This());
 
     // Optional options
-    UnpackReadOptions(args[1], op->options_);
+    leveldb::ReadOptions options;
+    UnpackReadOptions(args[1], options);
+    SnapshotRef* snapshot;
+    if (!self->PinSnapshot(args[1], options, &snapshot))
+      return ThrowError("Snapshot has been released");
+
+    ReadAsync* op = OpPool<ReadAsync>::Acquire(args[2]);
+    op->self_ = self;
+    op->options_ = options;
+    op->snapshot_ = snapshot;
+    op->asBuffer_ = UnpackAsBuffer(args[1]);
+
+    // Required key
+    op->key_.Assign(args[0], true);
 
     return AsyncEnqueue<ReadAsync>(op);
   }
 
   void Run() {
-    result_ = new std::string;
-    status_ = self_->db_->Get(options_, key_, result_);
+    status_ = self_->db_->Get(options_, key_, &value_);
   }
 
   void Result(Handle<Value>& error, Handle<Value>& result) {
+    UnpinSnapshot(snapshot_);
     if (status_.IsNotFound()) {
       result = Null();
+    } else if (status_.ok() && asBuffer_) {
+      // Hand the bytes over to the buffer without copying them
+      std::string* value = new std::string;
+      value->swap(value_);
+      result = ToBuffer(value);
     } else if (status_.ok()) {
-      result = ToBuffer(result_);
+      result = ToString(value_);
     }
   }
 
+  void Release() { OpPool<ReadAsync>::Release(this); }
+
+  void Reset() {
+    status_ = leveldb::Status();
+    options_ = leveldb::ReadOptions();
+    key_.Clear();
+    asBuffer_ = false;
+    if (value_.capacity() > kMaxPooledValue) std::string().swap(value_);
+    value_.clear();
+  }
+
+  // Larger values are not kept around in the pool
+  static const size_t kMaxPooledValue = 64 << 10;
+
   JHandle* self_;
 
   leveldb::ReadOptions options_;
-  leveldb::Slice key_;
+  SnapshotRef* snapshot_;
+  ValueSlice key_;
+  bool asBuffer_;
 
-  std::string* result_;
-
-  Persistent<Value> keyHandle_;
+  std::string value_;
 };
 
 
@@ -265,8 +412,8 @@ class JHandle::ReadAsync : public OpAsync {
 
 class JHandle::WriteAsync : public OpAsync {
  public:
-  WriteAsync(const Handle<Value>& callback) : OpAsync(callback) {}
-  virtual ~WriteAsync() { batchHandle_.Dispose(); }
+  WriteAsync() : batch_(NULL) {}
+  virtual ~WriteAsync() { Reset(); }
 
   static Handle<Value> Hook(const Arguments& args) {
     HandleScope scope;
@@ -275,7 +422,7 @@ class JHandle::WriteAsync : public OpAsync {
         !args[2]->IsFunction())
       return ThrowTypeError("Invalid arguments");
 
-    WriteAsync* op = new WriteAsync(args[2]);
+    WriteAsync* op = OpPool<WriteAsync>::Acquire(args[2]);
 
     // Required self
     op->self_ = ObjectWrap::Unwrap<JHandle>(args.This());
@@ -290,6 +437,40 @@ class JHandle::WriteAsync : public OpAsync {
     return AsyncEnqueue<WriteAsync>(op);
   }
 
+  // put(key, value, options, callback), written with the op's own batch
+  static Handle<Value> PutHook(const Arguments& args) {
+    HandleScope scope;
+
+    if (args.Length() != 4 || !IsStringOrBuffer(args[0]) ||
+        !IsStringOrBuffer(args[1]) || !args[3]->IsFunction())
+      return ThrowTypeError("Invalid arguments");
+
+    WriteAsync* op = OpPool<WriteAsync>::Acquire(args[3]);
+    op->self_ = ObjectWrap::Unwrap<JHandle>(args.This());
+    op->batch_ = &op->ownBatch_;
+    op->ownBatch_.Put(ValueSlice(args[0]), ValueSlice(args[1]));
+    UnpackWriteOptions(args[2], op->options_);
+
+    return AsyncEnqueue<WriteAsync>(op);
+  }
+
+  // del(key, options, callback), written with the op's own batch
+  static Handle<Value> DelHook(const Arguments& args) {
+    HandleScope scope;
+
+    if (args.Length() != 3 || !IsStringOrBuffer(args[0]) ||
+        !args[2]->IsFunction())
+      return ThrowTypeError("Invalid arguments");
+
+    WriteAsync* op = OpPool<WriteAsync>::Acquire(args[2]);
+    op->self_ = ObjectWrap::Unwrap<JHandle>(args.This());
+    op->batch_ = &op->ownBatch_;
+    op->ownBatch_.Delete(ValueSlice(args[0]));
+    UnpackWriteOptions(args[1], op->options_);
+
+    return AsyncEnqueue<WriteAsync>(op);
+  }
+
   void Run() {
     status_ = self_->db_->Write(options_, batch_);
   }
@@ -297,9 +478,23 @@ class JHandle::WriteAsync : public OpAsync {
   void Result(Handle<Value>& error, Handle<Value>& result) {
   }
 
+  void Release() { OpPool<WriteAsync>::Release(this); }
+
+  void Reset() {
+    status_ = leveldb::Status();
+    options_ = leveldb::WriteOptions();
+    batch_ = NULL;
+    ownBatch_.Clear();
+    if (!batchHandle_.IsEmpty()) {
+      batchHandle_.Dispose();
+      batchHandle_.Clear();
+    }
+  }
+
   JHandle* self_;
 
   leveldb::WriteBatch* batch_;
+  leveldb::WriteBatch ownBatch_;
   leveldb::WriteOptions options_;
 
   Persistent<Value> batchHandle_;
@@ -325,13 +520,20 @@ class JHandle::GetIteratorAsync : public OpAsync {
     if (args.Length() != 2 || !args[1]->IsFunction())
       return ThrowTypeError("Invalid arguments");
 
-    GetIteratorAsync* op = new GetIteratorAsync(args[1]);
-
     // Required self
-    op->self_ = ObjectWrap::Unwrap<JHandle>(args.This());
+    JHandle* self = ObjectWrap::Unwrap<JHandle>(args.This());
 
     // Optional options
-    UnpackReadOptions(args[0], op->options_);
+    leveldb::ReadOptions options;
+    UnpackReadOptions(args[0], options);
+    SnapshotRef* snapshot;
+    if (!self->PinSnapshot(args[0], options, &snapshot))
+      return ThrowError("Snapshot has been released");
+
+    GetIteratorAsync* op = new GetIteratorAsync(args[1]);
+    op->self_ = self;
+    op->options_ = options;
+    op->snapshot_ = snapshot;
 
     return AsyncEnqueue<GetIteratorAsync>(op);
   }
@@ -341,30 +543,18 @@ class JHandle::GetIteratorAsync : public OpAsync {
   }
 
   void Result(Handle<Value>& error, Handle<Value>& result) {
+    UnpinSnapshot(snapshot_);
     if (status_.ok()) {
-      Local<Value> args[] = { External::New(it_) };
-      Local<Object> instance = JIterator::constructor->GetFunction()->NewInstance(1, args);
-
-      // Keep a weak reference
-      Persistent<Object> weak = Persistent<Object>::New(instance);
-      weak.MakeWeak(self_, &UnrefIterator);
-
-      self_->Ref();
-
-      result = instance;
+      // The iterator keeps the handle alive until it is closed or collected
+      Local<Value> args[] = { External::New(it_), External::New(self_) };
+      result = JIterator::constructor->GetFunction()->NewInstance(2, args);
     }
   }
 
-  static void UnrefIterator(Persistent<Value> object, void* parameter) {
-    JHandle* self = static_cast<JHandle*>(parameter);
-    assert(self);
-    self->Unref();
-    object.Dispose();
-  }
-
   JHandle* self_;
 
   leveldb::ReadOptions options_;
+  SnapshotRef* snapshot_;
   leveldb::Iterator* it_;
 };
 
@@ -402,10 +592,16 @@ class JHandle::GetSnapshotAsync : public OpAsync {
 
   void Result(Handle<Value>& error, Handle<Value>& result) {
     if (status_.ok()) {
-      Local<Value> instance = External::New(static_cast<void*>(snapshot_));
+      SnapshotRef* ref = new SnapshotRef;
+      ref->self = self_;
+      ref->snapshot = snapshot_;
+      ref->pins = 0;
+      ref->released = false;
 
-      Persistent<Value> weak = Persistent<Value>::New(instance);
-      weak.MakeWeak(self_, &UnrefSnapshot);
+      // Keep a weak reference in case release() is never called
+      Local<Value> instance = External::New(ref);
+      ref->handle = Persistent<Value>::New(instance);
+      ref->handle.MakeWeak(ref, &WeakSnapshot);
 
       self_->Ref();
 
@@ -413,25 +609,100 @@ class JHandle::GetSnapshotAsync : public OpAsync {
     }
   }
 
-  static void UnrefSnapshot(Persistent<Value> object, void* parameter) {
-    assert(object->IsExternal());
+  JHandle* self_;
+  leveldb::Snapshot* snapshot_;
+};
+
+bool JHandle::PinSnapshot(Handle<Value> val, leveldb::ReadOptions& options,
+                          SnapshotRef** ref) {
+  HandleScope scope;
+  *ref = NULL;
+  if (!val->IsObject()) return true;
 
-    JHandle* self = static_cast<JHandle*>(parameter);
-    const leveldb::Snapshot* snapshot =
-      static_cast<leveldb::Snapshot*>(External::Unwrap(object));
+  static const Persistent<String> kSnapshot = NODE_PSYMBOL("snapshot");
 
-    assert(self);
-    assert(snapshot);
+  Local<Object> obj = val->ToObject();
+  if (!obj->Has(kSnapshot)) return true;
+  Local<Value> ext = obj->Get(kSnapshot);
+  if (!ext->IsExternal()) return true;
+
+  SnapshotRef* snapshot = static_cast<SnapshotRef*>(External::Unwrap(ext));
+  if (snapshot->released || snapshot->self != this) return false;
+
+  ++snapshot->pins;
+  options.snapshot = snapshot->snapshot;
+  *ref = snapshot;
+  return true;
+}
 
-    self->db_->ReleaseSnapshot(snapshot);
-    self->Unref();
+void JHandle::UnpinSnapshot(SnapshotRef* ref) {
+  if (ref == NULL) return;
 
-    object.Dispose();
+  assert(ref->pins > 0);
+  if (--ref->pins > 0) return;
+
+  if (ref->released) {
+    ref->self->db_->ReleaseSnapshot(ref->snapshot);
+    ref->snapshot = NULL;
+    ref->self->Unref();
   }
+  MaybeDeleteSnapshot(ref);
+}
 
-  JHandle* self_;
-  leveldb::Snapshot* snapshot_;
-};
+void JHandle::DropSnapshot(SnapshotRef* ref) {
+  if (ref->released) return;
+  ref->released = true;
+
+  if (ref->pins == 0) {
+    ref->self->db_->ReleaseSnapshot(ref->snapshot);
+    ref->snapshot = NULL;
+    ref->self->Unref();
+  }
+}
+
+void JHandle::MaybeDeleteSnapshot(SnapshotRef* ref) {
+  if (ref->handle.IsEmpty() && ref->pins == 0) {
+    assert(ref->snapshot == NULL);
+    delete ref;
+  }
+}
+
+void JHandle::WeakSnapshot(Persistent<Value> object, void* parameter) {
+  assert(object->IsExternal());
+
+  SnapshotRef* ref = static_cast<SnapshotRef*>(parameter);
+  assert(ref);
+  assert(External::Unwrap(object) == ref);
+
+  ref->handle.Dispose();
+  ref->handle.Clear();
+
+  DropSnapshot(ref);
+  MaybeDeleteSnapshot(ref);
+}
+
+Handle<Value> JHandle::ReleaseSnapshot(const Arguments& args) {
+  HandleScope scope;
+
+  if (args.Length() != 1 || !args[0]->IsExternal())
+    return ThrowTypeError("Invalid arguments");
+
+  JHandle* self = ObjectWrap::Unwrap<JHandle>(args.This());
+  SnapshotRef* ref = static_cast<SnapshotRef*>(External::Unwrap(args[0]));
+  if (!ref->released && ref->self != self)
+    return ThrowError("Snapshot belongs to another handle");
+
+  DropSnapshot(ref);
+
+  return Undefined();
+}
+
+Handle<Value> JHandle::LatestSequence(const Arguments& args) {
+  HandleScope scope;
+  JHandle* self = ObjectWrap::Unwrap<JHandle>(args.This());
+  uint64_t sequence = self->db_->GetLatestSequenceNumber();
+  return scope.Close(Number::New(static_cast<double>(sequence)));
+}
 
 
 
@@ -465,7 +736,16 @@ class JHandle::GetPropertyAsync : public OpAsync {
   }
 
   void Run() {
-    hasProperty_ = self_->db_->GetProperty(name_, &value_);
+    if (name_ == "leveldb.in-memory-bytes") {
+      hasProperty_ = self_->inMemory_;
+      if (hasProperty_) {
+        std::ostringstream out;
+        out << InMemoryBytes(self_->name_);
+        value_ = out.str();
+      }
+    } else {
+      hasProperty_ = self_->db_->GetProperty(name_, &value_);
+    }
   }
 
   void Result(Handle<Value>& error, Handle<Value>& result) {
@@ -567,6 +847,662 @@ class JHandle::GetApproximateSizesAsync : public OpAsync {
 
 
 
+/**
+
+    Warmup
+
+ */
+
+class JHandle::WarmupAsync : public OpAsync {
+ public:
+  WarmupAsync(const Handle<Value>& callback)
+    : OpAsync(callback), levels_(INT_MAX), maxBytes_(0), bytes_(0),
+      progress_(NULL) {}
+
+  virtual ~WarmupAsync() {
+    if (progress_)
+      uv_close(reinterpret_cast<uv_handle_t*>(&progress_->async), Close);
+  }
+
+  static Handle<Value> Hook(const Arguments& args) {
+    HandleScope scope;
+
+    if (args.Length() != 3 || !args[2]->IsFunction())
+      return ThrowTypeError("Invalid arguments");
+
+    // Required self
+    JHandle* self = ObjectWrap::Unwrap<JHandle>(args.This());
+
+    // Optional options
+    leveldb::ReadOptions options;
+    UnpackReadOptions(args[0], options);
+    SnapshotRef* snapshot;
+    if (!self->PinSnapshot(args[0], options, &snapshot))
+      return ThrowError("Snapshot has been released");
+
+    WarmupAsync* op = new WarmupAsync(args[2]);
+    op->self_ = self;
+    op->options_ = options;
+    op->snapshot_ = snapshot;
+    UnpackWarmupOptions(args[0], op->levels_, op->maxBytes_);
+
+    // Optional progress callback, called on the main thread
+    if (args[1]->IsFunction()) {
+      Progress* progress = op->progress_ = new Progress;
+      progress->callback =
+        Persistent<Function>::New(Handle<Function>::Cast(args[1]));
+      progress->done = progress->total = progress->reported = 0;
+      progress->async.data = progress;
+      uv_mutex_init(&progress->mutex);
+      uv_async_init(uv_default_loop(), &progress->async, Report);
+    }
+
+    return AsyncEnqueue<WarmupAsync>(op);
+  }
+
+  void Run() {
+    if (levels_ > 0)
+      status_ = self_->db_->Warmup(options_, levels_ - 1, maxBytes_,
+                                   &Update, this);
+  }
+
+  void Result(Handle<Value>& error, Handle<Value>& result) {
+    UnpinSnapshot(snapshot_);
+    if (progress_) Report(&progress_->async, 0);
+    if (status_.ok()) result = Number::New(static_cast<double>(bytes_));
+  }
+
+  struct Progress {
+    uv_async_t async;
+    uv_mutex_t mutex;
+    uint64_t done;      // Guarded by mutex
+    uint64_t total;     // Guarded by mutex
+    uint64_t reported;  // Main thread only
+    Persistent<Function> callback;
+  };
+
+  // Called on the worker thread after each table file is loaded
+  static void Update(void* arg, uint64_t done, uint64_t total) {
+    WarmupAsync* op = static_cast<WarmupAsync*>(arg);
+    op->bytes_ = done;
+
+    Progress* progress = op->progress_;
+    if (progress) {
+      uv_mutex_lock(&progress->mutex);
+      progress->done = done;
+      progress->total = total;
+      uv_mutex_unlock(&progress->mutex);
+      uv_async_send(&progress->async);
+    }
+  }
+
+  static void Report(uv_async_t* handle, int status) {
+    HandleScope scope;
+    Progress* progress = static_cast<Progress*>(handle->data);
+
+    uv_mutex_lock(&progress->mutex);
+    uint64_t done = progress->done;
+    uint64_t total = progress->total;
+    uv_mutex_unlock(&progress->mutex);
+
+    // Several updates may be coalesced into one report
+    if (done == progress->reported) return;
+    progress->reported = done;
+
+    Handle<Value> args[] = {
+      Number::New(static_cast<double>(done)),
+      Number::New(static_cast<double>(total))
+    };
+
+    TryCatch tryCatch;
+    progress->callback->Call(Context::GetCurrent()->Global(), 2, args);
+    if (tryCatch.HasCaught()) FatalException(tryCatch);
+  }
+
+  static void Close(uv_handle_t* handle) {
+    Progress* progress = static_cast<Progress*>(handle->data);
+    progress->callback.Dispose();
+    uv_mutex_destroy(&progress->mutex);
+    delete progress;
+  }
+
+  JHandle* self_;
+
+  leveldb::ReadOptions options_;
+  SnapshotRef* snapshot_;
+  int levels_;
+  uint64_t maxBytes_;
+  uint64_t bytes_;
+
+  Progress* progress_;
+};
+
+
+
+
+
+/**
+
+    Ingest
+
+ */
+
+class JHandle::IngestAsync : public OpAsync {
+ public:
+  IngestAsync(const Handle<Value>& callback) : OpAsync(callback) {}
+
+  static Handle<Value> Hook(const Arguments& args) {
+    HandleScope scope;
+
+    if (args.Length() != 2 || !args[0]->IsArray() || !args[1]->IsFunction())
+      return ThrowTypeError("Invalid arguments");
+
+    IngestAsync* op = new IngestAsync(args[1]);
+
+    // Required self
+    op->self_ = ObjectWrap::Unwrap<JHandle>(args.This());
+
+    // Required file names
+    Local<Array> array(Array::Cast(*args[0]));
+
+    int len = array->Length();
+    for (int i = 0; i < len; ++i)
+      op->files_.push_back(*String::Utf8Value(array->Get(i)));
+
+    return AsyncEnqueue<IngestAsync>(op);
+  }
+
+  void Run() {
+    status_ = self_->db_->IngestFiles(files_);
+  }
+
+  void Result(Handle<Value>& error, Handle<Value>& result) {}
+
+  JHandle* self_;
+
+  std::vector<std::string> files_;
+};
+
+
+
+
+
+/**
+
+    Checkpoint
+
+ */
+
+class JHandle::CheckpointAsync : public OpAsync {
+ public:
+  CheckpointAsync(const Handle<Value>& callback) : OpAsync(callback) {}
+
+  static Handle<Value> Hook(const Arguments& args) {
+    HandleScope scope;
+
+    if (args.Length() != 2 || !args[0]->IsString() || !args[1]->IsFunction())
+      return ThrowTypeError("Invalid arguments");
+
+    CheckpointAsync* op = new CheckpointAsync(args[1]);
+
+    // Required self
+    op->self_ = ObjectWrap::Unwrap<JHandle>(args.This());
+
+    // Required directory
+    op->dir_ = *String::Utf8Value(args[0]);
+
+    return AsyncEnqueue<CheckpointAsync>(op);
+  }
+
+  void Run() {
+    status_ = self_->db_->Checkpoint(dir_);
+  }
+
+  void Result(Handle<Value>& error, Handle<Value>& result) {}
+
+  JHandle* self_;
+
+  std::string dir_;
+};
+
+
+
+
+
+/**
+
+    Updates since
+
+ */
+
+class JHandle::UpdatesSinceAsync : public OpAsync {
+ public:
+  UpdatesSinceAsync(const Handle<Value>& callback)
+    : OpAsync(callback), maxBytes_(0) {}
+
+  static Handle<Value> Hook(const Arguments& args) {
+    HandleScope scope;
+
+    if (args.Length() != 3 || !args[0]->IsNumber() || !args[2]->IsFunction())
+      return ThrowTypeError("Invalid arguments");
+
+    UpdatesSinceAsync* op = new UpdatesSinceAsync(args[2]);
+
+    // Required self
+    op->self_ = ObjectWrap::Unwrap<JHandle>(args.This());
+
+    // Required sequence number
+    op->sequence_ = static_cast<uint64_t>(args[0]->NumberValue());
+
+    // Optional options
+    UnpackUpdatesOptions(args[1], op->maxBytes_);
+
+    return AsyncEnqueue<UpdatesSinceAsync>(op);
+  }
+
+  void Run() {
+    status_ = self_->db_->GetUpdatesSince(sequence_, maxBytes_, &updates_);
+  }
+
+  void Result(Handle<Value>& error, Handle<Value>& result) {
+    static const Persistent<String> kSequence = NODE_PSYMBOL("sequence");
+    static const Persistent<String> kData = NODE_PSYMBOL("data");
+
+    if (!status_.ok()) return;
+
+    int len = updates_.size();
+    Handle<Array> array = Array::New(len);
+
+    for (int i = 0; i < len; ++i) {
+      // A serialized batch starts with its fixed64 sequence number
+      std::string* data = new std::string;
+      data->swap(updates_[i]);
+
+      Local<Object> update = Object::New();
+      update->Set(kSequence, Number::New(static_cast<double>(
+        leveldb::DecodeFixed64(data->data()))));
+      update->Set(kData, ToBuffer(data));
+      array->Set(i, update);
+    }
+
+    result = array;
+  }
+
+  JHandle* self_;
+
+  uint64_t sequence_;
+  size_t maxBytes_;
+  std::vector<std::string> updates_;
+};
+
+
+
+
+
+/**
+
+    Catch up
+
+ */
+
+class JHandle::CatchUpAsync : public OpAsync {
+ public:
+  CatchUpAsync(const Handle<Value>& callback) : OpAsync(callback) {}
+
+  static Handle<Value> Hook(const Arguments& args) {
+    HandleScope scope;
+
+    if (args.Length() != 1 || !args[0]->IsFunction())
+      return ThrowTypeError("Invalid arguments");
+
+    CatchUpAsync* op = new CatchUpAsync(args[0]);
+
+    // Required self
+    op->self_ = ObjectWrap::Unwrap<JHandle>(args.This());
+
+    return AsyncEnqueue<CatchUpAsync>(op);
+  }
+
+  void Run() {
+    status_ = self_->db_->CatchUp();
+  }
+
+  void Result(Handle<Value>& error, Handle<Value>& result) {}
+
+  JHandle* self_;
+};
+
+
+
+
+
+/**
+
+    Parallel scan
+
+ */
+
+// The key halfway between a and b, taken as zero-padded base-256 numbers
+static std::string MidKey(const std::string& a, const std::string& b) {
+  const size_t n = std::max(a.size(), b.size()) + 1;
+  std::vector<unsigned> sum(n);
+  unsigned carry = 0;
+  for (size_t i = n; i-- > 0; ) {
+    unsigned x = carry;
+    if (i < a.size()) x += static_cast<unsigned char>(a[i]);
+    if (i < b.size()) x += static_cast<unsigned char>(b[i]);
+    sum[i] = x & 0xff;
+    carry = x >> 8;
+  }
+  std::string mid(n, '\0');
+  for (size_t i = 0; i < n; i++) {
+    unsigned x = (carry << 8) | sum[i];
+    mid[i] = static_cast<char>(x >> 1);
+    carry = x & 1;
+  }
+  return mid;
+}
+
+static uint64_t ApproximateSize(leveldb::DB* db, const leveldb::Slice& start,
+                                const leveldb::Slice& limit) {
+  leveldb::Range range(start, limit);
+  uint64_t size = 0;
+  db->GetApproximateSizes(&range, 1, &size);
+  return size;
+}
+
+// Append up to n - 1 keys that split [start, end] into ranges of about
+// the same size on disk, found by bisecting the key space with
+// GetApproximateSizes().  Only valid for bytewise ordered keys.
+static void SplitRange(leveldb::DB* db, const std::string& start,
+                       const std::string& end, int n,
+                       std::vector<std::string>* splits) {
+  const uint64_t total = ApproximateSize(db, start, end);
+  std::string lo = start;
+  for (int i = 1; i < n && total > 0; ++i) {
+    const uint64_t target = total / n * i;
+    std::string a = lo;
+    std::string b = end;
+    for (int step = 0; step < 64; ++step) {
+      std::string mid = MidKey(a, b);
+      if (leveldb::Slice(mid).compare(a) <= 0 ||
+          leveldb::Slice(mid).compare(b) >= 0) break;
+      if (ApproximateSize(db, start, mid) < target) a.swap(mid);
+      else b.swap(mid);
+    }
+    if (leveldb::Slice(b).compare(lo) > 0 &&
+        leveldb::Slice(b).compare(end) < 0) {
+      splits->push_back(b);
+      lo = b;
+    }
+  }
+}
+
+// A range scan split into shards that are read on the thread pool at the
+// same time, all from one snapshot.  Each work request reads the next
+// chunk of one shard, which is handed to JS before the shard goes on, so
+// at most one chunk per shard is held in memory.
+class JHandle::ParallelScan {
+ public:
+  static Handle<Value> Hook(const Arguments& args) {
+    HandleScope scope;
+
+    if (args.Length() != 3 || !args[0]->IsObject() ||
+        !args[1]->IsFunction() || !args[2]->IsFunction())
+      return ThrowTypeError("Invalid arguments");
+
+    static const Persistent<String> kStart = NODE_PSYMBOL("start");
+    static const Persistent<String> kEnd = NODE_PSYMBOL("end");
+    static const Persistent<String> kShards = NODE_PSYMBOL("shards");
+    static const Persistent<String> kChunkSize = NODE_PSYMBOL("chunk_size");
+
+    Local<Object> obj = args[0]->ToObject();
+    Local<Value> start = obj->Get(kStart);
+    Local<Value> end = obj->Get(kEnd);
+    if ((!start->IsUndefined() && !IsStringOrBuffer(start)) ||
+        (!end->IsUndefined() && !IsStringOrBuffer(end)))
+      return ThrowTypeError("Invalid arguments");
+
+    // Read from the caller's snapshot if there is one
+    JHandle* self = ObjectWrap::Unwrap<JHandle>(args.This());
+    leveldb::ReadOptions options;
+    UnpackReadOptions(args[0], options);
+    SnapshotRef* pinned;
+    if (!self->PinSnapshot(args[0], options, &pinned))
+      return ThrowError("Snapshot has been released");
+
+    ParallelScan* scan = new ParallelScan;
+    scan->self_ = self;
+    scan->options_ = options;
+    scan->pinned_ = pinned;
+
+    scan->hasStart_ = !start->IsUndefined();
+    if (scan->hasStart_) scan->start_ = ValueSlice(start).slice().ToString();
+    scan->hasEnd_ = !end->IsUndefined();
+    if (scan->hasEnd_) scan->end_ = ValueSlice(end).slice().ToString();
+
+    scan->shards_ = obj->Has(kShards) ? obj->Get(kShards)->Int32Value() : 4;
+    if (scan->shards_ < 1) scan->shards_ = 1;
+    scan->chunkSize_ = obj->Has(kChunkSize)
+      ? obj->Get(kChunkSize)->Uint32Value() : 1000;
+    if (scan->chunkSize_ < 1) scan->chunkSize_ = 1;
+
+    scan->asBuffer_ = UnpackAsBuffer(args[0]);
+
+    // Split points are only found for the default bytewise order
+    if (scan->self_->comparator_.IsEmpty()) {
+      scan->comparator_ = leveldb::BytewiseComparator();
+    } else {
+      scan->comparator_ = static_cast<leveldb::Comparator*>(
+        External::Unwrap(scan->self_->comparator_));
+      scan->shards_ = 1;
+    }
+
+    scan->onChunk_ = Persistent<Function>::New(Local<Function>::Cast(args[1]));
+    scan->callback_ = Persistent<Function>::New(Local<Function>::Cast(args[2]));
+
+    scan->self_->Ref();
+
+    return AsyncQueue(&scan->req_, scan, Plan, AfterPlan);
+  }
+
+ private:
+  struct Shard {
+    uv_work_t req;
+    ParallelScan* scan;
+    int index;
+    std::string start;
+    std::string limit;      // Exclusive, except for the last shard
+    bool last;
+    leveldb::Iterator* it;
+    std::vector<std::string> keys;
+    std::vector<std::string> values;
+    bool done;
+    leveldb::Status status;
+  };
+
+  ParallelScan() : pinned_(NULL), snapshot_(NULL), pending_(0) {}
+
+  ~ParallelScan() {
+    onChunk_.Dispose();
+    callback_.Dispose();
+  }
+
+  // Take a snapshot unless the caller gave one, and split the range, on
+  // the thread pool
+  static void Plan(uv_work_t* req) {
+    ParallelScan* scan = static_cast<ParallelScan*>(req->data);
+    leveldb::DB* db = scan->self_->db_;
+
+    if (scan->pinned_ == NULL) {
+      scan->snapshot_ = db->GetSnapshot();
+      scan->options_.snapshot = scan->snapshot_;
+    }
+
+    std::vector<std::string> starts;
+    starts.push_back(scan->start_);
+    if (scan->shards_ > 1) {
+      // Bisect between the first and last keys of an open range, which
+      // usually share a prefix
+      std::string start = scan->start_;
+      std::string end = scan->end_;
+      leveldb::Iterator* it = db->NewIterator(scan->options_);
+      if (!scan->hasStart_) {
+        it->SeekToFirst();
+        if (it->Valid()) start = it->key().ToString();
+      }
+      bool hasEnd = scan->hasEnd_;
+      if (!hasEnd) {
+        it->SeekToLast();
+        if (it->Valid()) end = it->key().ToString();
+        hasEnd = it->Valid();
+      }
+      delete it;
+      if (hasEnd && leveldb::Slice(start).compare(end) < 0)
+        SplitRange(db, start, end, scan->shards_, &starts);
+    }
+
+    scan->shardList_.resize(starts.size());
+    for (size_t i = 0; i < starts.size(); ++i) {
+      Shard& shard = scan->shardList_[i];
+      shard.scan = scan;
+      shard.index = i;
+      shard.start = starts[i];
+      shard.last = (i + 1 == starts.size());
+      shard.limit = shard.last ? scan->end_ : starts[i + 1];
+      shard.it = NULL;
+      shard.done = false;
+    }
+  }
+
+  static void AfterPlan(uv_work_t* req) {
+    HandleScope scope;
+    ParallelScan* scan = static_cast<ParallelScan*>(req->data);
+
+    scan->pending_ = scan->shardList_.size();
+    for (size_t i = 0; i < scan->shardList_.size(); ++i) {
+      Shard* shard = &scan->shardList_[i];
+      AsyncQueue(&shard->req, shard, ReadChunk, AfterChunk);
+    }
+  }
+
+  // Read the next chunk of a shard, on the thread pool
+  static void ReadChunk(uv_work_t* req) {
+    Shard* shard = static_cast<Shard*>(req->data);
+    ParallelScan* scan = shard->scan;
+
+    leveldb::Iterator* it = shard->it;
+    if (it == NULL) {
+      it = shard->it = scan->self_->db_->NewIterator(scan->options_);
+      if (shard->index == 0 && !scan->hasStart_) it->SeekToFirst();
+      else it->Seek(shard->start);
+    }
+
+    shard->keys.clear();
+    shard->values.clear();
+    shard->done = true;
+    for (; it->Valid(); it->Next()) {
+      leveldb::Slice key = it->key();
+      if (shard->last) {
+        if (scan->hasEnd_ &&
+            scan->comparator_->Compare(key, shard->limit) > 0) break;
+      } else if (scan->comparator_->Compare(key, shard->limit) >= 0) {
+        break;
+      }
+      if (shard->keys.size() == scan->chunkSize_) {
+        shard->done = false;
+        break;
+      }
+      shard->keys.push_back(key.ToString());
+      shard->values.push_back(it->value().ToString());
+    }
+    shard->status = it->status();
+  }
+
+  static void AfterChunk(uv_work_t* req) {
+    HandleScope scope;
+    Shard* shard = static_cast<Shard*>(req->data);
+    ParallelScan* scan = shard->scan;
+
+    if (!shard->keys.empty()) {
+      int len = shard->keys.size();
+      Local<Array> keys = Array::New(len);
+      Local<Array> values = Array::New(len);
+      for (int i = 0; i < len; ++i) {
+        keys->Set(i, scan->ToValue(shard->keys[i]));
+        values->Set(i, scan->ToValue(shard->values[i]));
+      }
+
+      Handle<Value> args[] = { keys, values, Integer::New(shard->index) };
+
+      TryCatch tryCatch;
+      scan->onChunk_->Call(Context::GetCurrent()->Global(), 3, args);
+      if (tryCatch.HasCaught()) FatalException(tryCatch);
+    }
+
+    if (!shard->done && shard->status.ok()) {
+      AsyncQueue(&shard->req, shard, ReadChunk, AfterChunk);
+      return;
+    }
+
+    delete shard->it;
+    shard->it = NULL;
+    if (scan->status_.ok()) scan->status_ = shard->status;
+    if (--scan->pending_ == 0) scan->Finish();
+  }
+
+  void Finish() {
+    if (snapshot_ != NULL) self_->db_->ReleaseSnapshot(snapshot_);
+    UnpinSnapshot(pinned_);
+
+    Handle<Value> error = Null();
+    if (!status_.ok())
+      error = Exception::Error(String::New(status_.ToString().c_str()));
+
+    TryCatch tryCatch;
+    Handle<Value> args[] = { error };
+    callback_->Call(Context::GetCurrent()->Global(), 1, args);
+    if (tryCatch.HasCaught()) FatalException(tryCatch);
+
+    self_->Unref();
+    delete this;
+  }
+
+  Handle<Value> ToValue(std::string& value) const {
+    if (!asBuffer_) return ToString(value);
+    std::string* copy = new std::string;
+    copy->swap(value);
+    return ToBuffer(copy);
+  }
+
+  JHandle* self_;
+  uv_work_t req_;
+
+  bool hasStart_;
+  bool hasEnd_;
+  std::string start_;
+  std::string end_;
+  int shards_;
+  size_t chunkSize_;
+  bool asBuffer_;
+
+  leveldb::ReadOptions options_;
+  SnapshotRef* pinned_;                 // The caller's snapshot, if any
+  const leveldb::Snapshot* snapshot_;   // Otherwise one taken by Plan
+  const leveldb::Comparator* comparator_;
+
+  std::vector<Shard> shardList_;
+  size_t pending_;
+  leveldb::Status status_;
+
+  Persistent<Function> onChunk_;
+  Persistent<Function> callback_;
+};
+
+
+
+
+
 void JHandle::Initialize(Handle<Object> target) {
   HandleScope scope;
 
@@ -578,15 +1514,26 @@ void JHandle::Initialize(Handle<Object> target) {
   // Instance methods
   NODE_SET_PROTOTYPE_METHOD(constructor, "get", ReadAsync::Hook);
   NODE_SET_PROTOTYPE_METHOD(constructor, "write", WriteAsync::Hook);
+  NODE_SET_PROTOTYPE_METHOD(constructor, "put", WriteAsync::PutHook);
+  NODE_SET_PROTOTYPE_METHOD(constructor, "del", WriteAsync::DelHook);
   NODE_SET_PROTOTYPE_METHOD(constructor, "iterator", GetIteratorAsync::Hook);
   NODE_SET_PROTOTYPE_METHOD(constructor, "snapshot", GetSnapshotAsync::Hook);
+  NODE_SET_PROTOTYPE_METHOD(constructor, "releaseSnapshot", ReleaseSnapshot);
   NODE_SET_PROTOTYPE_METHOD(constructor, "property", GetPropertyAsync::Hook);
   NODE_SET_PROTOTYPE_METHOD(constructor, "approximateSizes", GetApproximateSizesAsync::Hook);
+  NODE_SET_PROTOTYPE_METHOD(constructor, "warmup", WarmupAsync::Hook);
+  NODE_SET_PROTOTYPE_METHOD(constructor, "ingest", IngestAsync::Hook);
+  NODE_SET_PROTOTYPE_METHOD(constructor, "checkpoint", CheckpointAsync::Hook);
+  NODE_SET_PROTOTYPE_METHOD(constructor, "updatesSince", UpdatesSinceAsync::Hook);
+  NODE_SET_PROTOTYPE_METHOD(constructor, "latestSequence", LatestSequence);
+  NODE_SET_PROTOTYPE_METHOD(constructor, "catchUp", CatchUpAsync::Hook);
+  NODE_SET_PROTOTYPE_METHOD(constructor, "parallelScan", ParallelScan::Hook);
 
   // Static methods
   NODE_SET_METHOD(target, "open", OpenAsync::Hook<OpenAsync>);
   NODE_SET_METHOD(target, "destroy", OpenAsync::Hook<DestroyAsync>);
   NODE_SET_METHOD(target, "repair", OpenAsync::Hook<RepairAsync>);
+  NODE_SET_METHOD(target, "poolStats", PoolStats);
 
   // Set version
   target->Set(String::New("majorVersion"),
@@ -597,18 +1544,45 @@ void JHandle::Initialize(Handle<Object> target) {
               static_cast<PropertyAttribute>(ReadOnly|DontDelete));
 }
 
+// Defined by demo/malloc-count.c when it is preloaded
+#if defined(__GNUC__)
+extern "C" uint64_t node_leveldb_malloc_count() __attribute__((weak));
+#else
+static uint64_t (* const node_leveldb_malloc_count)() = NULL;
+#endif
+
+// Allocation counts of the pooled ops, and of every malloc() in the
+// process if it is counted, for benchmarks
+Handle<Value> JHandle::PoolStats(const Arguments& args) {
+  HandleScope scope;
+  Local<Object> stats = Object::New();
+  stats->Set(String::NewSymbol("read"), OpPool<ReadAsync>::Stats());
+  stats->Set(String::NewSymbol("write"), OpPool<WriteAsync>::Stats());
+  if (node_leveldb_malloc_count != NULL) {
+    stats->Set(String::NewSymbol("mallocs"),
+               Number::New(static_cast<double>(node_leveldb_malloc_count())));
+  }
+  return scope.Close(stats);
+}
+
 Handle<Value> JHandle::New(const Arguments& args) {
   HandleScope scope;
 
-  assert(args.Length() == 2);
+  assert(args.Length() == 5);
   assert(args[0]->IsExternal());
 
   leveldb::DB* db = (leveldb::DB*)External::Unwrap(args[0]);
   JHandle* self = new JHandle(db);
+  self->name_ = *String::Utf8Value(args[3]);
+  self->inMemory_ = args[4]->BooleanValue();
 
   if (args[1]->IsExternal())
     self->comparator_ = Persistent<Value>::New(args[1]);
 
+  if (args[2]->IsExternal())
+    self->filter_ =
+      static_cast<leveldb::CompactionFilter*>(External::Unwrap(args[2]));
+
   self->Wrap(args.This());
 
   return args.This();
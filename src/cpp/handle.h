@@ -6,6 +6,7 @@
 #include <vector>
 #include <string>
 
+#include <leveldb/compaction_filter.h>
 #include <leveldb/db.h>
 #include <node.h>
 #include <v8.h>
@@ -28,6 +29,8 @@ class JHandle : public ObjectWrap {
   }
 
  private:
+  friend class JIterator;
+
   // No instance creation outside of Handle
   JHandle(leveldb::DB* db);
 
@@ -38,6 +41,9 @@ class JHandle : public ObjectWrap {
   virtual ~JHandle();
 
   static Handle<Value> New(const Arguments& args);
+  static Handle<Value> PoolStats(const Arguments& args);
+  static Handle<Value> ReleaseSnapshot(const Arguments& args);
+  static Handle<Value> LatestSequence(const Arguments& args);
 
   class OpAsync;
   class OpenAsync;
@@ -49,9 +55,49 @@ class JHandle : public ObjectWrap {
   class GetSnapshotAsync;
   class GetPropertyAsync;
   class GetApproximateSizesAsync;
+  class WarmupAsync;
+  class IngestAsync;
+  class CheckpointAsync;
+  class UpdatesSinceAsync;
+  class CatchUpAsync;
+  class ParallelScan;
+
+  // A snapshot handed out to JS, wrapped in an External that points
+  // here rather than at the leveldb snapshot, whose address can be reused
+  // once it is released.  The leveldb snapshot is released by
+  // snapshot.release(), or when the wrapper is collected if that never
+  // happens, but only once no read using it is in flight.  The ref itself
+  // lives until the wrapper is collected, so a stale wrapper is always
+  // recognised as released.
+  struct SnapshotRef {
+    JHandle* self;
+    const leveldb::Snapshot* snapshot;  // NULL once released
+    Persistent<Value> handle;           // Empty once collected
+    int pins;
+    bool released;
+  };
+
+  // Read from the snapshot named by the "snapshot" option of "val", if
+  // any, pinning it for the duration of the read.  Returns false if it
+  // has been released or belongs to another handle.
+  bool PinSnapshot(Handle<Value> val, leveldb::ReadOptions& options,
+                   SnapshotRef** ref);
+  static void UnpinSnapshot(SnapshotRef* ref);
+
+  // Release the leveldb snapshot of "ref" now, or once its last pin is
+  // dropped
+  static void DropSnapshot(SnapshotRef* ref);
+
+  // Free "ref" once it is both collected and unpinned
+  static void MaybeDeleteSnapshot(SnapshotRef* ref);
+
+  static void WeakSnapshot(Persistent<Value> object, void* parameter);
 
   leveldb::DB* db_;
+  std::string name_;
+  bool inMemory_;
   Persistent<Value> comparator_;
+  const leveldb::CompactionFilter* filter_;
 };
 
 } // namespace node_leveldb
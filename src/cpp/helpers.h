@@ -17,15 +17,23 @@ using namespace v8;
 
 namespace node_leveldb {
 
+// Queue work with a request owned by the caller.
 static inline Handle<Value> AsyncQueue(
-  void* data, const uv_work_cb async, const uv_after_work_cb after)
+  uv_work_t* req, void* data,
+  const uv_work_cb async, const uv_after_work_cb after)
 {
-  uv_work_t* req = new uv_work_t;
   req->data = data;
   uv_queue_work(uv_default_loop(), req, async, after);
   return Undefined();
 }
 
+// Queue work with a new request, which "after" must delete.
+static inline Handle<Value> AsyncQueue(
+  void* data, const uv_work_cb async, const uv_after_work_cb after)
+{
+  return AsyncQueue(new uv_work_t, data, async, after);
+}
+
 static inline Handle<Value> ThrowTypeError(const char* err) {
   return ThrowException(Exception::TypeError(String::New(err)));
 }
@@ -65,6 +73,66 @@ static inline leveldb::Slice ToSlice(const Handle<Value>& value,
   }
 }
 
+static inline bool IsStringOrBuffer(const Handle<Value>& value) {
+  return value->IsString() || Buffer::HasInstance(value);
+}
+
+// The bytes of a key or value passed from JS as a Buffer or a string.
+// A Buffer is used in place; Retain() keeps it alive for slices that
+// outlive the call.  A string is encoded as UTF-8, into an inline buffer
+// if it is short enough, so that no intermediate Buffer is created.
+class ValueSlice {
+ public:
+  ValueSlice() {}
+  ~ValueSlice() { Clear(); }
+
+  explicit ValueSlice(const Handle<Value>& value) { Assign(value); }
+
+  void Assign(const Handle<Value>& value, bool retain = false) {
+    Clear();
+    if (Buffer::HasInstance(value)) {
+      slice_ = ToSlice(value);
+      if (retain) handle_ = Persistent<Value>::New(value);
+    } else if (value->IsString()) {
+      Local<String> str = value->ToString();
+      int len = str->Utf8Length();
+      char* data = inline_;
+      if (len + 1 > static_cast<int>(sizeof(inline_))) {
+        heap_.resize(len + 1);
+        data = &heap_[0];
+      }
+      str->WriteUtf8(data, len + 1);
+      slice_ = leveldb::Slice(data, len);
+    }
+  }
+
+  void Clear() {
+    if (!handle_.IsEmpty()) {
+      handle_.Dispose();
+      handle_.Clear();
+    }
+    heap_.clear();
+    slice_.clear();
+  }
+
+  const leveldb::Slice& slice() const { return slice_; }
+  operator const leveldb::Slice&() const { return slice_; }
+
+ private:
+  leveldb::Slice slice_;
+  char inline_[128];
+  std::string heap_;
+  Persistent<Value> handle_;
+
+  // No copying allowed
+  ValueSlice(const ValueSlice&);
+  void operator=(const ValueSlice&);
+};
+
+static inline Handle<Value> ToString(const leveldb::Slice& val) {
+  return String::New(val.data(), val.size());
+}
+
 static void FreeString(char* data, void* hint) {
   std::string* str = static_cast<std::string*>(hint);
   delete str;
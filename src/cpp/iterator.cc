@@ -4,6 +4,7 @@
 #include <node.h>
 #include <v8.h>
 
+#include "handle.h"
 #include "helpers.h"
 #include "iterator.h"
 
@@ -15,25 +16,39 @@ Persistent<FunctionTemplate> JIterator::constructor;
 
 
 
-JIterator::JIterator(leveldb::Iterator* it)
+JIterator::JIterator(leveldb::Iterator* it, JHandle* handle)
   : ObjectWrap()
   , it_(it)
+  , handle_(handle)
   , status_(leveldb::Status())
   , key_(leveldb::Slice())
   , value_(leveldb::Slice())
   , busy_(false)
   , valid_(false)
+  , closing_(false)
   , callback_(Persistent<Function>())
-  , keyHandle_(Persistent<Value>())
 {
+  handle_->Ref();
 }
 
+// Only reached if close() was never called
 JIterator::~JIterator() {
-  assert(it_ != NULL);
   assert(callback_.IsEmpty());
-  assert(keyHandle_.IsEmpty());
+  DeleteIterator();
+}
+
+void JIterator::DeleteIterator() {
+  assert(!busy_);
+  if (it_ == NULL) return;
+
   delete it_;
   it_ = NULL;
+  valid_ = false;
+  key_.clear();
+  value_.clear();
+
+  handle_->Unref();
+  handle_ = NULL;
 }
 
 
@@ -54,20 +69,26 @@ void JIterator::Initialize(Handle<Object> target) {
   NODE_SET_PROTOTYPE_METHOD(constructor, "seek", Seek);
   NODE_SET_PROTOTYPE_METHOD(constructor, "next", Next);
   NODE_SET_PROTOTYPE_METHOD(constructor, "prev", Prev);
+  NODE_SET_PROTOTYPE_METHOD(constructor, "key", GetKey);
+  NODE_SET_PROTOTYPE_METHOD(constructor, "value", GetValue);
+  NODE_SET_PROTOTYPE_METHOD(constructor, "close", Close);
 }
 
 Handle<Value> JIterator::New(const Arguments& args) {
   HandleScope scope;
 
-  assert(args.Length() == 1);
+  assert(args.Length() == 2);
   assert(args[0]->IsExternal());
+  assert(args[1]->IsExternal());
 
   leveldb::Iterator* it =
     static_cast<leveldb::Iterator*>(External::Unwrap(args[0]));
+  JHandle* handle = static_cast<JHandle*>(External::Unwrap(args[1]));
 
   assert(it);
+  assert(handle);
 
-  JIterator* iterator = new JIterator(it);
+  JIterator* iterator = new JIterator(it, handle);
   iterator->Wrap(args.This());
 
   return args.This();
@@ -78,9 +99,11 @@ Handle<Value> JIterator::New(const Arguments& args) {
 
 
 Handle<Value> JIterator::Async(const uv_work_cb fn, const Local<Value>& callback) {
-  assert(!busy_);
   assert(callback->IsFunction());
 
+  if (it_ == NULL || closing_) return ThrowError("Iterator has been closed");
+  assert(!busy_);
+
   Local<Function> cb = Local<Function>::Cast(callback);
   callback_ = Persistent<Function>::New(cb);
   assert(!callback_.IsEmpty());
@@ -100,33 +123,28 @@ void JIterator::AfterAsync(uv_work_t* req) {
 
   Handle<Value> error = Null();
   Handle<Value> valid = self->valid_ ? True() : False();
-  Handle<Value> key = Null();
-  Handle<Value> value = Null();
 
   if (!self->status_.ok())
     error = Exception::Error(String::New(self->status_.ToString().c_str()));
 
-  if (self->valid_) {
-    if (!self->key_.empty()) key = ToBuffer(self->key_);
-    if (!self->value_.empty()) value = ToBuffer(self->value_);
-  }
-
   Persistent<Function> callback = self->callback_;
 
   self->callback_.Clear();
-  self->keyHandle_.Dispose();
-  self->keyHandle_.Clear();
+  self->target_.Clear();
   self->Unref();
 
   self->busy_ = false;
 
+  // The key and value are fetched with key() and value() as needed
   TryCatch tryCatch;
-  Handle<Value> args[] = { error, valid, key, value };
-  callback->Call(Context::GetCurrent()->Global(), 4, args);
+  Handle<Value> args[] = { error, valid };
+  callback->Call(Context::GetCurrent()->Global(), 2, args);
   if (tryCatch.HasCaught()) FatalException(tryCatch);
 
   callback.Dispose();
   delete req;
+
+  if (self->closing_ && !self->busy_) self->DeleteIterator();
 }
 
 
@@ -170,17 +188,17 @@ Handle<Value> JIterator::Seek(const Arguments& args) {
   HandleScope scope;
 
   assert(args.Length() == 2);
-  assert(Buffer::HasInstance(args[0]));
+  assert(IsStringOrBuffer(args[0]));
   assert(args[1]->IsFunction());
 
   JIterator* self = ObjectWrap::Unwrap<JIterator>(args.This());
-  self->key_ = ToSlice(args[0], self->keyHandle_);
+  self->target_.Assign(args[0], true);
   return self->Async(SeekAsync, args[1]);
 }
 
 void JIterator::SeekAsync(uv_work_t* req) {
   JIterator* self = static_cast<JIterator*>(req->data);
-  const leveldb::Slice target = self->key_;
+  const leveldb::Slice target = self->target_;
   self->BeforeSeek();
   self->it_->Seek(target);
   self->AfterSeek();
@@ -248,4 +266,39 @@ void JIterator::PrevAsync(uv_work_t* req) {
   self->AfterSeek();
 }
 
+Handle<Value> JIterator::GetKey(const Arguments& args) {
+  HandleScope scope;
+
+  JIterator* self = ObjectWrap::Unwrap<JIterator>(args.This());
+  if (self->busy_ || !self->valid_ || self->key_.empty()) return Null();
+
+  if (args[0]->BooleanValue()) return scope.Close(ToBuffer(self->key_));
+  return scope.Close(ToString(self->key_));
+}
+
+Handle<Value> JIterator::GetValue(const Arguments& args) {
+  HandleScope scope;
+
+  JIterator* self = ObjectWrap::Unwrap<JIterator>(args.This());
+  if (self->busy_ || !self->valid_ || self->value_.empty()) return Null();
+
+  if (args[0]->BooleanValue()) return scope.Close(ToBuffer(self->value_));
+  return scope.Close(ToString(self->value_));
+}
+
+// Release the iterator now rather than when the wrapper is collected.
+// An operation in flight completes first.
+Handle<Value> JIterator::Close(const Arguments& args) {
+  HandleScope scope;
+
+  JIterator* self = ObjectWrap::Unwrap<JIterator>(args.This());
+  if (self->busy_) {
+    self->closing_ = true;
+  } else {
+    self->DeleteIterator();
+  }
+
+  return Undefined();
+}
+
 } // node_leveldb
@@ -5,6 +5,8 @@
 #include <node.h>
 #include <v8.h>
 
+#include "helpers.h"
+
 using namespace v8;
 using namespace node;
 
@@ -27,6 +29,9 @@ class JIterator : ObjectWrap {
   static Handle<Value> SeekToLast(const Arguments& args);
   static Handle<Value> Next(const Arguments& args);
   static Handle<Value> Prev(const Arguments& args);
+  static Handle<Value> GetKey(const Arguments& args);
+  static Handle<Value> GetValue(const Arguments& args);
+  static Handle<Value> Close(const Arguments& args);
 
   static void SeekToFirstAsync(uv_work_t* req);
   static void SeekToLastAsync(uv_work_t* req);
@@ -42,8 +47,11 @@ class JIterator : ObjectWrap {
   void BeforeSeek();
   void AfterSeek();
 
+  // Delete the iterator and drop the reference to the handle
+  void DeleteIterator();
+
   // No instance creation outside of Handle
-  JIterator(leveldb::Iterator* it);
+  JIterator(leveldb::Iterator* it, JHandle* handle);
 
   // No copying allowed
   JIterator(const JIterator&);
@@ -51,16 +59,20 @@ class JIterator : ObjectWrap {
 
   virtual ~JIterator();
 
-  leveldb::Iterator* it_;
+  leveldb::Iterator* it_;     // NULL once closed
+  JHandle* handle_;
   leveldb::Status status_;
   leveldb::Slice key_;
   leveldb::Slice value_;
 
   bool busy_;
   bool valid_;
+  bool closing_;   // close() was called while busy
+
+  // Seek target, valid while a seek is in progress
+  ValueSlice target_;
 
   Persistent<Function> callback_;
-  Persistent<Value> keyHandle_;
 };
 
 } // node_leveldb
@@ -0,0 +1,201 @@
+#include <string.h>
+
+#include <string>
+
+#include <leveldb/slice.h>
+#include <node.h>
+#include <node_buffer.h>
+#include <v8.h>
+
+#include "helpers.h"
+#include "keys.h"
+
+namespace node_leveldb {
+
+static const char kNull = 0x01;
+static const char kNumber = 0x10;
+static const char kString = 0x20;
+static const char kBuffer = 0x30;
+
+void KeyCodec::Initialize(Handle<Object> target) {
+  HandleScope scope;
+  NODE_SET_METHOD(target, "encodeKey", Encode);
+  NODE_SET_METHOD(target, "decodeKey", Decode);
+}
+
+static void EncodeBytes(const char* data, size_t len, std::string* dst) {
+  for (const char* end = data + len; data < end; ) {
+    const char* zero = static_cast<const char*>(memchr(data, 0, end - data));
+    if (zero == NULL) {
+      dst->append(data, end - data);
+      break;
+    }
+    dst->append(data, zero - data + 1);
+    dst->push_back('\xff');
+    data = zero + 1;
+  }
+  dst->push_back('\x00');
+  dst->push_back('\x01');
+}
+
+static void EncodeNumber(double value, std::string* dst) {
+  // Zeros compare equal, and every NaN sorts after infinity
+  if (value == 0) value = 0;
+  uint64_t bits;
+  if (value != value) {
+    bits = 0x7ff8000000000000ull;
+  } else {
+    memcpy(&bits, &value, sizeof(bits));
+  }
+  bits = (bits & 0x8000000000000000ull) ? ~bits
+                                        : bits | 0x8000000000000000ull;
+  for (int shift = 56; shift >= 0; shift -= 8) {
+    dst->push_back(static_cast<char>(bits >> shift));
+  }
+}
+
+bool KeyCodec::EncodeValue(Handle<Value> value, bool descending,
+                           std::string* dst) {
+  const size_t start = dst->size();
+
+  if (value->IsNull() || value->IsUndefined()) {
+    dst->push_back(kNull);
+  } else if (value->IsNumber()) {
+    dst->push_back(kNumber);
+    EncodeNumber(value->NumberValue(), dst);
+  } else if (value->IsString()) {
+    String::Utf8Value str(value);
+    dst->push_back(kString);
+    EncodeBytes(*str, str.length(), dst);
+  } else if (Buffer::HasInstance(value)) {
+    leveldb::Slice buf = ToSlice(value);
+    dst->push_back(kBuffer);
+    EncodeBytes(buf.data(), buf.size(), dst);
+  } else {
+    return false;
+  }
+
+  if (descending) {
+    for (size_t i = start; i < dst->size(); ++i) (*dst)[i] = ~(*dst)[i];
+  }
+  return true;
+}
+
+Handle<Value> KeyCodec::Encode(const Arguments& args) {
+  HandleScope scope;
+
+  if (args.Length() != 1 || !args[0]->IsArray())
+    return ThrowTypeError("Invalid arguments");
+
+  static const Persistent<String> kDesc = NODE_PSYMBOL("desc");
+
+  Local<Array> array = Local<Array>::Cast(args[0]);
+  uint32_t len = array->Length();
+
+  std::string key;
+  for (uint32_t i = 0; i < len; ++i) {
+    Local<Value> value = array->Get(i);
+    bool descending = false;
+
+    // {desc: value} sorts in reverse
+    if (value->IsObject() && !Buffer::HasInstance(value)) {
+      Local<Object> obj = value->ToObject();
+      if (!obj->Has(kDesc)) return ThrowTypeError("Invalid key element");
+      value = obj->Get(kDesc);
+      descending = true;
+    }
+
+    if (!EncodeValue(value, descending, &key))
+      return ThrowTypeError("Invalid key element");
+  }
+
+  Buffer* buf = Buffer::New(key.data(), key.size());
+  return scope.Close(buf->handle_);
+}
+
+// Decode escaped bytes up to the end marker, inverting them first if
+// "mask" is 0xff
+static bool DecodeBytes(leveldb::Slice* input, unsigned char mask,
+                        std::string* dst) {
+  const unsigned char* p =
+    reinterpret_cast<const unsigned char*>(input->data());
+  const unsigned char* end = p + input->size();
+  while (p + 1 < end) {
+    unsigned char c = *p++ ^ mask;
+    if (c != 0) {
+      dst->push_back(static_cast<char>(c));
+      continue;
+    }
+    unsigned char next = *p++ ^ mask;
+    if (next == 0x01) {
+      input->remove_prefix(reinterpret_cast<const char*>(p) - input->data());
+      return true;
+    }
+    if (next != 0xff) return false;
+    dst->push_back('\x00');
+  }
+  return false;
+}
+
+Handle<Value> KeyCodec::DecodeValue(leveldb::Slice* input) {
+  const unsigned char tag = (*input)[0];
+  const bool descending = (tag & 0x80) != 0;
+  const unsigned char mask = descending ? 0xff : 0x00;
+  input->remove_prefix(1);
+
+  switch (tag ^ mask) {
+    case kNull:
+      return Null();
+
+    case kNumber: {
+      if (input->size() < 8) break;
+      uint64_t bits = 0;
+      for (int i = 0; i < 8; ++i) {
+        bits = (bits << 8) | (static_cast<unsigned char>((*input)[i]) ^ mask);
+      }
+      input->remove_prefix(8);
+      bits = (bits & 0x8000000000000000ull) ? bits & ~0x8000000000000000ull
+                                            : ~bits;
+      double value;
+      memcpy(&value, &bits, sizeof(value));
+      return Number::New(value);
+    }
+
+    case kString: {
+      std::string str;
+      if (!DecodeBytes(input, mask, &str)) break;
+      return String::New(str.data(), str.size());
+    }
+
+    case kBuffer: {
+      std::string* buf = new std::string;
+      if (!DecodeBytes(input, mask, buf)) {
+        delete buf;
+        break;
+      }
+      return ToBuffer(buf);
+    }
+  }
+
+  return Handle<Value>();
+}
+
+Handle<Value> KeyCodec::Decode(const Arguments& args) {
+  HandleScope scope;
+
+  if (args.Length() != 1 || !Buffer::HasInstance(args[0]))
+    return ThrowTypeError("Invalid arguments");
+
+  leveldb::Slice input = ToSlice(args[0]);
+
+  Local<Array> array = Array::New();
+  for (uint32_t i = 0; !input.empty(); ++i) {
+    Handle<Value> value = DecodeValue(&input);
+    if (value.IsEmpty()) return ThrowError("Invalid key");
+    array->Set(i, value);
+  }
+
+  return scope.Close(array);
+}
+
+} // namespace node_leveldb
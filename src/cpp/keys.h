@@ -0,0 +1,54 @@
+#ifndef NODE_LEVELDB_KEYS_H_
+#define NODE_LEVELDB_KEYS_H_
+
+#include <string>
+
+#include <leveldb/slice.h>
+#include <node.h>
+#include <v8.h>
+
+using namespace v8;
+using namespace node;
+
+namespace node_leveldb {
+
+/**
+
+    Key codec encodes tuples of values into keys whose bytewise order is
+    the order of the tuples, so composite keys need no custom comparator.
+
+    Each element starts with a type tag, and types sort in tag order:
+
+      0x01  null
+      0x10  number, as 8 big-endian bytes of the IEEE 754 double with the
+            sign bit flipped, or every bit if negative
+      0x20  string, as UTF-8, and
+      0x30  buffer, with each 0x00 byte escaped as 0x00 0xff and the
+            end marked by 0x00 0x01
+
+    A descending element is encoded the same way with every byte
+    inverted, tag included.  Encodings are prefix-free, so the encoding
+    of a tuple is a prefix of the encodings of the tuples it starts.
+
+ */
+
+class KeyCodec {
+ public:
+  static void Initialize(Handle<Object> target);
+
+  static Handle<Value> Encode(const Arguments& args);
+  static Handle<Value> Decode(const Arguments& args);
+
+ private:
+  // Append the encoding of "value", or return false if it has no type
+  static bool EncodeValue(Handle<Value> value, bool descending,
+                          std::string* dst);
+
+  // Decode the element at the start of *input and advance past it, or
+  // return an empty handle if it is malformed
+  static Handle<Value> DecodeValue(leveldb::Slice* input);
+};
+
+} // node_leveldb
+
+#endif // NODE_LEVELDB_KEYS_H_
@@ -2,8 +2,12 @@
 #define NODE_LEVELDB_OPTIONS_H_
 
 #include <assert.h>
+#include <string.h>
 
+#include <leveldb/compaction_filter.h>
 #include <leveldb/comparator.h>
+#include <leveldb/env.h>
+#include <leveldb/merge_operator.h>
 #include <leveldb/options.h>
 #include <node.h>
 #include <v8.h>
@@ -13,23 +17,41 @@ using namespace v8;
 
 namespace node_leveldb {
 
-static void UnpackOptions(
+// The environment of databases opened with in_memory
+leveldb::Env* InMemoryEnv();
+
+// The caller owns options.compaction_filter, if one is created.  Returns
+// false, with a TypeError thrown, if an option is not recognised.
+static bool UnpackOptions(
   Handle<Value> val, leveldb::Options& options,
   Persistent<Value>* comp = NULL)
 {
   HandleScope scope;
-  if (!val->IsObject()) return;
+  if (!val->IsObject()) return true;
   Local<Object> obj = val->ToObject();
 
   static const Persistent<String> kCreateIfMissing = NODE_PSYMBOL("create_if_missing");
   static const Persistent<String> kErrorIfExists = NODE_PSYMBOL("error_if_exists");
   static const Persistent<String> kParanoidChecks = NODE_PSYMBOL("paranoid_checks");
+  static const Persistent<String> kReadOnly = NODE_PSYMBOL("read_only");
   static const Persistent<String> kWriteBufferSize = NODE_PSYMBOL("write_buffer_size");
+  static const Persistent<String> kAllowConcurrentMemtableWrite = NODE_PSYMBOL("allow_concurrent_memtable_write");
+  static const Persistent<String> kArenaBlockSize = NODE_PSYMBOL("arena_block_size");
+  static const Persistent<String> kMemtableHugePages = NODE_PSYMBOL("memtable_huge_pages");
+  static const Persistent<String> kMaxImmutableMemtables = NODE_PSYMBOL("max_immutable_memtables");
+  static const Persistent<String> kMaxImmutableMemtableBytes = NODE_PSYMBOL("max_immutable_memtable_bytes");
+  static const Persistent<String> kMaxSubcompactions = NODE_PSYMBOL("max_subcompactions");
   static const Persistent<String> kMaxOpenFiles = NODE_PSYMBOL("max_open_files");
   static const Persistent<String> kBlockSize = NODE_PSYMBOL("block_size");
   static const Persistent<String> kBlockRestartInterval = NODE_PSYMBOL("block_restart_interval");
   static const Persistent<String> kCompression = NODE_PSYMBOL("compression");
   static const Persistent<String> kComparator = NODE_PSYMBOL("comparator");
+  static const Persistent<String> kMergeOperator = NODE_PSYMBOL("merge_operator");
+  static const Persistent<String> kTtl = NODE_PSYMBOL("ttl");
+  static const Persistent<String> kTtlPrefix = NODE_PSYMBOL("ttl_prefix");
+  static const Persistent<String> kHideExpired = NODE_PSYMBOL("hide_expired");
+  static const Persistent<String> kInMemory = NODE_PSYMBOL("in_memory");
+  static const Persistent<String> kLogRetentionBytes = NODE_PSYMBOL("log_retention_bytes");
   /*
   static const Persistent<String> kInfoLog = NODE_PSYMBOL("info_log");
   */
@@ -43,9 +65,30 @@ static void UnpackOptions(
   if (obj->Has(kParanoidChecks))
     options.paranoid_checks = obj->Get(kParanoidChecks)->BooleanValue();
 
+  if (obj->Has(kReadOnly))
+    options.read_only = obj->Get(kReadOnly)->BooleanValue();
+
   if (obj->Has(kWriteBufferSize))
     options.write_buffer_size = obj->Get(kWriteBufferSize)->Int32Value();
 
+  if (obj->Has(kAllowConcurrentMemtableWrite))
+    options.allow_concurrent_memtable_write = obj->Get(kAllowConcurrentMemtableWrite)->BooleanValue();
+
+  if (obj->Has(kArenaBlockSize))
+    options.arena_block_size = obj->Get(kArenaBlockSize)->Int32Value();
+
+  if (obj->Has(kMemtableHugePages))
+    options.memtable_huge_pages = obj->Get(kMemtableHugePages)->BooleanValue();
+
+  if (obj->Has(kMaxImmutableMemtables))
+    options.max_immutable_memtables = obj->Get(kMaxImmutableMemtables)->Int32Value();
+
+  if (obj->Has(kMaxImmutableMemtableBytes))
+    options.max_immutable_memtable_bytes = obj->Get(kMaxImmutableMemtableBytes)->Int32Value();
+
+  if (obj->Has(kMaxSubcompactions))
+    options.max_subcompactions = obj->Get(kMaxSubcompactions)->Int32Value();
+
   if (obj->Has(kMaxOpenFiles))
     options.max_open_files = obj->Get(kMaxOpenFiles)->Int32Value();
 
@@ -69,10 +112,42 @@ static void UnpackOptions(
     }
   }
 
+  if (obj->Has(kMergeOperator)) {
+    String::Utf8Value name(obj->Get(kMergeOperator));
+    if (strcmp(*name, "uint64add") == 0)
+      options.merge_operator = leveldb::UInt64AddOperator();
+    else if (strcmp(*name, "max") == 0)
+      options.merge_operator = leveldb::UInt64MaxOperator();
+    else if (strcmp(*name, "append") == 0)
+      options.merge_operator = leveldb::AppendOperator();
+    else {
+      ThrowTypeError("Unknown merge_operator");
+      return false;
+    }
+  }
+
+  if (obj->Has(kTtl)) {
+    bool prefix = obj->Has(kTtlPrefix) && obj->Get(kTtlPrefix)->BooleanValue();
+    options.compaction_filter = leveldb::NewTTLFilter(
+      leveldb::Env::Default(), obj->Get(kTtl)->Uint32Value(), prefix);
+  }
+
+  if (obj->Has(kHideExpired))
+    options.compaction_filter_on_read = obj->Get(kHideExpired)->BooleanValue();
+
+  if (obj->Has(kInMemory) && obj->Get(kInMemory)->BooleanValue())
+    options.env = InMemoryEnv();
+
+  if (obj->Has(kLogRetentionBytes))
+    options.log_retention_bytes =
+      static_cast<uint64_t>(obj->Get(kLogRetentionBytes)->NumberValue());
+
   /*
   if (obj->Has(kInfoLog))
     options.info_log = NULL;
   */
+
+  return true;
 }
 
 static void UnpackReadOptions(Handle<Value> val, leveldb::ReadOptions& options) {
@@ -80,17 +155,9 @@ static void UnpackReadOptions(Handle<Value> val, leveldb::ReadOptions& options)
   if (!val->IsObject()) return;
   Local<Object> obj = val->ToObject();
 
-  static const Persistent<String> kSnapshot = NODE_PSYMBOL("snapshot");
   static const Persistent<String> kVerifyChecksums = NODE_PSYMBOL("verify_checksums");
   static const Persistent<String> kFillCache = NODE_PSYMBOL("fill_cache");
-
-  if (obj->Has(kSnapshot)) {
-    Local<Value> ext = obj->Get(kSnapshot);
-    if (ext->IsExternal()) {
-      options.snapshot =
-        static_cast<leveldb::Snapshot*>(External::Unwrap(ext));
-    }
-  }
+  static const Persistent<String> kReadaheadSize = NODE_PSYMBOL("readahead_size");
 
   if (obj->Has(kVerifyChecksums))
     options.verify_checksums = obj->Get(kVerifyChecksums)->BooleanValue();
@@ -98,6 +165,48 @@ static void UnpackReadOptions(Handle<Value> val, leveldb::ReadOptions& options)
   if (obj->Has(kFillCache))
     options.fill_cache = obj->Get(kFillCache)->BooleanValue();
 
+  if (obj->Has(kReadaheadSize))
+    options.readahead_size = obj->Get(kReadaheadSize)->Uint32Value();
+
+}
+
+static bool UnpackAsBuffer(Handle<Value> val) {
+  HandleScope scope;
+  if (!val->IsObject()) return false;
+  Local<Object> obj = val->ToObject();
+
+  static const Persistent<String> kAsBuffer = NODE_PSYMBOL("as_buffer");
+
+  return obj->Has(kAsBuffer) && obj->Get(kAsBuffer)->BooleanValue();
+}
+
+static void UnpackWarmupOptions(Handle<Value> val, int& levels,
+                                uint64_t& maxBytes) {
+  HandleScope scope;
+  if (!val->IsObject()) return;
+  Local<Object> obj = val->ToObject();
+
+  static const Persistent<String> kLevels = NODE_PSYMBOL("levels");
+  static const Persistent<String> kMaxBytes = NODE_PSYMBOL("max_bytes");
+
+  if (obj->Has(kLevels))
+    levels = obj->Get(kLevels)->Int32Value();
+
+  if (obj->Has(kMaxBytes))
+    maxBytes = static_cast<uint64_t>(obj->Get(kMaxBytes)->NumberValue());
+
+}
+
+static void UnpackUpdatesOptions(Handle<Value> val, size_t& maxBytes) {
+  HandleScope scope;
+  if (!val->IsObject()) return;
+  Local<Object> obj = val->ToObject();
+
+  static const Persistent<String> kMaxBytes = NODE_PSYMBOL("max_bytes");
+
+  if (obj->Has(kMaxBytes))
+    maxBytes = static_cast<size_t>(obj->Get(kMaxBytes)->NumberValue());
+
 }
 
 static void UnpackWriteOptions(Handle<Value> val, leveldb::WriteOptions& options) {
@@ -0,0 +1,150 @@
+#ifndef NODE_LEVELDB_PARTITION_LAYOUT_H_
+#define NODE_LEVELDB_PARTITION_LAYOUT_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <leveldb/slice.h>
+
+namespace node_leveldb {
+
+/**
+
+    The compare kernel of PartitionedBitwiseComparator, kept free of node
+    and v8 so that demo/comparator-bench.cc can time it as it is built.
+
+    Compare() runs on every memtable insert, block seek and merge step, so
+    keys are compared a word at a time over their whole common prefix, and
+    the direction of the partition holding the first differing byte is
+    read from a table indexed by its offset, built up front.
+
+ */
+
+class PartitionLayout {
+ public:
+  explicit PartitionLayout(
+    const std::vector< std::pair<uint32_t, bool> >& partitions);
+
+  int Compare(const leveldb::Slice& a, const leveldb::Slice& b) const;
+
+ private:
+  // Longest key prefix whose directions are looked up in a table
+  enum { kMaxTable = 256 };
+
+  // Direction of the partition holding byte "limit - 1", or of the first
+  // partition if "limit" is 0
+  bool ReverseBefore(size_t limit) const;
+
+  // End offset of each partition up to the first zero length one, which
+  // covers the rest of the key
+  std::vector<size_t> ends_;
+
+  // Direction of each partition and, after them, of the bytes past the
+  // last one; bytes rather than vector<bool> bits, which are slow to read
+  std::vector<unsigned char> reverse_;
+
+  // ReverseBefore() of every limit below the end of the last sized
+  // partition, up to kMaxTable, so that the usual call is a single load
+  // whatever the number of partitions
+  std::vector<unsigned char> table_;
+
+  // True if every partition has the same direction
+  bool uniform_;
+};
+
+inline PartitionLayout::PartitionLayout(
+  const std::vector< std::pair<uint32_t, bool> >& partitions)
+  : uniform_(true)
+{
+  size_t end = 0;
+  bool last_reverse = false;
+  std::vector< std::pair<uint32_t, bool> >::const_iterator part;
+  for (part = partitions.begin(); part < partitions.end(); ++part) {
+    if (part->first == 0) {
+      end = std::numeric_limits<size_t>::max();
+    } else {
+      end += part->first;
+    }
+    if (!reverse_.empty() && reverse_.back() != part->second) uniform_ = false;
+    ends_.push_back(end);
+    reverse_.push_back(part->second);
+    last_reverse = part->second;
+    if (part->first == 0) break;
+  }
+
+  reverse_.push_back(last_reverse);
+
+  // past the last sized partition the direction no longer changes
+  size_t sized = 0;
+  for (size_t i = 0; i < ends_.size(); ++i) {
+    if (ends_[i] != std::numeric_limits<size_t>::max()) sized = ends_[i];
+  }
+  const size_t table = std::min<size_t>(sized + 1, kMaxTable);
+  for (size_t limit = 0; limit < table; ++limit) {
+    const size_t i =
+      std::lower_bound(ends_.begin(), ends_.end(), limit) - ends_.begin();
+    table_.push_back(reverse_[i]);
+  }
+}
+
+inline bool PartitionLayout::ReverseBefore(size_t limit) const {
+  if (limit < table_.size()) return table_[limit] != 0;
+
+  // the partition ending at or after limit, if any
+  size_t i = std::lower_bound(ends_.begin(), ends_.end(), limit) -
+             ends_.begin();
+  return reverse_[i] != 0;
+}
+
+// Index of the first byte that differs in a[0, n) and b[0, n), or n
+static inline size_t FirstDifference(const char* a, const char* b, size_t n) {
+  size_t i = 0;
+
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && \
+    __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  // compare a word at a time; the lowest differing bit of the first
+  // differing words is in the first differing byte
+  for (; i + 8 <= n; i += 8) {
+    uint64_t x, y;
+    memcpy(&x, a + i, sizeof(x));
+    memcpy(&y, b + i, sizeof(y));
+    if (x != y) return i + (__builtin_ctzll(x ^ y) >> 3);
+  }
+#endif
+
+  while (i < n && a[i] == b[i]) ++i;
+  return i;
+}
+
+inline int PartitionLayout::Compare(
+  const leveldb::Slice& a, const leveldb::Slice& b) const
+{
+  const size_t n = std::min(a.size(), b.size());
+  const size_t i = FirstDifference(a.data(), b.data(), n);
+
+  int comp;
+  size_t limit;
+  if (i < n) {
+    comp = static_cast<int>(static_cast<uint8_t>(a[i])) -
+           static_cast<int>(static_cast<uint8_t>(b[i]));
+    limit = i + 1;
+  } else if (a.size() != b.size()) {
+    // a key sorts by direction of the partition it ends in
+    comp = a.size() < b.size() ? -1 : +1;
+    limit = n;
+  } else {
+    return 0;
+  }
+
+  const bool reverse = uniform_ ? reverse_[0] != 0 : ReverseBefore(limit);
+  return reverse ? -comp : comp;
+}
+
+} // node_leveldb
+
+#endif // NODE_LEVELDB_PARTITION_LAYOUT_H_
@@ -0,0 +1,234 @@
+#include <assert.h>
+
+#include <leveldb/table_file_writer.h>
+#include <node.h>
+#include <node_buffer.h>
+#include <v8.h>
+
+#include "helpers.h"
+#include "options.h"
+#include "table_writer.h"
+
+namespace node_leveldb {
+
+Persistent<FunctionTemplate> JTableWriter::constructor;
+
+static void DisposeAll(std::vector< Persistent<Value> >& buffers) {
+  std::vector< Persistent<Value> >::iterator it;
+  for (it = buffers.begin(); it < buffers.end(); ++it) it->Dispose();
+  buffers.clear();
+}
+
+
+
+
+
+JTableWriter::JTableWriter(const std::string& path,
+                           const leveldb::Options& options)
+  : ObjectWrap()
+  , writer_(options)
+  , path_(path)
+  , status_(leveldb::Status())
+  , opened_(false)
+  , finished_(false)
+  , busy_(false)
+  , callback_(Persistent<Function>())
+  , comparator_(Persistent<Value>())
+{
+}
+
+JTableWriter::~JTableWriter() {
+  assert(!busy_);
+  assert(callback_.IsEmpty());
+  DisposeAll(pendingBuffers_);
+  if (!comparator_.IsEmpty()) comparator_.Dispose();
+}
+
+
+
+
+
+
+void JTableWriter::Initialize(Handle<Object> target) {
+  HandleScope scope;
+
+  Local<FunctionTemplate> t = FunctionTemplate::New(New);
+  constructor = Persistent<FunctionTemplate>::New(t);
+  constructor->InstanceTemplate()->SetInternalFieldCount(1);
+  constructor->SetClassName(String::NewSymbol("TableWriter"));
+
+  NODE_SET_PROTOTYPE_METHOD(constructor, "put", Put);
+  NODE_SET_PROTOTYPE_METHOD(constructor, "flush", Flush);
+  NODE_SET_PROTOTYPE_METHOD(constructor, "finish", Finish);
+
+  target->Set(String::NewSymbol("TableWriter"), constructor->GetFunction());
+}
+
+Handle<Value> JTableWriter::New(const Arguments& args) {
+  HandleScope scope;
+
+  if (args.Length() < 1 || !args[0]->IsString())
+    return ThrowTypeError("Invalid arguments");
+
+  String::Utf8Value path(args[0]);
+
+  Persistent<Value> comparator;
+  leveldb::Options options;
+  if (!UnpackOptions(args[1], options, &comparator)) {
+    comparator.Dispose();
+    return Undefined();
+  }
+  delete options.compaction_filter;
+
+  JTableWriter* writer = new JTableWriter(*path, options);
+  writer->comparator_ = comparator;
+  writer->Wrap(args.This());
+
+  return args.This();
+}
+
+
+
+
+
+Handle<Value> JTableWriter::Async(const uv_work_cb fn,
+                                  const Local<Value>& callback) {
+  assert(!busy_);
+  assert(callback->IsFunction());
+
+  Local<Function> cb = Local<Function>::Cast(callback);
+  callback_ = Persistent<Function>::New(cb);
+
+  // Entries put while the worker runs are written by the next call
+  writing_.swap(pending_);
+  writingBuffers_.swap(pendingBuffers_);
+
+  busy_ = true;
+  Ref();
+
+  return AsyncQueue(this, fn, AfterAsync);
+}
+
+void JTableWriter::AfterAsync(uv_work_t* req) {
+  HandleScope scope;
+  JTableWriter* self = static_cast<JTableWriter*>(req->data);
+
+  assert(self->busy_);
+  assert(!self->callback_.IsEmpty());
+
+  self->writing_.clear();
+  DisposeAll(self->writingBuffers_);
+
+  Handle<Value> error = Null();
+  if (!self->status_.ok())
+    error = Exception::Error(String::New(self->status_.ToString().c_str()));
+
+  Handle<Value> entries =
+    Number::New(static_cast<double>(self->writer_.NumEntries()));
+  Handle<Value> size =
+    Number::New(static_cast<double>(self->writer_.FileSize()));
+
+  Persistent<Function> callback = self->callback_;
+
+  self->callback_.Clear();
+  self->Unref();
+
+  self->busy_ = false;
+
+  TryCatch tryCatch;
+  Handle<Value> args[] = { error, entries, size };
+  callback->Call(Context::GetCurrent()->Global(), 3, args);
+  if (tryCatch.HasCaught()) FatalException(tryCatch);
+
+  callback.Dispose();
+  delete req;
+}
+
+void JTableWriter::WriteEntries() {
+  if (!status_.ok()) return;
+
+  if (finished_) {
+    if (!writing_.empty())
+      status_ = leveldb::Status::InvalidArgument("Table already finished");
+    return;
+  }
+
+  if (!opened_) {
+    status_ = writer_.Open(path_);
+    if (!status_.ok()) return;
+    opened_ = true;
+  }
+
+  Entries::const_iterator it;
+  for (it = writing_.begin(); it < writing_.end() && status_.ok(); ++it)
+    status_ = writer_.Add(it->first, it->second);
+}
+
+
+
+
+
+Handle<Value> JTableWriter::Put(const Arguments& args) {
+  HandleScope scope;
+
+  if (args.Length() != 2 ||
+      !Buffer::HasInstance(args[0]) || !Buffer::HasInstance(args[1]))
+    return ThrowTypeError("Invalid arguments");
+
+  JTableWriter* self = ObjectWrap::Unwrap<JTableWriter>(args.This());
+
+  leveldb::Slice key = ToSlice(args[0], self->pendingBuffers_);
+  leveldb::Slice val = ToSlice(args[1], self->pendingBuffers_);
+
+  self->pending_.push_back(std::make_pair(key, val));
+
+  return Undefined();
+}
+
+
+
+
+
+Handle<Value> JTableWriter::Flush(const Arguments& args) {
+  HandleScope scope;
+
+  if (args.Length() != 1 || !args[0]->IsFunction())
+    return ThrowTypeError("Invalid arguments");
+
+  JTableWriter* self = ObjectWrap::Unwrap<JTableWriter>(args.This());
+  if (self->busy_) return ThrowError("Concurrent operations not supported");
+
+  return self->Async(FlushAsync, args[0]);
+}
+
+void JTableWriter::FlushAsync(uv_work_t* req) {
+  JTableWriter* self = static_cast<JTableWriter*>(req->data);
+  self->WriteEntries();
+}
+
+
+
+
+
+Handle<Value> JTableWriter::Finish(const Arguments& args) {
+  HandleScope scope;
+
+  if (args.Length() != 1 || !args[0]->IsFunction())
+    return ThrowTypeError("Invalid arguments");
+
+  JTableWriter* self = ObjectWrap::Unwrap<JTableWriter>(args.This());
+  if (self->busy_) return ThrowError("Concurrent operations not supported");
+
+  return self->Async(FinishAsync, args[0]);
+}
+
+void JTableWriter::FinishAsync(uv_work_t* req) {
+  JTableWriter* self = static_cast<JTableWriter*>(req->data);
+  self->WriteEntries();
+  if (self->status_.ok() && !self->finished_) {
+    self->status_ = self->writer_.Finish();
+    self->finished_ = true;
+  }
+}
+
+} // node_leveldb
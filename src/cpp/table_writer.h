@@ -0,0 +1,72 @@
+#ifndef NODE_LEVELDB_TABLE_WRITER_H_
+#define NODE_LEVELDB_TABLE_WRITER_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <leveldb/slice.h>
+#include <leveldb/status.h>
+#include <leveldb/table_file_writer.h>
+#include <node.h>
+#include <v8.h>
+
+using namespace v8;
+using namespace node;
+
+namespace node_leveldb {
+
+class JTableWriter : ObjectWrap {
+ public:
+  static Persistent<FunctionTemplate> constructor;
+  static void Initialize(Handle<Object> target);
+
+ private:
+  typedef std::vector< std::pair<leveldb::Slice, leveldb::Slice> > Entries;
+
+  static Handle<Value> New(const Arguments& args);
+
+  static Handle<Value> Put(const Arguments& args);
+  static Handle<Value> Flush(const Arguments& args);
+  static Handle<Value> Finish(const Arguments& args);
+
+  static void FlushAsync(uv_work_t* req);
+  static void FinishAsync(uv_work_t* req);
+
+  Handle<Value> Async(const uv_work_cb fn, const Local<Value>& callback);
+  static void AfterAsync(uv_work_t* req);
+
+  // Add the entries handed to the worker, opening the file first
+  void WriteEntries();
+
+  JTableWriter(const std::string& path, const leveldb::Options& options);
+
+  // No copying allowed
+  JTableWriter(const JTableWriter&);
+  void operator=(const JTableWriter&);
+
+  virtual ~JTableWriter();
+
+  leveldb::TableFileWriter writer_;
+  std::string path_;
+  leveldb::Status status_;
+
+  bool opened_;
+  bool finished_;
+  bool busy_;
+
+  // Entries added since the last flush, and the entries being written
+  // by the worker.  The buffers they point into are kept alive until
+  // the write completes.
+  Entries pending_;
+  Entries writing_;
+  std::vector< Persistent<Value> > pendingBuffers_;
+  std::vector< Persistent<Value> > writingBuffers_;
+
+  Persistent<Function> callback_;
+  Persistent<Value> comparator_;
+};
+
+} // node_leveldb
+
+#endif // NODE_LEVELDB_TABLE_WRITER_H_